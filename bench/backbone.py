@@ -0,0 +1,364 @@
+"""
+Ideal protein backbones for the benchmark corpus and synth.py: chains
+built from backbone dihedrals with standard bond lengths and angles,
+helices, sheets and barrels assembled from them, and writers for PDB
+files and DCD trajectories.  Everything is deterministic, so the same
+structures are generated on every machine.
+
+A residue is a list of its N, CA, C and O coordinates, and optionally
+that of its imide H.
+"""
+
+from __future__ import division, print_function
+
+import math, struct
+
+# Backbone dihedrals (phi, psi)
+ALPHA = (-57.0, -47.0)
+THREE_TEN = (-49.0, -26.0)
+ANTIPARALLEL = (-139.0, 135.0)
+PARALLEL = (-119.0, 113.0)
+
+def sub (a, b) :
+  return [a[0] - b[0], a[1] - b[1], a[2] - b[2]]
+
+def add (a, b) :
+  return [a[0] + b[0], a[1] + b[1], a[2] + b[2]]
+
+def scale (a, s) :
+  return [a[0] * s, a[1] * s, a[2] * s]
+
+def dot (a, b) :
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]
+
+def cross (a, b) :
+  return [a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2],
+    a[0] * b[1] - a[1] * b[0]]
+
+def normalize (a) :
+  return scale(a, 1 / math.sqrt(dot(a, a)))
+
+def place (a, b, c, bond, angle, torsion) :
+  """
+  Position of the atom bonded to c at distance bond, with angle b-c-x
+  and dihedral a-b-c-x (in degrees).
+  """
+  angle = math.radians(angle)
+  torsion = math.radians(torsion)
+  bc = normalize(sub(c, b))
+  n = normalize(cross(sub(b, a), bc))
+  m = cross(n, bc)
+  d = [-bond * math.cos(angle), bond * math.sin(angle) * math.cos(torsion),
+    bond * math.sin(angle) * math.sin(torsion)]
+  return add(c, [bc[i] * d[0] + m[i] * d[1] + n[i] * d[2] for i in range(3)])
+
+def chain (dihedrals, hydrogens=False) :
+  """
+  Build a chain with one residue per (phi, psi) pair, starting at the
+  origin.  With hydrogens, each residue gets an imide H on the
+  bisector of the C-N-CA angle (that of the first residue as if the
+  chain continued before it), so that a piece of chain can stand on
+  its own.
+  """
+  residues = []
+  for k, (phi, psi) in enumerate(dihedrals) :
+    if k == 0 :
+      n = [0.0, 0.0, 0.0]
+      ca = [1.458, 0.0, 0.0]
+      c = place([0.0, 1.0, 0.0], n, ca, 1.525, 111.2, phi)
+    else :
+      pn, pca, pc = residues[-1][:3]
+      n = place(pn, pca, pc, 1.329, 116.2, dihedrals[k - 1][1])
+      ca = place(pca, pc, n, 1.458, 121.7, 180.0)
+      c = place(pc, n, ca, 1.525, 111.2, phi)
+    residues.append([n, ca, c, None])
+  for k, r in enumerate(residues) :
+    # The carbonyl O is trans to the next N
+    next_n = place(r[0], r[1], r[2], 1.329, 116.2, dihedrals[k][1])
+    r[3] = place(next_n, r[1], r[2], 1.231, 120.5, 180.0)
+  if hydrogens :
+    for k, r in enumerate(residues) :
+      if k > 0 :
+        previous_c = residues[k - 1][2]
+      else :
+        previous_c = place(r[2], r[1], r[0], 1.329, 121.7, dihedrals[0][0])
+      bisector = add(normalize(sub(r[0], previous_c)),
+        normalize(sub(r[0], r[1])))
+      r.append(add(r[0], scale(normalize(bisector), 1.01)))
+  return residues
+
+def transform (residues, rotation, translation) :
+  return [[add([dot(row, a) for row in rotation], translation) for a in r]
+    for r in residues]
+
+def shift (residues, translation) :
+  return [[add(a, translation) for a in r] for r in residues]
+
+def hbond_energy (acceptor, donor, donor_previous) :
+  """
+  Kabsch and Sander electrostatic energy (kcal/mol) of the hydrogen
+  bond from the N-H of donor to the C=O of acceptor, placing H as
+  ksdssp does if donor has none.
+  """
+  n, ca = donor[0], donor[1]
+  c, o = acceptor[2], acceptor[3]
+  if len(donor) > 4 :
+    h = donor[4]
+  else :
+    pc, po = donor_previous[2], donor_previous[3]
+    bisector = normalize(add(normalize(sub(ca, n)), normalize(sub(pc, n))))
+    h = sub(n, scale(normalize(add(bisector, normalize(sub(po, pc)))),
+      1.01))
+  d = lambda a, b : math.sqrt(dot(sub(a, b), sub(a, b)))
+  return 0.084 * 332 * (1 / d(o, n) + 1 / d(c, h) - 1 / d(o, h) - 1 / d(c, n))
+
+def hbond_energies (a, b) :
+  """
+  Energies of all the possible hydrogen bonds between strands a and b.
+  """
+  return [hbond_energy(x[i], y[j], y[j - 1]) for x, y in ((a, b), (b, a))
+    for i in range(len(x)) for j in range(1, len(y))]
+
+def helix (length, dihedrals=ALPHA, hydrogens=False) :
+  """
+  A helix of length residues with its axis along x, starting near
+  the origin.
+  """
+  residues = chain([dihedrals] * length, hydrogens)
+  # The axis runs through the mean positions of successive turns
+  turn = 4 if length >= 8 else 1
+  first = [sum(r[1][d] for r in residues[:turn]) / turn for d in range(3)]
+  last = [sum(r[1][d] for r in residues[-turn:]) / turn for d in range(3)]
+  return aligned(residues, normalize(sub(last, first)), first)
+
+def aligned (residues, x, origin) :
+  """
+  Rotate residues so that x lies along the x axis, with the mean C=O
+  direction (alternating in sign along a strand) along y, and move
+  origin to the origin.
+  """
+  y = [0.0, 0.0, 0.0]
+  for k, r in enumerate(residues) :
+    y = add(y, scale(sub(r[3], r[2]), 1 if k % 2 == 0 else -1))
+  y = normalize(sub(y, scale(x, dot(y, x))))
+  z = cross(x, y)
+  return transform(shift(residues, scale(origin, -1)), [x, y, z],
+    [0.0, 0.0, 0.0])
+
+def strand (length, dihedrals=ANTIPARALLEL, hydrogens=False) :
+  """
+  A strand of length residues along x, its carbonyls pointing
+  alternately along +y and -y.
+  """
+  residues = chain([dihedrals] * length, hydrogens)
+  return aligned(residues, normalize(sub(residues[-1][1], residues[0][1])),
+    residues[0][1])
+
+FLIP = [[-1.0, 0.0, 0.0], [0.0, -1.0, 0.0], [0.0, 0.0, 1.0]]
+
+def pairing_score (a, b) :
+  """
+  How well strands a and b are paired: the number of hydrogen bonds
+  well below the cutoff, so that small displacements do not break
+  them, and then how close their energies are to the -3 kcal/mol of a
+  good hydrogen bond.  None if some bond is unphysically strong (atoms
+  too close).
+  """
+  energies = hbond_energies(a, b)
+  if min(energies) < -6 :
+    return None
+  good = [e for e in energies if e < -1.5]
+  return (len(good), -sum(abs(e + 3) for e in good))
+
+def pairing_scores (s, other, offset, side) :
+  """
+  The scores of the placements of other next to strand s on its +y
+  (side 1) or -y (side -1) side, on a grid of translations, as a list
+  of (dx, score, translation).
+  """
+  scores = []
+  for dx in range(-60, 61, 2) :
+    for dy in range(42, 58, 2) :
+      t = [offset + dx / 10, side * dy / 10, 0.0]
+      scores.append((dx, pairing_score(s, shift(other, t)), t))
+  return scores
+
+def best (scores) :
+  result = None
+  for dx, score, t in scores :
+    if score is not None and (result is None or score > result[0]) :
+      result = (score, t)
+  return result
+
+_pairing = {}
+
+def antiparallel_pairing (length, hydrogens=False, closed=False) :
+  """
+  The translations that place a copy of strand(length) rotated by 180
+  degrees about z next to it on its +y side and on its -y side, found
+  by a grid search (and remembered).  If closed, both translations
+  have the same x component, so that strands two apart are in line
+  and a sheet can be rolled into a barrel.
+  """
+  key = ("antiparallel", length, hydrogens, closed)
+  if key in _pairing :
+    return _pairing[key]
+  s = strand(length, hydrogens=hydrogens)
+  flipped = transform(s, FLIP, [0.0, 0.0, 0.0])
+  span = s[-1][1][0]
+  up = pairing_scores(s, flipped, span, 1)
+  down = pairing_scores(s, flipped, span, -1)
+  if not closed :
+    result = [best(up)[1], best(down)[1]]
+  else :
+    result = None
+    for dx in range(-60, 61, 2) :
+      u = best([c for c in up if c[0] == dx])
+      d = best([c for c in down if c[0] == dx])
+      if u is None or d is None :
+        continue
+      score = (u[0][0] + d[0][0], u[0][1] + d[0][1])
+      if result is None or score > result[0] :
+        result = (score, [u[1], d[1]])
+    result = result[1]
+  _pairing[key] = result
+  return result
+
+def parallel_pairing (length, hydrogens=False) :
+  """
+  The translation that places a copy of strand(length, PARALLEL) next
+  to it on its +y side (found and remembered as above).
+  """
+  key = ("parallel", length, hydrogens)
+  if key not in _pairing :
+    s = strand(length, PARALLEL, hydrogens)
+    _pairing[key] = best(pairing_scores(s, s, 0.0, 1))[1]
+  return _pairing[key]
+
+def antiparallel_sheet (strands, length, hydrogens=False, closed=False) :
+  """
+  An antiparallel sheet of strands strands of length residues, in the
+  xy plane and stacked along +y.  Strand k + 2 is strand k moved by
+  the sum of the two pairing translations.
+  """
+  up, down = antiparallel_pairing(length, hydrogens, closed)
+  s = strand(length, hydrogens=hydrogens)
+  flipped = transform(s, FLIP, [0.0, 0.0, 0.0])
+  period = add(up, transform([[down]], FLIP, [0.0, 0.0, 0.0])[0][0])
+  sheet = []
+  for k in range(strands) :
+    base = scale(period, k // 2)
+    sheet.append(shift(s, base) if k % 2 == 0 else
+      shift(flipped, add(base, up)))
+  return sheet
+
+def parallel_sheet (strands, length, hydrogens=False) :
+  """
+  A parallel sheet of strands strands of length residues, in the xy
+  plane and stacked along +y.
+  """
+  t = parallel_pairing(length, hydrogens)
+  s = strand(length, PARALLEL, hydrogens)
+  return [shift(s, scale(t, k)) for k in range(strands)]
+
+def barrel (strands, length, hydrogens=False) :
+  """
+  An antiparallel barrel of strands (an even number) strands of length
+  residues around the x axis: a closed sheet rolled up so that the
+  last strand pairs with the first.
+  """
+  up, down = antiparallel_pairing(length, hydrogens, closed=True)
+  sheet = antiparallel_sheet(strands, length, hydrogens, closed=True)
+  circumference = (strands // 2) * (up[1] - down[1])
+  radius = circumference / (2 * math.pi)
+  rolled = []
+  for s in sheet :
+    rolled.append([[[a[0], (radius - a[2]) * math.sin(a[1] / radius),
+      (radius - a[2]) * math.cos(a[1] / radius)] for a in r] for r in s])
+  return rolled
+
+CHAIN_IDS = ("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+  "0123456789")
+INSERT_CODES = " ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+
+class Writer (object) :
+  """
+  Writes pieces of chain (lists of residues) as ATOM records.  The
+  pieces written before a TER record are one segment to ksdssp, which
+  does not notice the breaks between them (only the imide hydrogen of
+  the first residue of a piece is misplaced, unless given).  Each
+  chain identifier is used for up to 9999 residues, so several
+  segments can share one; once all have been used, they are used
+  again with insertion codes A, B, ...  Writers with different first
+  chains and the same step share the identifiers between them.
+  """
+  def __init__ (self, output, first=0, step=1) :
+    self.output = output
+    self.first = first
+    self.step = step
+    self.chain = 0
+    self.residue = 0
+    self.serial = 0
+    self.residues = 0
+
+  def new_chain (self) :
+    """
+    Start the next chain identifier (unless nothing has been written
+    with this one).
+    """
+    if self.residue > 0 :
+      self.chain += 1
+      self.residue = 0
+
+  def piece (self, residues, name="ALA") :
+    """
+    Write a piece of chain and return the identifiers (chain, number
+    and insertion code) of its residues.
+    """
+    if self.residue + len(residues) > 9999 :
+      self.chain += 1
+      self.residue = 0
+    cycle, k = divmod(self.first + self.step * self.chain, len(CHAIN_IDS))
+    if cycle >= len(INSERT_CODES) :
+      raise ValueError("too many residues for one model")
+    chain_id = CHAIN_IDS[k]
+    code = INSERT_CODES[cycle]
+    ids = []
+    for r in residues :
+      self.residue += 1
+      for atom, xyz in zip((" N  ", " CA ", " C  ", " O  ", " H  "), r) :
+        self.serial = self.serial % 99999 + 1
+        self.output.write("ATOM  %5d %-4s %3s %s%4d%s   %8.3f%8.3f%8.3f"
+          "  1.00  0.00\n" % (self.serial, atom, name, chain_id,
+          self.residue, code, xyz[0], xyz[1], xyz[2]))
+      ids.append((chain_id, self.residue, code))
+    self.residues += len(residues)
+    return ids
+
+  def ter (self) :
+    self.output.write("TER\n")
+
+  def end_model (self) :
+    self.chain = 0
+    self.residue = 0
+
+def write_dcd (path, frames, title="ksdssp benchmark") :
+  """
+  Write frames (lists of atom coordinates) as a little endian X-PLOR
+  DCD trajectory.
+  """
+  def record (data) :
+    size = struct.pack("<i", len(data))
+    return size + data + size
+  atoms = len(frames[0])
+  control = [0] * 20
+  control[0] = len(frames)
+  with open(path, "wb") as f :
+    f.write(record(b"CORD" + struct.pack("<20i", *control)))
+    f.write(record(struct.pack("<i", 1) +
+      title.encode("ascii")[:80].ljust(80)))
+    f.write(record(struct.pack("<i", atoms)))
+    for frame in frames :
+      for d in range(3) :
+        f.write(record(struct.pack("<%df" % atoms,
+          *[xyz[d] for xyz in frame])))
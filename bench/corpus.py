@@ -0,0 +1,141 @@
+"""
+Generate the benchmark corpus: PDB files (and a DCD trajectory) of
+ideal backbone domains in sizes from one small protein to a large
+assembly, so that timings can be compared across machines and
+versions without shipping structures.  The same seed always gives
+byte-identical files.
+
+usage: python corpus.py [directory]
+"""
+
+from __future__ import division, print_function
+
+import json, math, os, random, sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import backbone
+
+# Bump when the files generated change, so old corpora are rebuilt
+VERSION = 1
+SEED = 1983
+
+# Tiers: (name, domains per model, models, frames)
+TIERS = (
+  ("small", 2, 1, 0),
+  ("medium", 32, 1, 0),
+  ("large", 512, 1, 0),
+  ("multimodel", 8, 16, 0),
+  ("trajectory", 16, 1, 100),
+)
+
+# Spacing (angstroms) of the grid the domains are placed on
+SPACING = (32.0, 32.0, 28.0)
+
+# Root mean square displacement (angstroms, per coordinate) of the
+# atoms of each model and frame from the ideal positions
+JITTER = 0.1
+
+def domain () :
+  """
+  One domain: a six stranded antiparallel sheet with a helix packed
+  against each face (78 residues), as a list of pieces of chain.
+  """
+  sheet = backbone.antiparallel_sheet(6, 7)
+  helix = backbone.helix(18)
+  width = max(a[1] for a in sheet[-1][0])
+  return sheet + [backbone.shift(helix, [0.0, width / 4, 10.0]),
+    backbone.shift(helix, [0.0, 3 * width / 4, -10.0])]
+
+def layout (count) :
+  """
+  Translations placing count domains on a cubic grid.
+  """
+  side = 1
+  while side ** 3 < count :
+    side += 1
+  return [[SPACING[0] * (k % side), SPACING[1] * (k // side % side),
+    SPACING[2] * (k // (side * side))] for k in range(count)]
+
+def model (template, count) :
+  """
+  The pieces of count copies of the template domain, each a list of
+  pieces of chain.
+  """
+  return [[backbone.shift(piece, t) for piece in template]
+    for t in layout(count)]
+
+def jittered (domains, rng) :
+  return [[[[[x + rng.gauss(0.0, JITTER) for x in a] for a in r]
+    for r in piece] for piece in d] for d in domains]
+
+def write_model (writer, domains) :
+  """
+  Write the domains as one segment (as ksdssp assigns everything up to
+  a TER record together), changing chain identifier when needed.
+  """
+  for d in domains :
+    for piece in d :
+      writer.piece(piece)
+  writer.ter()
+  writer.end_model()
+
+def generate (directory, verbose=False) :
+  """
+  Write the corpus to directory, with a manifest (corpus.json)
+  describing each input, and return the manifest.
+  """
+  if not os.path.isdir(directory) :
+    os.makedirs(directory)
+  template = domain()
+  rng = random.Random(SEED)
+  inputs = []
+  for name, count, models, frames in TIERS :
+    domains = model(template, count)
+    pdb = name + ".pdb"
+    with open(os.path.join(directory, pdb), "w") as f :
+      writer = backbone.Writer(f)
+      for m in range(models) :
+        if models > 1 :
+          f.write("MODEL     %4d\n" % (m + 1))
+          write_model(writer, jittered(domains, rng))
+          f.write("ENDMDL\n")
+        else :
+          write_model(writer, domains)
+      f.write("END\n")
+    residues = writer.residues // models
+    entry = { "name": name, "pdb": pdb, "residues": residues,
+      "models": models, "frames": frames }
+    if frames > 0 :
+      entry["trajectory"] = name + ".dcd"
+      backbone.write_dcd(os.path.join(directory, entry["trajectory"]),
+        [[a for d in jittered(domains, rng) for piece in d
+          for r in piece for a in r] for k in range(frames)])
+    inputs.append(entry)
+    if verbose :
+      print("%-12s %7d residues %3d model(s) %4d frame(s)" % (name,
+        residues, models, frames))
+  manifest = { "version": VERSION, "seed": SEED, "inputs": inputs }
+  with open(os.path.join(directory, "corpus.json"), "w") as f :
+    json.dump(manifest, f, indent=2, sort_keys=True)
+    f.write("\n")
+  return manifest
+
+def load (directory) :
+  """
+  The manifest of the corpus in directory, generating the corpus first
+  if it is missing or out of date.
+  """
+  path = os.path.join(directory, "corpus.json")
+  if os.path.isfile(path) :
+    with open(path) as f :
+      manifest = json.load(f)
+    if manifest.get("version") == VERSION :
+      return manifest
+  return generate(directory)
+
+if __name__ == "__main__" :
+  if len(sys.argv) > 2 :
+    print(__doc__.strip().splitlines()[-1], file=sys.stderr)
+    sys.exit(2)
+  generate(sys.argv[1] if len(sys.argv) > 1 else "bench_corpus",
+    verbose=True)
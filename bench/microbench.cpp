@@ -0,0 +1,488 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+//
+// Microbenchmarks of the kernels ksdssp spends its time in: the
+// hydrogen bond test, the geometry primitives of misc.cpp and the
+// libpdb++ record parser and formatter.  Each benchmark cycles
+// through a fixed set of inputs (the same on every run); its number
+// of operations is calibrated to take about the given time, and after
+// the warm-up repetitions each repetition is timed.  The median and
+// fastest times per operation are printed, with the rate at which
+// the median consumes input (or produces output, for chars()).
+//
+// Usage: microbench [-n repetitions] [-w warm-up repetitions]
+//		[-t milliseconds per repetition] [benchmark ...]
+//
+// where each benchmark argument selects those whose names start with
+// it (all by default).
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pdb++.h>
+#include "Residue.h"
+#include "Timings.h"
+#include "misc.h"
+#include "XGetopt.h"
+
+// Number of inputs each benchmark cycles through (a power of two)
+#define	INPUTS		1024
+
+// Results of the operations, so that none can be optimized away
+static volatile double	sink;
+
+//
+// Pseudo-random number between low and high
+//
+static unsigned long	seed = 1983;
+
+static float
+uniform(float low, float high)
+{
+	seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+	return low + (high - low) * (seed / 2147483648.0);
+}
+
+//
+// Point at the given distance from p in a random direction
+//
+static void
+displace(float r[3], const float p[3], float low, float high)
+{
+	float v[3];
+	do {
+		for (int i = 0; i < 3; i++)
+			v[i] = uniform(-1, 1);
+	} while (dotProduct(v, v) < 0.01);
+	normalize(v);
+	float d = uniform(low, high);
+	for (int i = 0; i < 3; i++)
+		r[i] = p[i] + d * v[i];
+}
+
+//
+// Residue pairs (acceptor, donor) for hBondedTo: near pairs are
+// within the 7 angstrom C-N cutoff with the O and N 2.6 to 4 angstroms
+// apart, so that some are bonded and some not, and far pairs are
+// rejected by the cutoff
+//
+static PDB::Residue	pdbResidue;
+static float		nearXyz[INPUTS][2][A_COUNT][3];
+static float		farXyz[INPUTS][2][A_COUNT][3];
+static Residue		nearPair[INPUTS][2];
+static Residue		farPair[INPUTS][2];
+static const float	hBondCutoff = -0.5;	// default energy cutoff (-c)
+
+static void
+makePairs(float (*xyz)[2][A_COUNT][3], Residue (*pair)[2], int near)
+{
+	const int atoms = (1 << A_N) | (1 << A_CA) | (1 << A_C) |
+				(1 << A_O) | (1 << A_H);
+	for (int k = 0; k < INPUTS; k++) {
+		float (*a)[3] = xyz[k][0];
+		float (*d)[3] = xyz[k][1];
+		displace(a[A_C], a[A_C], 0, 1);
+		displace(a[A_O], a[A_C], 1.23, 1.23);
+		displace(a[A_CA], a[A_C], 1.52, 1.52);
+		displace(a[A_N], a[A_CA], 1.46, 1.46);
+		displace(a[A_H], a[A_N], 1.01, 1.01);
+		if (near)
+			displace(d[A_N], a[A_O], 2.6, 4);
+		else
+			displace(d[A_N], a[A_C], 8, 20);
+		displace(d[A_H], d[A_N], 1.01, 1.01);
+		displace(d[A_CA], d[A_N], 1.46, 1.46);
+		displace(d[A_C], d[A_CA], 1.52, 1.52);
+		displace(d[A_O], d[A_C], 1.23, 1.23);
+		pair[k][0] = Residue(&pdbResidue, a, atoms);
+		pair[k][1] = Residue(&pdbResidue, d, atoms);
+	}
+}
+
+static void
+hBondNear(long n)
+{
+	long count = 0;
+	for (long i = 0; i < n; i++) {
+		const Residue *r = nearPair[i & (INPUTS - 1)];
+		count += r[0].hBondedTo(&r[1], hBondCutoff);
+	}
+	sink = count;
+}
+
+static void
+hBondFar(long n)
+{
+	long count = 0;
+	for (long i = 0; i < n; i++) {
+		const Residue *r = farPair[i & (INPUTS - 1)];
+		count += r[0].hBondedTo(&r[1], hBondCutoff);
+	}
+	sink = count;
+}
+
+//
+// Points for the geometry primitives
+//
+static float		points[INPUTS + 3][3];
+
+static void
+makePoints(void)
+{
+	static const float origin[3] = { 0, 0, 0 };
+	for (int k = 0; k < INPUTS + 3; k++)
+		displace(points[k], origin, 0, 20);
+}
+
+static void
+distanceOp(long n)
+{
+	float sum = 0;
+	for (long i = 0; i < n; i++) {
+		int k = i & (INPUTS - 1);
+		sum += distance(points[k], points[k + 1]);
+	}
+	sink = sum;
+}
+
+static void
+dihedralOp(long n)
+{
+	float sum = 0;
+	for (long i = 0; i < n; i++) {
+		int k = i & (INPUTS - 1);
+		sum += dihedral(points[k], points[k + 1], points[k + 2],
+							points[k + 3]);
+	}
+	sink = sum;
+}
+
+static void
+normalizeOp(long n)
+{
+	float sum = 0;
+	for (long i = 0; i < n; i++) {
+		const float *p = points[i & (INPUTS - 1)];
+		float v[3] = { p[0], p[1], p[2] };
+		normalize(v);
+		sum += v[0];
+	}
+	sink = sum;
+}
+
+//
+// PDB records: ATOM and HETATM records as written by chars(), and
+// REMARK records; mixed cycles through all three
+//
+static char		atomLines[INPUTS][PDB::BufLen];
+static char		hetatmLines[INPUTS][PDB::BufLen];
+static char		remarkLines[INPUTS][PDB::BufLen];
+static char		mixedLines[INPUTS][PDB::BufLen];
+static PDB		atomRecords[INPUTS];
+
+static void
+makeRecords(void)
+{
+	static const char *names[] = { " N", " CA", " C", " O", " CB" };
+	static const char *residues[] = { "ALA", "GLY", "LEU", "SER" };
+	for (int k = 0; k < INPUTS; k++) {
+		PDB atom(PDB::ATOM);
+		atom.atom.serialNum = k + 1;
+		(void) strcpy(atom.atom.name, names[k % 5]);
+		(void) strcpy(atom.atom.residue.name, residues[k / 5 % 4]);
+		atom.atom.residue.chainId = 'A' + k / 500;
+		atom.atom.residue.seqNum = k / 5 + 1;
+		for (int i = 0; i < 3; i++)
+			atom.atom.xyz[i] = uniform(-99, 99);
+		atom.atom.occupancy = 1;
+		atom.atom.tempFactor = uniform(5, 60);
+		(void) strcpy(atomLines[k], atom.chars());
+		atomRecords[k] = PDB(atomLines[k]);
+
+		PDB hetatm(PDB::HETATM);
+		hetatm.hetatm.serialNum = INPUTS + k + 1;
+		(void) strcpy(hetatm.hetatm.name, " O");
+		(void) strcpy(hetatm.hetatm.residue.name, "HOH");
+		hetatm.hetatm.residue.chainId = 'W';
+		hetatm.hetatm.residue.seqNum = k + 1;
+		for (int i = 0; i < 3; i++)
+			hetatm.hetatm.xyz[i] = uniform(-99, 99);
+		hetatm.hetatm.occupancy = 1;
+		hetatm.hetatm.tempFactor = uniform(5, 60);
+		(void) strcpy(hetatmLines[k], hetatm.chars());
+
+		PDB remark(PDB::REMARK);
+		remark.remark.num = 3 + k % 400;
+		(void) sprintf(remark.remark.text,
+			"  REFINEMENT TARGET : ENGH & HUBER    %6.3f",
+			uniform(0, 10));
+		(void) strcpy(remarkLines[k], remark.chars());
+
+		const char *lines[3] = {
+			atomLines[k], hetatmLines[k], remarkLines[k]
+		};
+		(void) strcpy(mixedLines[k], lines[k % 3]);
+	}
+}
+
+static void
+parse(char (*lines)[PDB::BufLen], long n)
+{
+	double sum = 0;
+	for (long i = 0; i < n; i++) {
+		PDB record(lines[i & (INPUTS - 1)]);
+		sum += record.type();
+	}
+	sink = sum;
+}
+
+static void
+parseAtom(long n)
+{
+	parse(atomLines, n);
+}
+
+static void
+parseHetatm(long n)
+{
+	parse(hetatmLines, n);
+}
+
+static void
+parseRemark(long n)
+{
+	parse(remarkLines, n);
+}
+
+static void
+getTypeOp(long n)
+{
+	long sum = 0;
+	for (long i = 0; i < n; i++)
+		sum += PDB::getType(mixedLines[i & (INPUTS - 1)]);
+	sink = sum;
+}
+
+static void
+sscanfOp(long n)
+{
+	// The ATOM format of libpdb++ (read_format.i)
+	static const char fmt[] =
+		"%6 %5d %4s%c%4s%c%4d%c   %8f%8f%8f%6f%6f %3d";
+	PDB::Atom atom;
+	double sum = 0;
+	for (long i = 0; i < n; i++) {
+		(void) PDB::sscanf(atomLines[i & (INPUTS - 1)], fmt,
+				&atom.serialNum, atom.name, &atom.altLoc,
+				atom.residue.name, &atom.residue.chainId,
+				&atom.residue.seqNum, &atom.residue.insertCode,
+				&atom.xyz[0], &atom.xyz[1], &atom.xyz[2],
+				&atom.occupancy, &atom.tempFactor,
+				&atom.ftnoteNum);
+		sum += atom.xyz[0];
+	}
+	sink = sum;
+}
+
+static void
+charsOp(long n)
+{
+	long sum = 0;
+	for (long i = 0; i < n; i++)
+		sum += atomRecords[i & (INPUTS - 1)].chars()[30];
+	sink = sum;
+}
+
+//
+// Each benchmark with the bytes an operation reads: for hBondedTo the
+// C and O of the acceptor and the N and H of the donor, for the
+// geometry primitives their points, and for the parser and formatter
+// the records (their average length)
+//
+#define	XYZ_BYTES	(3 * sizeof (float))
+
+struct Benchmark {
+	const char	*name;
+	void		(*run)(long n);
+	double		bytes;
+	char		(*lines)[PDB::BufLen];
+};
+
+static Benchmark	benchmarks[] = {
+	{ "hBondedTo/near",	hBondNear,	4 * XYZ_BYTES,	NULL },
+	{ "hBondedTo/far",	hBondFar,	4 * XYZ_BYTES,	NULL },
+	{ "distance",		distanceOp,	2 * XYZ_BYTES,	NULL },
+	{ "dihedral",		dihedralOp,	4 * XYZ_BYTES,	NULL },
+	{ "normalize",		normalizeOp,	XYZ_BYTES,	NULL },
+	{ "PDB/ATOM",		parseAtom,	0,		atomLines },
+	{ "PDB/HETATM",		parseHetatm,	0,		hetatmLines },
+	{ "PDB/REMARK",		parseRemark,	0,		remarkLines },
+	{ "getType",		getTypeOp,	0,		mixedLines },
+	{ "sscanf/ATOM",	sscanfOp,	0,		atomLines },
+	{ "chars/ATOM",		charsOp,	0,		atomLines },
+};
+
+#define	BENCHMARKS	(sizeof benchmarks / sizeof benchmarks[0])
+
+//
+// Set up the inputs of the benchmarks
+//
+static void
+setUp(void)
+{
+	makePairs(nearXyz, nearPair, 1);
+	makePairs(farXyz, farPair, 0);
+	makePoints();
+	makeRecords();
+	for (unsigned int b = 0; b < BENCHMARKS; b++) {
+		Benchmark &bm = benchmarks[b];
+		if (bm.lines == NULL)
+			continue;
+		double total = 0;
+		for (int k = 0; k < INPUTS; k++)
+			total += strlen(bm.lines[k]);
+		bm.bytes = total / INPUTS;
+	}
+}
+
+static double
+timed(const Benchmark &bm, long n)
+{
+	double start = StageTimes::now();
+	(*bm.run)(n);
+	return StageTimes::now() - start;
+}
+
+static int
+compareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+	return x < y ? -1 : x > y;
+}
+
+//
+// Run one benchmark and print its times
+//
+static void
+measure(const Benchmark &bm, int repetitions, int warmup, double target)
+{
+	// Find how many operations take about the target time
+	long n = 1;
+	double elapsed;
+	while ((elapsed = timed(bm, n)) < target / 10 && n < (1L << 40))
+		n *= 2;
+	if (elapsed > 0)
+		n = (long) (n * target / elapsed) + 1;
+
+	for (int r = 0; r < warmup; r++)
+		(void) timed(bm, n);
+	double *ns = new double[repetitions];
+	for (int r = 0; r < repetitions; r++)
+		ns[r] = timed(bm, n) * 1e9 / n;
+	qsort(ns, repetitions, sizeof ns[0], compareDoubles);
+	double median = repetitions % 2 ? ns[repetitions / 2] :
+			(ns[repetitions / 2 - 1] + ns[repetitions / 2]) / 2;
+	(void) printf("%-16s %12ld %10.2f %10.2f %10.1f\n", bm.name, n,
+			median, ns[0], bm.bytes * 1e3 / median);
+	(void) fflush(stdout);
+	delete [] ns;
+}
+
+//
+// Does the name of a benchmark start with one of the arguments
+// (or are there none)?
+//
+static int
+selected(const Benchmark &bm, int argc, char **argv)
+{
+	if (argc == 0)
+		return 1;
+	for (int i = 0; i < argc; i++)
+		if (strncmp(bm.name, argv[i], strlen(argv[i])) == 0)
+			return 1;
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	int o;
+	int repetitions = 5;
+	int warmup = 1;
+	double target = 0.2;
+	int bad = 0;
+	const char *program = argv[0];
+	while ((o = Xgetopt(argc, argv, "n:t:w:")) != EOF)
+		switch (o) {
+		  case 'n':
+			repetitions = atoi(optarg);
+			break;
+		  case 't':
+			target = atof(optarg) / 1000;
+			break;
+		  case 'w':
+			warmup = atoi(optarg);
+			break;
+		  default:
+			bad = 1;
+			break;
+		}
+	if (bad || repetitions < 1 || warmup < 0 || target <= 0) {
+		(void) fprintf(stderr, "Usage: %s [-n repetitions] "
+			"[-w warmup] [-t milliseconds] [benchmark ...]\n",
+			program);
+		return 1;
+	}
+	argc -= optind;
+	argv += optind;
+	for (int i = 0; i < argc; i++) {
+		unsigned int b;
+		for (b = 0; b < BENCHMARKS; b++)
+			if (selected(benchmarks[b], 1, &argv[i]))
+				break;
+		if (b == BENCHMARKS) {
+			(void) fprintf(stderr, "%s: no benchmark %s\n",
+				program, argv[i]);
+			return 1;
+		}
+	}
+
+	setUp();
+	(void) printf("%-16s %12s %10s %10s %10s\n", "benchmark",
+			"ops/rep", "ns/op", "min ns/op", "MB/s");
+	for (unsigned int b = 0; b < BENCHMARKS; b++)
+		if (selected(benchmarks[b], argc, argv))
+			measure(benchmarks[b], repetitions, warmup, target);
+	return 0;
+}
@@ -0,0 +1,207 @@
+"""
+Time the ksdssp program end to end over the benchmark corpus (see
+corpus.py), for each input, engine setting and number of workers,
+and write the median and 95th percentile wall time, residues assigned
+per second and peak resident set size of each combination as CSV and
+JSON.
+
+usage: python run_bench.py [options]
+
+  -x program   ksdssp program to time (default ../ksdssp_src/ksdssp)
+  -d directory corpus directory, generated if need be (default
+               bench_corpus)
+  -i inputs    comma separated inputs to time (default all)
+  -e engines   comma separated engine settings to time (default all)
+  -j workers   comma separated numbers of workers for -j (default
+               1,2,4; only trajectories use them)
+  -n runs      timed runs of each combination (default 5)
+  -w runs      untimed warm-up runs of each combination (default 1)
+  -o prefix    write prefix.csv and prefix.json (default bench)
+"""
+
+from __future__ import division, print_function
+
+import csv, getopt, json, os, platform, shutil, subprocess, sys, tempfile
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import corpus
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+clock = getattr(time, "perf_counter", time.time)
+
+# Engine settings: (name, ksdssp options, for trajectories, for files).
+# The cache directory of -K is filled by the warm-up runs, so the
+# timed runs measure cache hits.
+ENGINES = (
+  ("default", [], True, True),
+  ("nobulges", ["-B"], True, True),
+  ("skin0", ["-k", "0"], True, False),
+  ("cache", ["-K", "{cache}"], False, True),
+)
+
+COLUMNS = ("input", "engine", "workers", "runs", "residues", "median_s",
+  "p95_s", "min_s", "residues_per_s", "peak_rss_kb")
+
+def percentile (values, p) :
+  """
+  The p-th percentile (nearest rank) of values.
+  """
+  ordered = sorted(values)
+  rank = int(-(-p * len(ordered) // 100))
+  return ordered[max(rank, 1) - 1]
+
+def run_once (command, quiet=False) :
+  """
+  Run command with its output (and if quiet, its diagnostics)
+  discarded, and return the wall time.
+  """
+  with open(os.devnull, "w") as null :
+    start = clock()
+    status = subprocess.call(command, stdout=null,
+      stderr=null if quiet else None)
+    elapsed = clock() - start
+  if status != 0 :
+    raise RuntimeError("%s failed (status %d)" % (" ".join(command),
+      status))
+  return elapsed
+
+def peak_rss (command, scratch) :
+  """
+  The peak resident set size (KB) of command, as ksdssp reports it
+  with -u in one more run.  (The rusage of a child of this interpreter
+  would include the peak of the interpreter itself.)
+  """
+  profile = os.path.join(scratch, "profile.json")
+  run_once(command[:1] + ["-u", "-P", profile] + command[1:], quiet=True)
+  with open(profile) as f :
+    return json.load(f)["all"]["peakRssKB"]
+
+def command_for (program, directory, entry, options, workers) :
+  command = [program] + options
+  if entry.get("trajectory") :
+    command += ["-j", str(workers), "-t",
+      os.path.join(directory, entry["trajectory"])]
+  command.append(os.path.join(directory, entry["pdb"]))
+  return command
+
+def time_combination (command, runs, warmup) :
+  for k in range(warmup) :
+    run_once(command)
+  return [run_once(command) for k in range(runs)]
+
+def run (program, directory, inputs, engines, workers, runs, warmup) :
+  manifest = corpus.load(directory)
+  results = []
+  scratch = tempfile.mkdtemp(prefix="ksdssp-bench-")
+  cache = os.path.join(scratch, "cache")
+  try :
+    for entry in manifest["inputs"] :
+      if inputs and entry["name"] not in inputs :
+        continue
+      trajectory = "trajectory" in entry
+      # Residues assigned per run
+      residues = (entry["residues"] * entry["models"]
+        * max(entry["frames"], 1))
+      for name, options, for_trajectory, for_file in ENGINES :
+        if engines and name not in engines :
+          continue
+        if not (for_trajectory if trajectory else for_file) :
+          continue
+        options = [o.format(cache=cache) for o in options]
+        for n in (workers if trajectory else [1]) :
+          command = command_for(program, directory, entry, options, n)
+          times = time_combination(command, runs, warmup)
+          peak = peak_rss(command, scratch)
+          median = percentile(times, 50)
+          row = { "input": entry["name"], "engine": name, "workers": n,
+            "runs": runs, "residues": residues,
+            "median_s": round(median, 6),
+            "p95_s": round(percentile(times, 95), 6),
+            "min_s": round(min(times), 6),
+            "residues_per_s": round(residues / median, 1),
+            "peak_rss_kb": peak }
+          results.append(row)
+          print("%-11s %-9s %2d  median %9.4f s  p95 %9.4f s  "
+            "%11.0f residues/s  %8d KB" % (row["input"], name, n,
+            median, row["p95_s"], row["residues_per_s"], peak))
+          sys.stdout.flush()
+  finally :
+    shutil.rmtree(scratch, ignore_errors=True)
+  return manifest, results
+
+def version_of (program) :
+  """
+  The git revision of the source tree, if there is one.
+  """
+  try :
+    with open(os.devnull, "w") as null :
+      out = subprocess.check_output(["git", "describe", "--always",
+        "--dirty"], cwd=here, stderr=null)
+    return out.decode("ascii").strip()
+  except (OSError, subprocess.CalledProcessError) :
+    return None
+
+def write_results (prefix, program, manifest, results, runs, warmup) :
+  with open(prefix + ".csv", "w") as f :
+    writer = csv.DictWriter(f, COLUMNS, lineterminator="\n")
+    writer.writeheader()
+    writer.writerows(results)
+  report = {
+    "program": os.path.abspath(program),
+    "revision": version_of(program),
+    "date": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+    "host": { "platform": platform.platform(),
+      "processor": platform.processor() or platform.machine(),
+      "cpus": os.sysconf("SC_NPROCESSORS_ONLN") },
+    "corpus": { "version": manifest["version"], "seed": manifest["seed"] },
+    "runs": runs,
+    "warmup": warmup,
+    "results": results,
+  }
+  with open(prefix + ".json", "w") as f :
+    json.dump(report, f, indent=2, sort_keys=True)
+    f.write("\n")
+
+def split (value) :
+  return [v for v in value.split(",") if v]
+
+def main (args) :
+  program = os.path.join(here, os.pardir, "ksdssp_src", "ksdssp")
+  directory = "bench_corpus"
+  inputs = engines = None
+  workers = [1, 2, 4]
+  runs = 5
+  warmup = 1
+  prefix = "bench"
+  try :
+    opts, args = getopt.getopt(args, "x:d:i:e:j:n:w:o:")
+    if args :
+      raise getopt.GetoptError("unexpected argument %s" % args[0])
+    for opt, value in opts :
+      if opt == "-x" : program = value
+      elif opt == "-d" : directory = value
+      elif opt == "-i" : inputs = split(value)
+      elif opt == "-e" : engines = split(value)
+      elif opt == "-j" : workers = [int(v) for v in split(value)]
+      elif opt == "-n" : runs = int(value)
+      elif opt == "-w" : warmup = int(value)
+      elif opt == "-o" : prefix = value
+    if runs < 1 or warmup < 0 or not workers or min(workers) < 1 :
+      raise ValueError("bad count")
+  except (getopt.GetoptError, ValueError) as e :
+    print("%s\n%s" % (e, __doc__.strip()[__doc__.strip().index("usage"):]),
+      file=sys.stderr)
+    return 2
+  if not os.access(program, os.X_OK) :
+    print("%s: not an executable program" % program, file=sys.stderr)
+    return 1
+  manifest, results = run(program, directory, inputs, engines, workers,
+    runs, warmup)
+  write_results(prefix, program, manifest, results, runs, warmup)
+  print("wrote %s.csv and %s.json" % (prefix, prefix))
+  return 0
+
+if __name__ == "__main__" :
+  sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,570 @@
+"""
+Generate a PDB file of any size from ideal backbone motifs whose
+secondary structure is known by construction, for scaling benchmarks
+and correctness checks of ksdssp.
+
+usage: python synth.py [options] output.pdb
+
+  -n residues  number of residues (default 1000)
+  -m motifs    comma separated motifs to cycle through (default all
+               but tail: alpha,310,anti,para,barrel,bulge,dimer)
+  -c chains    spread the motifs over this many chains (default 1)
+  -t           end each chain with a TER record, so that ksdssp
+               assigns each one separately
+  -e file      write the expected secondary structure to file
+  -x program   run ksdssp program on the output and compare its
+               records with the expected secondary structure (exits
+               with status 1 if they differ)
+
+The motifs are:
+
+  alpha   an 18 residue alpha helix
+  310     a 12 residue 3-10 helix
+  anti    a four stranded antiparallel sheet (strands of 7 residues)
+  para    a four stranded parallel sheet (strands of 7 residues)
+  barrel  a twelve stranded antiparallel barrel, whose ladders form a
+          cycle (strands of 9 residues)
+  bulge   a two stranded antiparallel sheet with a classic beta bulge:
+          an extra residue in one strand
+  dimer   a four stranded antiparallel sheet whose strands alternate
+          between two chains
+  tail    a twelve stranded antiparallel barrel cut to half its
+          height but for two neighbouring strands, with the other half
+          of the strand before them as a piece of chain of its own:
+          the barrel is entered through a strand that also pairs
+          outside it, and a two stranded sheet is split off it
+          (strands of 8 to 18 residues)
+
+Each copy of a motif is placed in its own cell of a cubic grid, far
+enough from the others that they cannot form hydrogen bonds, and any
+residues left over go into an isolated extended piece of chain.
+Every residue has an explicit imide H, so the breaks between the
+pieces of chain in a motif do not affect the assignment.
+
+The expected secondary structure of each motif is derived from the
+hydrogen bonds of its ideal coordinates with the definitions of
+Kabsch and Sander as ksdssp applies them (turns and helices, bridges,
+ladders, beta bulges and sheets), and is the same for every copy.
+The expected file has a line for each helix
+
+  HELIX  first_residue  last_residue  class
+
+and each strand
+
+  STRAND first_residue  last_residue
+
+(residues as chain identifier, number and insertion code), followed by
+a line giving the number of sheets and how many of them are cyclic.
+"""
+
+from __future__ import division, print_function
+
+import getopt, os, subprocess, sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import backbone
+
+# Space (angstroms) left between the copies of the motifs
+MARGIN = 8.0
+
+def motif_pieces (name) :
+  """
+  The pieces of chain of a motif, each with the chain (0 or 1 within
+  the motif) it belongs to.
+  """
+  if name == "alpha" :
+    return [(0, backbone.helix(18, hydrogens=True))]
+  if name == "310" :
+    return [(0, backbone.helix(12, backbone.THREE_TEN, hydrogens=True))]
+  if name == "anti" :
+    return [(0, s) for s in backbone.antiparallel_sheet(4, 7, True)]
+  if name == "para" :
+    return [(0, s) for s in backbone.parallel_sheet(4, 7, True)]
+  if name == "barrel" :
+    return [(0, s) for s in backbone.barrel(12, 9, True)]
+  if name == "bulge" :
+    # The partner strand is split, and a residue out of the sheet is
+    # inserted between its halves
+    a, b = backbone.antiparallel_sheet(2, 9, True)
+    extra = backbone.shift(b[4:5], [0.0, 0.0, 12.0])
+    return [(0, a), (0, b[:4]), (0, extra), (0, b[4:])]
+  if name == "tail" :
+    # The pieces of the cut strand come first, so that the sheet is
+    # marked from outside the barrel
+    strands = backbone.barrel(12, 18, True)
+    xs = [a[0] for s in strands for r in s for a in r]
+    mid = (min(xs) + max(xs)) / 2
+    half = lambda s, low : [r for r in s if (r[1][0] < mid) == low]
+    return [(0, half(strands[11], False)), (0, strands[0]),
+      (0, strands[1])] + [(0, half(s, True)) for s in strands[2:]]
+  if name == "dimer" :
+    sheet = backbone.antiparallel_sheet(4, 7, True)
+    return [(k % 2, s) for k, s in enumerate(sheet)]
+  raise ValueError("unknown motif %s" % name)
+
+def filler (length) :
+  """
+  An isolated extended piece of chain, with no secondary structure.
+  """
+  if length == 1 :
+    return [(0, backbone.chain([backbone.ANTIPARALLEL], hydrogens=True))]
+  return [(0, backbone.strand(length, hydrogens=True))]
+
+#
+# Reference assignment
+#
+
+def hbonds (residues) :
+  """
+  The set of hydrogen bonds (acceptor, donor) between residues (None
+  for residues that bond with nothing), found as ksdssp does: pairs of
+  residues not adjacent in sequence whose C and N atoms are within 7
+  angstroms and whose energy is below -0.5 kcal/mol.
+  """
+  bonds = set()
+  for i, a in enumerate(residues) :
+    if a is None :
+      continue
+    for j, d in enumerate(residues) :
+      if d is None or abs(i - j) < 2 :
+        continue
+      cn = backbone.sub(a[2], d[0])
+      if backbone.dot(cn, cn) > 49.0 :
+        continue
+      if backbone.hbond_energy(a, d, None) < -0.5 :
+        bonds.add((i, j))
+  return bonds
+
+class Ladder (object) :
+  def __init__ (self, kind, s0, e0, s1, e1) :
+    self.kind = kind
+    self.start = [min(s0, e0), min(s1, e1)]
+    self.end = [max(s0, e0), max(s1, e1)]
+    self.bulge = False
+    self.neighbor = [None, None]
+    self.sheet = None
+
+  def overlaps (self, other) :
+    for i in range(2) :
+      for j in range(2) :
+        if self.end[i] >= other.start[j] and other.end[j] >= self.start[i] :
+          return i, j
+    return None
+
+def merge_bulge (l1, l2) :
+  """
+  The ladder formed by l1 and l2 if they are linked by a beta bulge:
+  at most one extra residue on one strand and at most four on the
+  other.
+  """
+  if l1.kind != l2.kind :
+    return None
+  if l1.start[0] > l2.start[0] :
+    l1, l2 = l2, l1
+  d0 = l2.start[0] - l1.end[0]
+  if l1.kind == "P" :
+    d1 = l2.start[1] - l1.end[1]
+  else :
+    d1 = l1.start[1] - l2.end[1]
+  if not (0 <= d0 <= 4 and 0 <= d1 <= 4) or (d0 > 1 and d1 > 1) :
+    return None
+  if l1.kind == "P" :
+    l = Ladder("P", l1.start[0], l2.end[0], l1.start[1], l2.end[1])
+  else :
+    l = Ladder("A", l1.start[0], l2.end[0], l2.start[1], l1.end[1])
+  l.bulge = True
+  return l
+
+def sides_overlap (l1, s1, l2, s2) :
+  """
+  Whether side s1 of ladder l1 and side s2 of ladder l2 share residues.
+  """
+  return l1.end[s1] >= l2.start[s2] and l2.end[s2] >= l1.start[s1]
+
+def distinct_strands (ring, last_side, first_side) :
+  """
+  Whether the strands of a ring of ladders, closed by linking side
+  last_side of the last with side first_side of the first, share no
+  residues.  Each strand spans the sides of the two ladders it links.
+  """
+  strands = []
+  for i, l in enumerate(ring) :
+    following = ring[(i + 1) % len(ring)]
+    if i == len(ring) - 1 :
+      s, fs = last_side, first_side
+    else :
+      s, fs = l.neighbor.index(following), following.neighbor.index(l)
+    strands.append((min(l.start[s], following.start[fs]),
+                    max(l.end[s], following.end[fs])))
+  for i in range(len(strands)) :
+    for k in range(i + 1, len(strands)) :
+      if strands[i][1] >= strands[k][0] and strands[k][1] >= strands[i][0] :
+        return False
+  return True
+
+def close_barrel (sheet) :
+  """
+  Close a barrel as ksdssp does (Sheet::closeBarrel): link the ends of
+  the chain of ladders if they overlap on their free sides, or else an
+  end to a ladder further along that it overlaps on the side linking
+  that ladder back, cutting off the ladders before it, provided the
+  strands of the cycle are distinct.  Returns the ladders cut off as a
+  new sheet, or None.
+  """
+  ends = [l for l in sheet if l.neighbor.count(None) == 1]
+  if len(sheet) < 3 or not ends :
+    return None
+  chain = []
+  previous, l = None, ends[0]
+  while l is not None and len(chain) < len(sheet) :
+    chain.append(l)
+    following = l.neighbor[1] if l.neighbor[0] is previous else l.neighbor[0]
+    previous, l = l, following
+  if len(chain) != len(sheet) :
+    return None
+  for chain in (chain, chain[::-1]) :
+    end = chain[-1]
+    side = end.neighbor.index(None)
+    for i in range(len(chain) - 2) :
+      l = chain[i]
+      for lside in range(2) :
+        if not sides_overlap(end, side, l, lside) :
+          continue
+        cut = chain[i - 1] if i > 0 else None
+        if l.neighbor[lside] is not cut :
+          continue
+        if not distinct_strands(chain[i:], side, lside) :
+          continue
+        tail = None
+        if cut is not None :
+          cside = cut.neighbor.index(l)
+          if sides_overlap(end, side, cut, cside) :
+            continue
+          cut.neighbor[cside] = None
+          tail = chain[:i]
+          for t in tail :
+            sheet.remove(t)
+            t.sheet = tail
+        l.neighbor[lside] = end
+        end.neighbor[side] = l
+        return tail
+  return None
+
+def reference_assignment (residues, min_length=3) :
+  """
+  Assign secondary structure to residues (with None for the residues
+  of a segment outside them, which bond with nothing) following the
+  steps of ksdssp.  Returns the helices as (first, last, class), the
+  strands as (first, last), the number of sheets and the number of
+  cyclic sheets, with residues given by index.
+  """
+  count = len(residues)
+  bonds = hbonds(residues)
+  hb = lambda a, d : (a, d) in bonds
+
+  # Helices: consecutive n-turns mark the residues after the first
+  flags = [set() for r in residues]
+  for n in (3, 4) :
+    for i in range(1, count - n) :
+      if hb(i - 1, i - 1 + n) and hb(i, i + n) :
+        for k in range(n) :
+          flags[i + k].add(n)
+  helices = []
+  first = None
+  for i in range(count + 1) :
+    if i < count and flags[i] :
+      if first is None :
+        first = i
+    elif first is not None :
+      if i - first >= min_length :
+        helices.append((first, i - 1, 1 if 4 in flags[first] else 5))
+      first = None
+
+  # Bridges, from the candidates each bond gives
+  candidates = set()
+  for a, d in bonds :
+    for i, j in ((a + 1, d), (a, d), (a + 1, d - 1)) :
+      i, j = min(i, j), max(i, j)
+      if i >= 1 and j < count and i != j :
+        candidates.add((i, j))
+  bridges = {}
+  for i, j in candidates :
+    if (hb(i - 1, j) and hb(j, i + 1)) or (hb(j - 1, i) and hb(i, j + 1)) :
+      bridges[(i, j)] = "P"
+    elif (hb(i, j) and hb(j, i)) or (hb(i - 1, j + 1) and hb(j - 1, i + 1)) :
+      bridges[(i, j)] = "A"
+
+  # Ladders of consecutive bridges
+  ladders = []
+  used = set()
+  for i, j in sorted(bridges) :
+    kind = bridges[(i, j)]
+    if (i, j) in used :
+      continue
+    step = 1 if kind == "P" else -1
+    k = 0
+    while bridges.get((i + k, j + step * k)) == kind :
+      used.add((i + k, j + step * k))
+      k += 1
+    ladders.append(Ladder(kind, i, i + k - 1, j + step * (k - 1), j))
+
+  # Merge ladders across beta bulges, in the order ksdssp does
+  p = 0
+  while p < len(ladders) :
+    l1 = ladders[p]
+    following = ladders[p + 1] if p + 1 < len(ladders) else None
+    if not l1.bulge :
+      for q in range(p + 1, len(ladders)) :
+        l2 = ladders[q]
+        if l2.bulge :
+          continue
+        l = merge_bulge(l1, l2)
+        if l is not None :
+          if following is l2 :
+            following = ladders[q + 1] if q + 1 < len(ladders) else None
+          ladders.remove(l1)
+          ladders.remove(l2)
+          ladders.append(l)
+          break
+    p = ladders.index(following) if following is not None else len(ladders)
+  ladders = [l for l in ladders if l.end[0] - l.start[0] + 1 >= min_length
+    and l.end[1] - l.start[1] + 1 >= min_length]
+
+  # Sheets of ladders that share residues
+  def mark (ladder, sheet) :
+    ladder.sheet = sheet
+    sheet.append(ladder)
+    for l in ladders :
+      if l.sheet is not None :
+        continue
+      overlap = l.overlaps(ladder)
+      if overlap is None or l.neighbor[overlap[0]] is not None \
+          or ladder.neighbor[overlap[1]] is not None :
+        continue
+      l.neighbor[overlap[0]] = ladder
+      ladder.neighbor[overlap[1]] = l
+      mark(l, sheet)
+  sheets = []
+  for l in ladders :
+    if l.sheet is None :
+      sheets.append([])
+      mark(l, sheets[-1])
+      tail = close_barrel(sheets[-1])
+      if tail is not None :
+        sheets.append(tail)
+  cyclic = len([s for s in sheets
+    if all(l.neighbor[0] is not None and l.neighbor[1] is not None
+      for l in s)])
+
+  # Strands: each side of a ladder, joined with the side of the ladder
+  # next to it in the sheet
+  strands = set()
+  for l in ladders :
+    for side in range(2) :
+      first, last = l.start[side], l.end[side]
+      other = l.neighbor[side]
+      if other is not None :
+        for t in range(2) :
+          if other.end[t] >= first and last >= other.start[t] :
+            first = min(first, other.start[t])
+            last = max(last, other.end[t])
+      strands.add((first, last))
+  return helices, sorted(strands), len(sheets), cyclic
+
+#
+# Generation
+#
+
+class Motif (object) :
+  """
+  A motif moved to the origin, with its expected secondary structure
+  (depending on whether it starts or ends a segment).
+  """
+  def __init__ (self, name, pieces) :
+    self.name = name
+    atoms = [a for slot, piece in pieces for r in piece for a in r]
+    low = [min(a[d] for a in atoms) for d in range(3)]
+    self.extent = [max(a[d] for a in atoms) - low[d] for d in range(3)]
+    self.pieces = [(slot, backbone.shift(piece, backbone.scale(low, -1)))
+      for slot, piece in sorted(pieces, key=lambda p : p[0])]
+    self.residues = sum(len(piece) for slot, piece in pieces)
+    self._expected = {}
+
+  def expected (self, starts, ends) :
+    key = (starts, ends)
+    if key not in self._expected :
+      residues = [r for slot, piece in self.pieces for r in piece]
+      # Residues of the segment before and after, which bond with
+      # nothing in the motif
+      residues = ([] if starts else [None]) + residues + \
+        ([] if ends else [None])
+      helices, strands, sheets, cyclic = reference_assignment(residues)
+      offset = 0 if starts else 1
+      self._expected[key] = (
+        [(f - offset, l - offset, c) for f, l, c in helices],
+        [(f - offset, l - offset) for f, l in strands], sheets, cyclic)
+    return self._expected[key]
+
+def layout (names, total, chains) :
+  """
+  The motifs (names cycled through) and filler making up total
+  residues, and the chain of each.
+  """
+  motifs = {}
+  plan = []
+  residues = 0
+  while True :
+    name = names[len(plan) % len(names)]
+    if name not in motifs :
+      motifs[name] = Motif(name, motif_pieces(name))
+    m = motifs[name]
+    if residues + m.residues > total :
+      break
+    plan.append(m)
+    residues += m.residues
+  if residues < total :
+    plan.append(Motif("filler", filler(total - residues)))
+  return [(m, k * chains // len(plan)) for k, m in enumerate(plan)]
+
+def generate (output, total, names, chains, ter) :
+  """
+  Write the structure to output, and return its expected helices,
+  strands and numbers of sheets and cyclic sheets (with residues
+  given by identifier).
+  """
+  plan = layout(names, total, chains)
+  cell = max(max(m.extent) for m, chain in plan) + MARGIN
+  side = 1
+  while side ** 3 < len(plan) :
+    side += 1
+  # The second chain of a motif is written with identifiers of its own
+  writer = backbone.Writer(output, 0, 2)
+  partner = backbone.Writer(output, 1, 2)
+  helices = []
+  strands = []
+  sheets = cyclic = 0
+  for k, (m, chain) in enumerate(plan) :
+    starts = k == 0 or (ter and plan[k - 1][1] != chain)
+    ends = k == len(plan) - 1 or (ter and plan[k + 1][1] != chain)
+    if k > 0 and plan[k - 1][1] != chain :
+      writer.new_chain()
+    t = [cell * (k % side), cell * (k // side % side),
+      cell * (k // (side * side))]
+    ids = []
+    for s, piece in m.pieces :
+      w = partner if s else writer
+      w.serial = max(writer.serial, partner.serial)
+      ids += w.piece(backbone.shift(piece, t))
+    h, s, n, c = m.expected(starts, ends)
+    helices += [(ids[f], ids[l], hc) for f, l, hc in h]
+    strands += [(ids[f], ids[l]) for f, l in s]
+    sheets += n
+    cyclic += c
+    if ends and ter :
+      writer.ter()
+  if not ter :
+    writer.ter()
+  output.write("END\n")
+  return helices, strands, sheets, cyclic
+
+def residue_id (r) :
+  return "%s%4d%s" % r
+
+def write_expected (path, expected) :
+  helices, strands, sheets, cyclic = expected
+  with open(path, "w") as f :
+    for first, last, c in helices :
+      f.write("HELIX  %s  %s  %d\n" % (residue_id(first), residue_id(last),
+        c))
+    for first, last in strands :
+      f.write("STRAND %s  %s\n" % (residue_id(first), residue_id(last)))
+    f.write("SHEETS %d CYCLIC %d\n" % (sheets, cyclic))
+
+def assigned (lines) :
+  """
+  The helices, strands and numbers of sheets and cyclic sheets in
+  ksdssp output.
+  """
+  helices = []
+  strands = set()
+  sheets = cyclic = 0
+  last = None
+  for line in lines :
+    if line.startswith("HELIX ") :
+      helices.append(((line[19], int(line[21:25]), line[25]),
+        (line[31], int(line[33:37]), line[37]), int(line[38:40])))
+    elif line.startswith("SHEET ") :
+      number = int(line[7:10])
+      sheet = (line[11:14], int(line[14:16]))
+      if number == 1 :
+        # The first strand of a cyclic sheet is repeated at its end
+        if last is not None and last[0] == sheet and last[1] == sheet[1] :
+          cyclic += 1
+        else :
+          sheets += 1
+      strands.add(((line[21], int(line[22:26]), line[26]),
+        (line[32], int(line[33:37]), line[37])))
+      last = (sheet, number)
+  return helices, sorted(strands), sheets, cyclic
+
+def check (program, path, expected) :
+  """
+  Run program on path and report the differences between its records
+  and the expected secondary structure.  Returns the number of
+  differences.
+  """
+  output = subprocess.check_output([program, path])
+  found = assigned(output.decode("ascii").splitlines())
+  differences = 0
+  for kind, k in (("helix", 0), ("strand", 1)) :
+    want = set(expected[k])
+    got = set(found[k])
+    for item in sorted(want - got) :
+      print("missing %s %s" % (kind, " ".join(map(str, item))))
+    for item in sorted(got - want) :
+      print("unexpected %s %s" % (kind, " ".join(map(str, item))))
+    differences += len(want ^ got)
+  if found[2:] != tuple(expected[2:]) :
+    print("%d sheets (%d cyclic), expected %d (%d cyclic)" % (found[2],
+      found[3], expected[2], expected[3]))
+    differences += 1
+  print("%s: %d helices, %d strands, %d sheets (%d cyclic): %s" % (path,
+    len(found[0]), len(found[1]), found[2], found[3],
+    "%d differences" % differences if differences else "as expected"))
+  return differences
+
+def main (args) :
+  total = 1000
+  names = ["alpha", "310", "anti", "para", "barrel", "bulge", "dimer"]
+  chains = 1
+  ter = False
+  expected_path = program = None
+  usage = __doc__[__doc__.index("usage"):__doc__.index("The motifs")]
+  try :
+    opts, args = getopt.getopt(args, "n:m:c:te:x:")
+    if len(args) != 1 :
+      raise getopt.GetoptError("one output file is needed")
+    for opt, value in opts :
+      if opt == "-n" : total = int(value)
+      elif opt == "-m" : names = [v for v in value.split(",") if v]
+      elif opt == "-c" : chains = int(value)
+      elif opt == "-t" : ter = True
+      elif opt == "-e" : expected_path = value
+      elif opt == "-x" : program = value
+    if total < 1 or chains < 1 or not names :
+      raise ValueError("bad count")
+    for name in names :
+      motif_pieces(name)
+  except (getopt.GetoptError, ValueError) as e :
+    print("%s\n%s" % (e, usage.strip()), file=sys.stderr)
+    return 2
+  with open(args[0], "w") as f :
+    expected = generate(f, total, names, chains, ter)
+  if expected_path is not None :
+    write_expected(expected_path, expected)
+  if program is not None and check(program, args[0], expected) > 0 :
+    return 1
+  return 0
+
+if __name__ == "__main__" :
+  sys.exit(main(sys.argv[1:]))
@@ -1,8 +1,15 @@
+from __future__ import print_function
+
 import libtbx.load_env
 from libtbx.utils import Usage
-import os, sys, subprocess
+import getopt, os, sys, subprocess
+
+# Options handled in-process by ksdssp_ext; anything else (trajectories,
+# summaries, MTRIX expansion, ...) is passed to the ksdssp executable
+in_process_options = "c:h:s:B"
+all_options = "b:c:e:h:i:j:k:s:t:vBMR:S:T:"
 
-def run(args):
+def run_executable (args) :
   exe = libtbx.env.under_build("ksdssp/exe/ksdssp")
   if (os.name == "nt"):
     exe += ".exe"
@@ -10,9 +17,40 @@ def run(args):
     from libtbx.str_utils import show_string
     from libtbx.utils import Sorry
     raise Sorry("Missing phenix.ksdssp executable: %s" % show_string(exe))
-  if len(args) == 0 or not os.path.isfile(args[0]) :
+  return subprocess.call([exe] + args)
+
+def run(args, out=sys.stdout):
+  try :
+    opts, files = getopt.getopt(args, all_options)
+  except getopt.GetoptError :
+    return run_executable(args)
+  if [ o for o, v in opts if o[1] not in in_process_options ] :
+    return run_executable(args)
+  if len(files) == 0 or not os.path.isfile(files[0]) :
     raise Usage("phenix.ksdssp model.pdb")
-  subprocess.call([exe] + args)
+  if len(files) > 1 :
+    return run_executable(args)
+  try :
+    import ksdssp_ext
+  except ImportError :
+    return run_executable(args)
+  options = {}
+  for o, v in opts :
+    if o == "-c" :
+      options["hbond_cutoff"] = float(v)
+    elif o == "-h" :
+      options["min_helix_length"] = int(v)
+    elif o == "-s" :
+      options["min_strand_length"] = int(v)
+    elif o == "-B" :
+      options["ignore_bulges"] = True
+  try :
+    records = ksdssp_ext.records(file_name=files[0], **options)
+  except (IOError, ValueError) as e :
+    from libtbx.utils import Sorry
+    raise Sorry(str(e))
+  out.write(records)
+  return 0
 
 if (__name__ == "__main__"):
   run(sys.argv[1:])
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+//
+// Replacement global allocation functions that count the memory
+// allocated by each thread while StageTimes::countMemory is set (-u).
+// Only the ksdssp program is linked with this file; the library and
+// the Python extension keep the allocator of their host.
+//
+
+#include <stdlib.h>
+#include <new>
+#include "Timings.h"
+
+static void *
+allocate(size_t size)
+{
+	if (StageTimes::countMemory) {
+		StageTimes::allocatedBytes += size;
+		StageTimes::allocationCount++;
+	}
+	void *p = malloc(size > 0 ? size : 1);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *
+operator new(size_t size)
+{
+	return allocate(size);
+}
+
+void *
+operator new[](size_t size)
+{
+	return allocate(size);
+}
+
+void
+operator delete(void *p) throw()
+{
+	free(p);
+}
+
+void
+operator delete[](void *p) throw()
+{
+	free(p);
+}
+
+//
+// The sized forms (called from C++14 on) are replaced as well, so that
+// every deallocation goes through the functions above
+//
+void
+operator delete(void *p, size_t) throw()
+{
+	operator delete(p);
+}
+
+void
+operator delete[](void *p, size_t) throw()
+{
+	operator delete[](p);
+}
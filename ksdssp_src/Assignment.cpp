@@ -0,0 +1,384 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "ksdssp.h"
+#include "Assignment.h"
+#include "Model.h"
+#include "Topology.h"
+
+//
+// Constructor for Assignment (no residues)
+//
+Assignment::Assignment(void) : error_()
+{
+	residueCount_ = 0;
+	codes_ = NULL;
+	helixCount_ = ladderCount_ = sheetCount_ = strandCount_ = 0;
+	helix_ = NULL;
+	ladder_ = NULL;
+	sheet_ = NULL;
+	strand_ = NULL;
+}
+
+//
+// Destructor for Assignment
+//
+Assignment::~Assignment(void)
+{
+	clear();
+}
+
+//
+// Discard the results of the last assignment
+//
+void
+Assignment::clear(void)
+{
+	error_ = "";
+	delete [] codes_;
+	delete [] helix_;
+	delete [] ladder_;
+	delete [] sheet_;
+	delete [] strand_;
+	residueCount_ = 0;
+	codes_ = NULL;
+	helixCount_ = ladderCount_ = sheetCount_ = strandCount_ = 0;
+	helix_ = NULL;
+	ladder_ = NULL;
+	sheet_ = NULL;
+	strand_ = NULL;
+}
+
+//
+// Assign secondary structure to count residues (see Assignment.h
+// for the layout of xyz and atoms), replacing any previous results.
+// Returns 0 on success, -1 (with error set) otherwise.
+//
+int
+Assignment::assign(const SSResidue *residues, const float *xyz,
+			const int *atoms, int count, const SSOptions &options)
+{
+	clear();
+	if (count < 1 || residues == NULL || xyz == NULL) {
+		error_ = "no residues given";
+		return -1;
+	}
+	Model *m = makeModel(residues, xyz, atoms, count);
+	m->setOptions(options, 0);
+	int status = assign(*m);
+	delete m;
+	return status;
+}
+
+//
+// Assign secondary structure to a model with its own settings
+// (see Model::setOptions), replacing any previous results.
+// Returns 0 on success, -1 (with error set) otherwise.
+//
+int
+Assignment::assign(Model &m)
+{
+	clear();
+	if (m.residueCount() < 1) {
+		error_ = "no residues given";
+		return -1;
+	}
+	m.defineSecondaryStructure();
+	collect(m);
+	return 0;
+}
+
+//
+// Take the results of a model whose secondary structure has been
+// defined, replacing any previous results
+//
+void
+Assignment::collect(const Model &m)
+{
+	clear();
+	int count = m.residueCount();
+	residueCount_ = count;
+	codes_ = new char[count];
+	m.summaryCodes(codes_);
+
+	const List<Helix> &hl = m.helixList();
+	helixCount_ = hl.count();
+	helix_ = new SSHelix[helixCount_ > 0 ? helixCount_ : 1];
+	int i = 0;
+	Pix p;
+	for (p = hl.first(); p != 0; hl.next(p), i++) {
+		const Helix *h = hl(p);
+		helix_[i].from = h->from();
+		helix_[i].to = h->to();
+		helix_[i].type = h->type();
+	}
+
+	// Each sheet has at most one strand more than it has ladders
+	const List<Sheet> &sl = m.sheetList();
+	sheetCount_ = sl.count();
+	sheet_ = new SSSheet[sheetCount_ > 0 ? sheetCount_ : 1];
+	Sheet **sheets = new Sheet *[sheetCount_ > 0 ? sheetCount_ : 1];
+	int maxStrands = 0;
+	for (p = sl.first(); p != 0; sl.next(p))
+		maxStrands += sl(p)->ladderList().count() + 1;
+	strand_ = new Strand[maxStrands > 0 ? maxStrands : 1];
+	i = 0;
+	for (p = sl.first(); p != 0; sl.next(p), i++) {
+		SSSheet &s = sheet_[i];
+		sheets[i] = sl(p);
+		s.firstStrand = strandCount_;
+		s.strandCount = m.sheetStrands(sheets[i],
+				strand_ + strandCount_, &s.cyclic);
+		strandCount_ += s.strandCount;
+	}
+
+	const List<Ladder> &ll = m.ladderList();
+	ladderCount_ = ll.count();
+	ladder_ = new SSLadder[ladderCount_ > 0 ? ladderCount_ : 1];
+	i = 0;
+	for (p = ll.first(); p != 0; ll.next(p), i++) {
+		const Ladder *l = ll(p);
+		SSLadder &out = ladder_[i];
+		out.parallel = l->type() == B_PARA;
+		for (int k = 0; k < 2; k++) {
+			out.start[k] = l->start(k);
+			out.end[k] = l->end(k);
+		}
+		out.sheet = -1;
+		for (int s = 0; s < sheetCount_; s++)
+			if (sheets[s] == l->sheet())
+				out.sheet = s;
+	}
+	delete [] sheets;
+}
+
+//
+// Stored form of the results (see write): a header of HEADER_SIZE
+// 32-bit integers in host byte order (magic, version and the residue,
+// helix, ladder, sheet and strand counts), the summary codes, then
+// the helices, ladders, sheets and strands as integers
+//
+static const int	MAGIC = 0x4153534b;	// "KSSA"
+static const int	VERSION = 1;
+static const int	HEADER_SIZE = 7;
+
+static int
+writeInts(FILE *f, const int *v, int count)
+{
+	return fwrite(v, sizeof v[0], count, f) == (size_t) count ? 0 : -1;
+}
+
+static int
+readInts(FILE *f, int *v, int count)
+{
+	return fread(v, sizeof v[0], count, f) == (size_t) count ? 0 : -1;
+}
+
+//
+// Write the results in their stored form
+// Returns 0 on success and -1 on a write error
+//
+int
+Assignment::write(FILE *f) const
+{
+	int header[HEADER_SIZE] = { MAGIC, VERSION, residueCount_,
+		helixCount_, ladderCount_, sheetCount_, strandCount_ };
+	if (writeInts(f, header, HEADER_SIZE) < 0)
+		return -1;
+	if (fwrite(codes_, 1, residueCount_, f) != (size_t) residueCount_)
+		return -1;
+	int i;
+	for (i = 0; i < helixCount_; i++) {
+		const SSHelix &h = helix_[i];
+		int v[3] = { h.from, h.to, h.type };
+		if (writeInts(f, v, 3) < 0)
+			return -1;
+	}
+	for (i = 0; i < ladderCount_; i++) {
+		const SSLadder &l = ladder_[i];
+		int v[6] = { l.parallel, l.start[0], l.end[0],
+					l.start[1], l.end[1], l.sheet };
+		if (writeInts(f, v, 6) < 0)
+			return -1;
+	}
+	for (i = 0; i < sheetCount_; i++) {
+		const SSSheet &s = sheet_[i];
+		int v[3] = { s.firstStrand, s.strandCount, s.cyclic };
+		if (writeInts(f, v, 3) < 0)
+			return -1;
+	}
+	for (i = 0; i < strandCount_; i++) {
+		const Strand &st = strand_[i];
+		int v[5] = { st.start, st.end, st.sense,
+					st.nResidue, st.oResidue };
+		if (writeInts(f, v, 5) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+//
+// Read results written by write, replacing any previous results.
+// Returns 0 on success, -1 (with error set) otherwise.
+//
+int
+Assignment::read(FILE *f)
+{
+	clear();
+	int header[HEADER_SIZE];
+	if (readInts(f, header, HEADER_SIZE) < 0 || header[0] != MAGIC
+	|| header[1] != VERSION) {
+		error_ = "not a stored assignment";
+		return -1;
+	}
+	int i;
+	for (i = 2; i < HEADER_SIZE; i++)
+		if (header[i] < 0 || header[i] > (1 << 26)) {
+			error_ = "corrupt stored assignment";
+			return -1;
+		}
+	residueCount_ = header[2];
+	helixCount_ = header[3];
+	ladderCount_ = header[4];
+	sheetCount_ = header[5];
+	strandCount_ = header[6];
+	codes_ = new char[residueCount_ > 0 ? residueCount_ : 1];
+	helix_ = new SSHelix[helixCount_ > 0 ? helixCount_ : 1];
+	ladder_ = new SSLadder[ladderCount_ > 0 ? ladderCount_ : 1];
+	sheet_ = new SSSheet[sheetCount_ > 0 ? sheetCount_ : 1];
+	strand_ = new Strand[strandCount_ > 0 ? strandCount_ : 1];
+	int bad = fread(codes_, 1, residueCount_, f) != (size_t) residueCount_;
+	for (i = 0; !bad && i < helixCount_; i++) {
+		SSHelix &h = helix_[i];
+		int v[3];
+		bad = readInts(f, v, 3) < 0 || v[0] < 0 || v[1] < v[0]
+						|| v[1] >= residueCount_;
+		h.from = v[0];
+		h.to = v[1];
+		h.type = v[2];
+	}
+	for (i = 0; !bad && i < ladderCount_; i++) {
+		SSLadder &l = ladder_[i];
+		int v[6];
+		bad = readInts(f, v, 6) < 0 || v[5] >= sheetCount_;
+		l.parallel = v[0];
+		l.start[0] = v[1];
+		l.end[0] = v[2];
+		l.start[1] = v[3];
+		l.end[1] = v[4];
+		l.sheet = v[5];
+	}
+	for (i = 0; !bad && i < sheetCount_; i++) {
+		SSSheet &s = sheet_[i];
+		int v[3];
+		bad = readInts(f, v, 3) < 0 || v[0] < 0 || v[1] < 1
+					|| v[0] + v[1] > strandCount_;
+		s.firstStrand = v[0];
+		s.strandCount = v[1];
+		s.cyclic = v[2];
+	}
+	for (i = 0; !bad && i < strandCount_; i++) {
+		Strand &st = strand_[i];
+		int v[5];
+		bad = readInts(f, v, 5) < 0;
+		// The first strand of a sheet may have no registration (-1)
+		for (int k = 0; !bad && k < 5; k++)
+			if (k != 2 && (v[k] < (k < 2 ? 0 : -1)
+						|| v[k] >= residueCount_))
+				bad = 1;
+		st.start = v[0];
+		st.end = v[1];
+		st.sense = v[2];
+		st.nResidue = v[3];
+		st.oResidue = v[4];
+	}
+	if (bad) {
+		clear();
+		error_ = "corrupt stored assignment";
+		return -1;
+	}
+	return 0;
+}
+
+//
+// Create the model (without secondary structure) for count residues
+// laid out as for assign
+//
+Model *
+Assignment::makeModel(const SSResidue *residues, const float *xyz,
+						const int *atoms, int count)
+{
+	// Atom indices are positions in xyz
+	Topology *t = new Topology;
+	for (int i = 0; i < count; i++) {
+		const SSResidue &r = residues[i];
+		PDB::Residue id;
+		(void) memset(&id, 0, sizeof id);
+		(void) strncpy(id.name, r.name, sizeof id.name - 1);
+		id.chainId = r.chainId == '\0' ? ' ' : r.chainId;
+		id.seqNum = r.seqNum;
+		id.insertCode = r.insertCode == '\0' ? ' ' : r.insertCode;
+		t->addResidue(id);
+		int present = atoms != NULL ? atoms[i] : (1 << A_N)
+				| (1 << A_CA) | (1 << A_C) | (1 << A_O);
+		for (int slot = 0; slot < A_COUNT; slot++)
+			if (present & (1 << slot))
+				t->addAtom(slot, A_COUNT * i + slot);
+		if (r.flags & SS_CHAIN_END)
+			t->setFlag(R_TER);
+	}
+	t->complete();
+	Model *m = new Model(t, xyz);
+	t->unref();
+	return m;
+}
+
+//
+// Unpack count residue records (see SS_RECORD_SIZE) into residues
+// and atoms
+//
+void
+Assignment::unpackRecords(const char *records, int count,
+					SSResidue *residues, int *atoms)
+{
+	const char *r = records;
+	for (int i = 0; i < count; i++, r += SS_RECORD_SIZE) {
+		SSResidue &res = residues[i];
+		(void) memcpy(res.name, r, 4);
+		res.name[3] = '\0';
+		res.chainId = r[4];
+		res.insertCode = r[5];
+		res.flags = (unsigned char) r[6];
+		atoms[i] = (unsigned char) r[7];
+		(void) memcpy(&res.seqNum, r + 8, sizeof res.seqNum);
+	}
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef assignment_h
+#define assignment_h
+
+#include <stdio.h>
+#include <string>
+#include "Residue.h"
+#include "Structure.h"
+
+class Model;
+
+//
+// Library interface: secondary structure of residues given in memory.
+//
+// Each residue has A_COUNT atom slots (N, CA, C, O and the imide H, in
+// slots A_N through A_H); the coordinates are x, y and z of each slot,
+// A_COUNT slots per residue, and the atoms present in residue i are the
+// bits (1 << slot) of atoms[i] (N, CA, C and O if atoms is NULL).
+// Missing imide hydrogens are placed as for PDB input.  The results
+// refer to residues by their index.  Nothing is read from or written
+// to any file.
+//
+
+#define	SS_CHAIN_END	0x1	// last residue of its chain (as at TER)
+
+//
+// Packed form of a residue and its atoms, as used by the server and
+// shared memory protocols: name[4] (null-padded), chainId, insertCode,
+// flags and the atoms bit mask, one byte each, then seqNum as a 32-bit
+// integer in host byte order
+//
+#define	SS_RECORD_SIZE	12
+
+struct SSResidue {
+	char	name[4];		// residue name, null-terminated
+	char	chainId;
+	int	seqNum;
+	char	insertCode;
+	int	flags;
+};
+
+//
+// Assignment parameters (as for the -c, -h, -s and -B options); they
+// apply only to the model being assigned
+//
+struct SSOptions {
+	float	hBondCutoff;
+	int	minHelixLength;
+	int	minStrandLength;
+	int	checkBulges;
+		SSOptions(void)
+			{
+				hBondCutoff = -0.5;
+				minHelixLength = 3;
+				minStrandLength = 3;
+				checkBulges = 1;
+			}
+};
+
+struct SSHelix {
+	int	from, to;
+	int	type;			// PDB helix class
+};
+
+struct SSLadder {
+	int	parallel;
+	int	start[2], end[2];
+	int	sheet;
+};
+
+//
+// Sheet, with its strands (see Strand) in the order of SHEET records
+//
+struct SSSheet {
+	int	firstStrand;
+	int	strandCount;
+	int	cyclic;
+};
+
+class Assignment {
+	std::string	error_;
+	int		residueCount_;
+	char		*codes_;
+	int		helixCount_;
+	SSHelix		*helix_;
+	int		ladderCount_;
+	SSLadder	*ladder_;
+	int		sheetCount_;
+	SSSheet		*sheet_;
+	int		strandCount_;
+	Strand		*strand_;
+	void		clear(void);
+public:
+			Assignment(void);
+			~Assignment(void);
+	int		assign(const SSResidue *residues, const float *xyz,
+				const int *atoms, int count,
+				const SSOptions &options = SSOptions());
+	int		okay(void) const { return error_ == ""; }
+	const char	*error(void) const { return error_.c_str(); }
+	int		residueCount(void) const { return residueCount_; }
+	const char	*codes(void) const { return codes_; }
+	int		helixCount(void) const { return helixCount_; }
+	const SSHelix	&helix(int n) const { return helix_[n]; }
+	int		ladderCount(void) const { return ladderCount_; }
+	const SSLadder	&ladder(int n) const { return ladder_[n]; }
+	int		sheetCount(void) const { return sheetCount_; }
+	const SSSheet	&sheet(int n) const { return sheet_[n]; }
+	int		strandCount(void) const { return strandCount_; }
+	const Strand	&strand(int n) const { return strand_[n]; }
+	int		assign(Model &m);
+	void		collect(const Model &m);
+	int		write(FILE *f) const;
+	int		read(FILE *f);
+	static Model	*makeModel(const SSResidue *residues,
+				const float *xyz, const int *atoms, int count);
+	static void	unpackRecords(const char *records, int count,
+				SSResidue *residues, int *atoms);
+};
+
+#endif
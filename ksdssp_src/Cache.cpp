@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Cache.h"
+
+#ifndef NO_CACHE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef DONT_INSTANIATE
+template class List<CacheEntry>;
+#endif
+
+// Changes whenever the stored results or their meaning change
+static const char	KeyVersion[] = "ksdssp cache 3";
+
+//
+// Constructor for Cache (create the directory if need be)
+//
+Cache::Cache(const char *dir, long maxBytes, const SSOptions &options)
+	: error_(), dir_(dir), options_(options), entryList_()
+{
+	maxBytes_ = maxBytes;
+	hits_ = misses_ = 0;
+	struct stat st;
+	if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+		error_ = strerror(errno);
+	else if (stat(dir, &st) < 0)
+		error_ = strerror(errno);
+	else if (!S_ISDIR(st.st_mode))
+		error_ = "not a directory";
+}
+
+//
+// Destructor for Cache
+//
+Cache::~Cache(void)
+{
+	for (Pix p = entryList_.first(); p != 0; entryList_.next(p))
+		delete entryList_(p);
+}
+
+//
+// Return the path of the cache file for key
+//
+std::string
+Cache::path(const char *key) const
+{
+	return dir_ + "/" + key;
+}
+
+//
+// Return the cached results for a model (whose secondary structure
+// need not be defined), or NULL if there are none.  The key of the
+// model is returned in key, for store.
+//
+const Assignment *
+Cache::lookup(const Model &m, char key[CACHE_KEY_SIZE])
+{
+	Sha256 digest;
+	digest.update(KeyVersion, sizeof KeyVersion);
+	digest.update(&options_.hBondCutoff, sizeof options_.hBondCutoff);
+	digest.update(&options_.minHelixLength,
+					sizeof options_.minHelixLength);
+	digest.update(&options_.minStrandLength,
+					sizeof options_.minStrandLength);
+	digest.update(&options_.checkBulges, sizeof options_.checkBulges);
+	m.digestInput(digest);
+	unsigned char d[Sha256::DigestSize];
+	digest.final(d);
+	for (int i = 0; i < Sha256::DigestSize; i++)
+		(void) sprintf(key + 2 * i, "%02x", d[i]);
+
+	for (Pix p = entryList_.first(); p != 0; entryList_.next(p))
+		if (strcmp(entryList_(p)->key, key) == 0) {
+			hits_++;
+			return &entryList_(p)->result;
+		}
+
+	std::string file = path(key);
+	FILE *f = fopen(file.c_str(), "rb");
+	if (f == NULL) {
+		misses_++;
+		return NULL;
+	}
+	CacheEntry *e = new CacheEntry;
+	(void) strcpy(e->key, key);
+	int status = e->result.read(f);
+	(void) fclose(f);
+	if (status < 0 || e->result.residueCount() != m.residueCount()) {
+		if (verbose)
+			(void) fprintf(stderr, "%s: %s\n", file.c_str(),
+				status < 0 ? e->result.error()
+						: "wrong residue count");
+		delete e;
+		misses_++;
+		return NULL;
+	}
+	(void) utime(file.c_str(), NULL);
+	entryList_.append(e);
+	hits_++;
+	return &e->result;
+}
+
+//
+// Save the results of a model whose secondary structure has been
+// defined under key (from lookup), and return them.  The file is
+// written under a temporary name and then renamed, so that other
+// processes sharing the cache never see a partial file.
+//
+const Assignment *
+Cache::store(const char *key, const Model &m)
+{
+	CacheEntry *e = new CacheEntry;
+	(void) strcpy(e->key, key);
+	e->result.collect(m);
+	entryList_.append(e);
+
+	std::string file = path(key);
+	char suffix[32];
+	(void) sprintf(suffix, ".%ld.tmp", (long) getpid());
+	std::string temp = file + suffix;
+	FILE *f = fopen(temp.c_str(), "wb");
+	int status = -1;
+	if (f != NULL) {
+		status = e->result.write(f);
+		if (fclose(f) != 0)
+			status = -1;
+		if (status == 0 && rename(temp.c_str(), file.c_str()) < 0)
+			status = -1;
+		if (status < 0)
+			(void) unlink(temp.c_str());
+	}
+	if (status < 0 && verbose)
+		(void) fprintf(stderr, "%s: %s\n", file.c_str(),
+							strerror(errno));
+	return &e->result;
+}
+
+//
+// Cache file found by evict
+//
+struct CacheFile {
+	char		key[CACHE_KEY_SIZE];
+	long		size;
+	time_t		mtime;
+};
+
+static int
+cmpCacheFile(const void *a, const void *b)
+{
+	const CacheFile *fa = (const CacheFile *) a;
+	const CacheFile *fb = (const CacheFile *) b;
+	if (fa->mtime != fb->mtime)
+		return fa->mtime < fb->mtime ? -1 : 1;
+	return strcmp(fa->key, fb->key);
+}
+
+//
+// Remove the least recently used cache files until the cache is no
+// larger than its limit
+//
+void
+Cache::evict(void)
+{
+	DIR *d = opendir(dir_.c_str());
+	if (d == NULL)
+		return;
+	int size = 64;
+	int count = 0;
+	CacheFile *files = new CacheFile[size];
+	long total = 0;
+	struct dirent *de;
+	while ((de = readdir(d)) != NULL) {
+		if (strlen(de->d_name) != CACHE_KEY_SIZE - 1
+		|| strspn(de->d_name, "0123456789abcdef")
+							!= CACHE_KEY_SIZE - 1)
+			continue;
+		std::string file = path(de->d_name);
+		struct stat st;
+		if (stat(file.c_str(), &st) < 0 || !S_ISREG(st.st_mode))
+			continue;
+		if (count == size) {
+			CacheFile *f = new CacheFile[size * 2];
+			for (int i = 0; i < count; i++)
+				f[i] = files[i];
+			delete [] files;
+			files = f;
+			size *= 2;
+		}
+		(void) strcpy(files[count].key, de->d_name);
+		files[count].size = st.st_size;
+		files[count].mtime = st.st_mtime;
+		total += st.st_size;
+		count++;
+	}
+	(void) closedir(d);
+
+	if (total > maxBytes_) {
+		qsort(files, count, sizeof files[0], cmpCacheFile);
+		for (int i = 0; i < count && total > maxBytes_; i++)
+			if (unlink(path(files[i].key).c_str()) == 0)
+				total -= files[i].size;
+	}
+	delete [] files;
+}
+
+#endif
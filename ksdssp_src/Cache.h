@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef cache_h
+#define cache_h
+
+#include "ksdssp.h"
+
+#ifndef NO_CACHE
+
+#include <string>
+#include "Assignment.h"
+#include "List.h"
+#include "Model.h"
+#include "Sha256.h"
+
+//
+// On-disk cache of assignment results, one file per distinct input in
+// the cache directory, named by the SHA-256 digest (in hex) of the
+// assignment options and the model input (see Model::digestInput).
+// Results are kept in memory too, so models that repeat within a run
+// are assigned once.  Files found or written are given the current
+// modification time, and the least recently used files are removed
+// when the cache grows beyond its size limit.
+//
+#define	CACHE_KEY_SIZE	(2 * Sha256::DigestSize + 1)
+
+struct CacheEntry {
+	char		key[CACHE_KEY_SIZE];
+	Assignment	result;
+};
+
+class Cache {
+	std::string	error_;
+	std::string	dir_;
+	long		maxBytes_;
+	SSOptions	options_;
+	List<CacheEntry>
+			entryList_;
+	int		hits_;
+	int		misses_;
+	std::string	path(const char *key) const;
+public:
+			Cache(const char *dir, long maxBytes,
+						const SSOptions &options);
+			~Cache(void);
+	int		okay(void) const { return error_ == ""; }
+	const char	*error(void) const { return error_.c_str(); }
+	const Assignment
+			*lookup(const Model &m, char key[CACHE_KEY_SIZE]);
+	const Assignment
+			*store(const char *key, const Model &m);
+	void		evict(void);
+	int		hits(void) const { return hits_; }
+	int		misses(void) const { return misses_; }
+};
+
+#endif
+
+#endif
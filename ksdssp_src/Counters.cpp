@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Counters.h"
+
+#ifndef NO_PERF
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static const char	*EventName[HC_COUNT] = {
+	"cycles", "instructions", "llcMisses", "branchMisses"
+};
+
+static int		isAvailable[HC_COUNT];
+static const char	*errorText = "not opened";
+
+#ifndef NO_PERF
+
+static const unsigned long long
+			EventConfig[HC_COUNT] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,	// usually the last level cache
+	PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static THREAD_LOCAL int	threadOpened = 0;
+static THREAD_LOCAL int	threadFd[HC_COUNT];
+
+//
+// Open a counter of the given event for the calling thread on any
+// processor; return the descriptor, or -1 (with errno set)
+//
+static int
+openEvent(int event)
+{
+	struct perf_event_attr attr;
+	(void) memset(&attr, 0, sizeof attr);
+	attr.size = sizeof attr;
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = EventConfig[event];
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+				| PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+//
+// Open the counters of the calling thread (those that open found
+// available)
+//
+static void
+openThread(void)
+{
+	threadOpened = 1;
+	for (int e = 0; e < HC_COUNT; e++)
+		threadFd[e] = isAvailable[e] ? openEvent(e) : -1;
+}
+
+#endif
+
+//
+// Find which events can be counted (opening the counters of the
+// calling thread); return how many.  If none, error says why.
+//
+int
+HardwareCounters::open(void)
+{
+#ifdef NO_PERF
+	errorText = "not supported on this system";
+	return 0;
+#else
+	int count = 0;
+	int why = 0;
+	for (int e = 0; e < HC_COUNT; e++) {
+		int fd = openEvent(e);
+		isAvailable[e] = fd >= 0;
+		if (fd >= 0) {
+			(void) close(fd);
+			count++;
+		}
+		else if (why == 0)
+			why = errno;
+	}
+	if (count == 0) {
+		if (why == EACCES || why == EPERM)
+			errorText = "not permitted "
+				"(see /proc/sys/kernel/perf_event_paranoid)";
+		else if (why == ENOENT || why == ENODEV
+		|| why == EOPNOTSUPP || why == ENOSYS)
+			errorText = "not supported by this kernel or processor";
+		else
+			errorText = strerror(why);
+		return 0;
+	}
+	errorText = NULL;
+	openThread();
+	return count;
+#endif
+}
+
+int
+HardwareCounters::available(int event)
+{
+	return isAvailable[event];
+}
+
+//
+// Read the counts of the calling thread so far, scaled up if the
+// kernel had to share the counters with other users
+//
+void
+HardwareCounters::read(long long value[HC_COUNT])
+{
+#ifndef NO_PERF
+	if (!threadOpened)
+		openThread();
+#endif
+	for (int e = 0; e < HC_COUNT; e++) {
+		value[e] = -1;
+#ifndef NO_PERF
+		if (threadFd[e] < 0)
+			continue;
+		unsigned long long buf[3];	// value, enabled, running
+		if (::read(threadFd[e], buf, sizeof buf) != sizeof buf)
+			continue;
+		if (buf[2] == 0)
+			value[e] = 0;
+		else if (buf[2] < buf[1])
+			value[e] = (long long) ((double) buf[0]
+						* buf[1] / buf[2]);
+		else
+			value[e] = buf[0];
+#endif
+	}
+}
+
+const char *
+HardwareCounters::eventName(int event)
+{
+	return EventName[event];
+}
+
+//
+// Return why no events could be counted (NULL if some can)
+//
+const char *
+HardwareCounters::error(void)
+{
+	return errorText;
+}
@@ -29,52 +29,35 @@
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef listarray_h
-#define listarray_h
-
-#include "List.h"
-
-template <class T>
-class ListArray {
-	int		size_;
-	T		**array_;
+#ifndef counters_h
+#define counters_h
+
+#include "ksdssp.h"
+
+//
+// Hardware events counted in each stage with -H
+//
+#define	HC_CYCLES	0	// processor cycles
+#define	HC_INSTRUCTIONS	1	// instructions retired
+#define	HC_LLC_MISSES	2	// last level cache misses
+#define	HC_BRANCH_MISSES 3	// mispredicted branches
+#define	HC_COUNT	4
+
+//
+// Hardware event counters of the calling thread (Linux perf events,
+// user space only).  open checks which events the kernel allows;
+// each thread then opens its own counters the first time it reads
+// them.  Events that are not available read as -1.
+//
+class HardwareCounters {
 public:
-			ListArray(const List<T> &list);
-			~ListArray(void);
-	T		*operator()(int n) const;
-	int		count(void) const;
+	static int	open(void);
+	static int	available(int event);
+	static void	read(long long value[HC_COUNT]);
+	static const char
+			*eventName(int event);
+	static const char
+			*error(void);
 };
 
-template <class T>
-ListArray<T>::ListArray(const List<T> &list)
-{
-	size_ = list.count();
-	array_ = new T *[size_];
-	int i = 0;
-	for (Pix p = list.first(); p != 0; list.next(p))
-		array_[i++] = list(p);
-}
-
-template <class T>
-ListArray<T>::~ListArray(void)
-{
-	delete[] array_;
-}
-
-template <class T>
-T *
-ListArray<T>::operator()(int n) const
-{
-	if (n < 0 || n >= size_)
-		return NULL;
-	return array_[n];
-}
-
-template <class T>
-int
-ListArray<T>::count(void) const
-{
-	return size_;
-}
-
 #endif
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FrameScheduler.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+#ifndef NO_THREADS
+
+//
+// Copy of the models for one frame in flight
+//
+struct FrameSlot {
+	List<Model>	modelList;
+	int		seq;
+	int		frame;
+	FrameSlot	*next;
+};
+
+//
+// Constructor for FrameScheduler (copy the models for each of
+// the frames that may be in flight)
+//
+FrameScheduler::FrameScheduler(Trajectory *t, List<Model> &modelList,
+				FramePrinter printer, int workers)
+{
+	trajectory_ = t;
+	modelList_ = &modelList;
+	printer_ = printer;
+	workers_ = workers < 1 ? 1 : workers;
+	capacity_ = 4 * workers_;
+	slot_ = new FrameSlot[capacity_];
+	free_ = NULL;
+	for (int i = capacity_ - 1; i >= 0; i--) {
+		FrameSlot &s = slot_[i];
+		for (Pix p = modelList.first(); p != 0; modelList.next(p))
+			s.modelList.append(new Model(*modelList(p)));
+		s.next = free_;
+		free_ = &s;
+	}
+	(void) pthread_mutex_init(&lock_, NULL);
+	(void) pthread_cond_init(&changed_, NULL);
+	head_ = tail_ = NULL;
+	done_ = new FrameSlot *[capacity_];
+	for (int i = 0; i < capacity_; i++)
+		done_[i] = NULL;
+	readCount_ = 0;
+	readerDone_ = 0;
+	status_ = 0;
+}
+
+//
+// Destructor for FrameScheduler
+//
+FrameScheduler::~FrameScheduler(void)
+{
+	for (int i = 0; i < capacity_; i++) {
+		List<Model> &ml = slot_[i].modelList;
+		for (Pix p = ml.first(); p != 0; ml.next(p))
+			delete ml(p);
+	}
+	delete [] slot_;
+	delete [] done_;
+	(void) pthread_cond_destroy(&changed_);
+	(void) pthread_mutex_destroy(&lock_);
+}
+
+//
+// Thread entry points
+//
+void *
+FrameScheduler::startReader(void *arg)
+{
+	((FrameScheduler *) arg)->reader();
+	return NULL;
+}
+
+void *
+FrameScheduler::startWorker(void *arg)
+{
+	((FrameScheduler *) arg)->worker();
+	return NULL;
+}
+
+//
+// Read frames into free model copies and queue them for the workers
+//
+void
+FrameScheduler::reader(void)
+{
+	Trace::nameThread("reader");
+	for (;;) {
+		(void) pthread_mutex_lock(&lock_);
+		while (free_ == NULL)
+			(void) pthread_cond_wait(&changed_, &lock_);
+		FrameSlot *s = free_;
+		free_ = s->next;
+		(void) pthread_mutex_unlock(&lock_);
+
+		double start = Trace::now();
+		int status = trajectory_->nextFrame();
+		if (status <= 0) {
+			(void) pthread_mutex_lock(&lock_);
+			s->next = free_;
+			free_ = s;
+			readerDone_ = 1;
+			status_ = status;
+			(void) pthread_cond_broadcast(&changed_);
+			(void) pthread_mutex_unlock(&lock_);
+			return;
+		}
+		s->frame = trajectory_->frame();
+		List<Model> &ml = s->modelList;
+		for (Pix p = ml.first(); p != 0; ml.next(p))
+			ml(p)->setCoords(trajectory_->coords());
+		Trace::span("read frame", "frame", start, Trace::now(), 0,
+								s->frame);
+
+		(void) pthread_mutex_lock(&lock_);
+		s->seq = readCount_++;
+		s->next = NULL;
+		if (tail_ == NULL)
+			head_ = s;
+		else
+			tail_->next = s;
+		tail_ = s;
+		(void) pthread_cond_broadcast(&changed_);
+		(void) pthread_mutex_unlock(&lock_);
+		Metrics::addQueue(Q_ASSIGN, 1);
+	}
+}
+
+//
+// Assign secondary structure to queued frames
+//
+void
+FrameScheduler::worker(void)
+{
+	Trace::nameThread("worker");
+	for (;;) {
+		(void) pthread_mutex_lock(&lock_);
+		while (head_ == NULL && !readerDone_)
+			(void) pthread_cond_wait(&changed_, &lock_);
+		FrameSlot *s = head_;
+		if (s != NULL) {
+			head_ = s->next;
+			if (head_ == NULL)
+				tail_ = NULL;
+		}
+		(void) pthread_mutex_unlock(&lock_);
+		if (s == NULL)
+			return;
+		Metrics::addQueue(Q_ASSIGN, -1);
+
+		double start = Trace::now();
+		List<Model> &ml = s->modelList;
+		for (Pix p = ml.first(); p != 0; ml.next(p))
+			ml(p)->defineSecondaryStructure();
+		Trace::span("assign frame", "frame", start, Trace::now(), 0,
+								s->frame);
+
+		(void) pthread_mutex_lock(&lock_);
+		done_[s->seq % capacity_] = s;
+		(void) pthread_cond_broadcast(&changed_);
+		(void) pthread_mutex_unlock(&lock_);
+		Metrics::addQueue(Q_PRINT, 1);
+	}
+}
+
+//
+// Process all frames, printing results in frame order
+// Return 0 at the end of the trajectory and -1 on a read error
+// (after printing the frames before the error)
+//
+int
+FrameScheduler::run(FILE *output, FILE *summary)
+{
+	pthread_t readerThread;
+	pthread_t *threads = new pthread_t[workers_];
+	(void) pthread_create(&readerThread, NULL, startReader, this);
+	int i;
+	for (i = 0; i < workers_; i++)
+		(void) pthread_create(&threads[i], NULL, startWorker, this);
+
+	for (int seq = 0;; seq++) {
+		FrameSlot **done = &done_[seq % capacity_];
+		(void) pthread_mutex_lock(&lock_);
+		while (*done == NULL && !(readerDone_ && seq >= readCount_))
+			(void) pthread_cond_wait(&changed_, &lock_);
+		FrameSlot *s = *done;
+		*done = NULL;
+		(void) pthread_mutex_unlock(&lock_);
+		if (s == NULL)
+			break;
+		Metrics::addQueue(Q_PRINT, -1);
+
+		double start = Trace::now();
+		(*printer_)(s->modelList, s->frame, output, summary);
+		Trace::span("print frame", "frame", start, Trace::now(), 0,
+								s->frame);
+
+		(void) pthread_mutex_lock(&lock_);
+		s->next = free_;
+		free_ = s;
+		(void) pthread_cond_broadcast(&changed_);
+		(void) pthread_mutex_unlock(&lock_);
+	}
+
+	(void) pthread_join(readerThread, NULL);
+	for (i = 0; i < workers_; i++)
+		(void) pthread_join(threads[i], NULL);
+	delete [] threads;
+
+	for (i = 0; i < capacity_; i++) {
+		List<Model> &ml = slot_[i].modelList;
+		Pix q = ml.first();
+		for (Pix p = modelList_->first(); p != 0 && q != 0;
+						modelList_->next(p), ml.next(q))
+			(*modelList_)(p)->addProfile(*ml(q));
+	}
+	return status_ < 0 ? -1 : 0;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef framescheduler_h
+#define framescheduler_h
+
+#include "ksdssp.h"
+
+#ifndef NO_THREADS
+
+#include <stdio.h>
+#include <pthread.h>
+#include "List.h"
+#include "Model.h"
+#include "Trajectory.h"
+
+//
+// Function that prints the secondary structure assigned to models
+// whose coordinates were set from a frame
+//
+typedef void	(*FramePrinter)(List<Model> &modelList, int frame,
+					FILE *output, FILE *summary);
+
+struct FrameSlot;
+
+//
+// Process trajectory frames in parallel.  A reader thread decodes
+// frames into free copies of the models, a pool of worker threads
+// assigns secondary structure, and the calling thread prints the
+// results in frame order and frees the copies.  The fixed number of
+// copies bounds the frames in flight, so the reader waits when the
+// workers or the writer fall behind.  (Printing stays on one thread
+// since the PDB library formats records in static buffers.)  The
+// stage times and work counts of the copies (if recorded) are added
+// to the models.
+//
+class FrameScheduler {
+	Trajectory	*trajectory_;
+	List<Model>	*modelList_;
+	FramePrinter	printer_;
+	int		workers_;
+	int		capacity_;
+	FrameSlot	*slot_;
+	pthread_mutex_t	lock_;
+	pthread_cond_t	changed_;
+	FrameSlot	*free_;
+	FrameSlot	*head_, *tail_;
+	FrameSlot	**done_;
+	int		readCount_;
+	int		readerDone_;
+	int		status_;
+	static void	*startReader(void *arg);
+	static void	*startWorker(void *arg);
+	void		reader(void);
+	void		worker(void);
+public:
+			FrameScheduler(Trajectory *t, List<Model> &modelList,
+					FramePrinter printer, int workers);
+			~FrameScheduler(void);
+	int		run(FILE *output, FILE *summary);
+};
+
+#endif
+
+#endif
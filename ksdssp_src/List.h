@@ -71,12 +71,14 @@ public:
 template <class T>
 class List	{
 	ListItem<T>	*_head;
+	ListItem<T>	*_tail;
 public:
 			List(void);
 			List(List *orig);
 			~List(void);
 	int		add(T *element);
 	int		append(T *element);
+	Pix		insert(Pix after, T *element);
 	int		remove(T *element);
 	void		clear(void);
 	T		*head(void);
@@ -98,6 +100,7 @@ template <class T>
 List<T>::List(void)
 {
 	_head = NULL;
+	_tail = NULL;
 }
 
 template <class T>
@@ -108,7 +111,9 @@ List<T>::List(List *orig)
 	//	return List(&local_list);
 	// which should prevent a deep copy (that we don't currently provide)
 	_head = orig->_head;
+	_tail = orig->_tail;
 	orig->_head = NULL;
+	orig->_tail = NULL;
 }
 
 template <class T>
@@ -124,6 +129,8 @@ List<T>::add(T *element)
 	ListItem<T> *item = new ListItem<T>(element);
 	item->append(_head);
 	_head = item;
+	if (_tail == NULL)
+		_tail = item;
 	return 0;
 }
 
@@ -131,14 +138,35 @@ template <class T>
 int
 List<T>::append(T *element)
 {
+	// The tail is kept so that appending does not walk the list
 	ListItem<T> *item = new ListItem<T>(element);
 	if (_head == NULL)
 		_head = item;
 	else
-		_head->append(item);
+		_tail->setNext(item);
+	_tail = item;
 	return 0;
 }
 
+template <class T>
+Pix
+List<T>::insert(Pix after, T *element)
+{
+	// Insert after the given item (at the head if 0), returning
+	// the item inserted so that more may follow it
+	if (after == 0) {
+		(void) add(element);
+		return _head;
+	}
+	ListItem<T> *a = (ListItem<T> *) after;
+	ListItem<T> *item = new ListItem<T>(element);
+	item->setNext(a->next());
+	a->setNext(item);
+	if (a == _tail)
+		_tail = item;
+	return item;
+}
+
 template <class T>
 int
 List<T>::remove(T *element)
@@ -154,6 +182,8 @@ List<T>::remove(T *element)
 		_head = t->next();
 	else
 		p->setNext(t->next());
+	if (t == _tail)
+		_tail = p;
 	delete t;
 	return 0;
 }
@@ -168,6 +198,7 @@ List<T>::clear(void)
 		delete _head;
 		_head = n;
 	}
+	_tail = NULL;
 }
 
 template <class T>
@@ -189,6 +220,8 @@ List<T>::pop(void)
 	ListItem<T> *n = _head->next();
 	delete _head;
 	_head = n;
+	if (_head == NULL)
+		_tail = NULL;
 	return v;
 }
 
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include "Metrics.h"
+#include "Timings.h"
+#ifndef NO_THREADS
+#include <pthread.h>
+#endif
+
+//
+// Upper bounds (in seconds) of the buckets of the stage histograms
+//
+static const double	Bucket[] = {
+	1e-5, 1e-4, 1e-3, 1e-2, 0.1, 1, 10
+};
+#define	BUCKET_COUNT	((int) (sizeof Bucket / sizeof Bucket[0]))
+
+static const char	*InputName[I_COUNT] = {
+	"file", "frame", "request"
+};
+static const char	*QueueName[Q_COUNT] = {
+	"assign", "print", "requests"
+};
+
+//
+// Everything counted (copied as a whole when writing)
+//
+struct MetricsState {
+	long		inputs[I_COUNT];
+	long		models;
+	long long	residues;
+	long		errors;
+	long		cacheHits, cacheMisses;
+	long		stageCount[T_COUNT][BUCKET_COUNT + 1];
+	double		stageSum[T_COUNT];
+	int		queue[Q_COUNT];
+};
+
+int			Metrics::enabled_ = 0;
+static MetricsState	state;
+static std::string	metricsPath;
+static double		metricsInterval;
+static double		startTime;
+static double		lastTime;		// of the last write
+static long long	lastResidues;
+static int		reported = 0;		// write error reported
+#ifndef NO_THREADS
+static pthread_mutex_t	metricsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	stopped = PTHREAD_COND_INITIALIZER;
+static pthread_t	writerThread;
+static int		stopping = 0;
+#endif
+
+static void
+lock(void)
+{
+#ifndef NO_THREADS
+	(void) pthread_mutex_lock(&metricsLock);
+#endif
+}
+
+static void
+unlock(void)
+{
+#ifndef NO_THREADS
+	(void) pthread_mutex_unlock(&metricsLock);
+#endif
+}
+
+//
+// Write the metrics file under a temporary name and rename it
+// Returns 0 on success and -1 (with errno set) on error
+//
+static int
+writeFile(void)
+{
+	std::string temp = metricsPath + ".tmp";
+	FILE *f = fopen(temp.c_str(), "w");
+	if (f == NULL)
+		return -1;
+	int status = Metrics::write(f);
+	if (fclose(f) != 0)
+		status = -1;
+#ifdef _WIN32
+	if (status == 0)
+		(void) remove(metricsPath.c_str());
+#endif
+	if (status == 0 && rename(temp.c_str(), metricsPath.c_str()) < 0)
+		status = -1;
+	if (status < 0) {
+		int e = errno;
+		(void) remove(temp.c_str());
+		errno = e;
+	}
+	return status;
+}
+
+//
+// Write the metrics file, reporting the first failure
+//
+static void
+update(void)
+{
+	if (writeFile() < 0 && !reported) {
+		(void) fprintf(stderr, "%s: %s\n", metricsPath.c_str(),
+							strerror(errno));
+		reported = 1;
+	}
+}
+
+#ifndef NO_THREADS
+//
+// Rewrite the metrics file every interval seconds until finished
+//
+static void *
+writer(void *)
+{
+	lock();
+	while (!stopping) {
+		struct timespec ts;
+		(void) clock_gettime(CLOCK_REALTIME, &ts);
+		double t = ts.tv_nsec * 1e-9 + metricsInterval;
+		ts.tv_sec += (time_t) t;
+		ts.tv_nsec = (long) ((t - (time_t) t) * 1e9);
+		if (pthread_cond_timedwait(&stopped, &metricsLock, &ts)
+							!= ETIMEDOUT)
+			continue;
+		unlock();
+		update();
+		lock();
+	}
+	unlock();
+	return NULL;
+}
+#endif
+
+//
+// Start counting, and writing the counts to path every interval
+// seconds (if threads are available; otherwise only when finished)
+// Returns 0 on success and -1 (with error set) if path cannot be
+// written
+//
+int
+Metrics::start(const char *path, double interval, std::string &error)
+{
+	(void) memset(&state, 0, sizeof state);
+	metricsPath = path;
+	metricsInterval = interval > 0 ? interval : 10;
+	startTime = lastTime = StageTimes::now();
+	lastResidues = 0;
+	enabled_ = 1;
+	if (writeFile() < 0) {
+		error = strerror(errno);
+		enabled_ = 0;
+		return -1;
+	}
+#ifndef NO_THREADS
+	(void) pthread_create(&writerThread, NULL, writer, NULL);
+#endif
+	return 0;
+}
+
+//
+// Stop the writer and write the final counts
+//
+void
+Metrics::finish(void)
+{
+	if (!enabled_)
+		return;
+#ifndef NO_THREADS
+	lock();
+	stopping = 1;
+	(void) pthread_cond_signal(&stopped);
+	unlock();
+	(void) pthread_join(writerThread, NULL);
+#endif
+	update();
+	enabled_ = 0;
+}
+
+//
+// Count an input (of kind I_*) and the models and residues assigned
+//
+void
+Metrics::countInput(int kind, int models, int residues)
+{
+	if (!enabled_)
+		return;
+	lock();
+	state.inputs[kind]++;
+	state.models += models;
+	state.residues += residues;
+	unlock();
+}
+
+//
+// Count an input that failed
+//
+void
+Metrics::countError(void)
+{
+	if (!enabled_)
+		return;
+	lock();
+	state.errors++;
+	unlock();
+}
+
+//
+// Count models found in and missing from the cache
+//
+void
+Metrics::countCache(int hits, int misses)
+{
+	if (!enabled_)
+		return;
+	lock();
+	state.cacheHits += hits;
+	state.cacheMisses += misses;
+	unlock();
+}
+
+//
+// Count the time spent in a stage (T_*)
+//
+void
+Metrics::observeStage(int stage, double seconds)
+{
+	int b = 0;
+	while (b < BUCKET_COUNT && seconds > Bucket[b])
+		b++;
+	lock();
+	state.stageCount[stage][b]++;
+	state.stageSum[stage] += seconds;
+	unlock();
+}
+
+//
+// Change the depth of a queue (Q_*)
+//
+void
+Metrics::addQueue(int queue, int change)
+{
+	if (!enabled_)
+		return;
+	lock();
+	state.queue[queue] += change;
+	unlock();
+}
+
+//
+// Print a metric's HELP and TYPE lines
+//
+static void
+printHeader(FILE *output, const char *name, const char *type,
+							const char *help)
+{
+	(void) fprintf(output, "# HELP ksdssp_%s %s\n", name, help);
+	(void) fprintf(output, "# TYPE ksdssp_%s %s\n", name, type);
+}
+
+//
+// Write the counts in the Prometheus text exposition format
+// Returns 0 on success and -1 on a write error
+//
+int
+Metrics::write(FILE *output)
+{
+	lock();
+	MetricsState s = state;
+	unlock();
+	double now = StageTimes::now();
+	double rate = now > lastTime ?
+			(s.residues - lastResidues) / (now - lastTime) : 0;
+	lastTime = now;
+	lastResidues = s.residues;
+
+	int i;
+	printHeader(output, "inputs_total", "counter",
+		"Inputs processed (PDB files, trajectory frames and "
+		"server requests).");
+	for (i = 0; i < I_COUNT; i++)
+		(void) fprintf(output, "ksdssp_inputs_total"
+			"{kind=\"%s\"} %ld\n", InputName[i], s.inputs[i]);
+	printHeader(output, "models_total", "counter",
+						"Models assigned.");
+	(void) fprintf(output, "ksdssp_models_total %ld\n", s.models);
+	printHeader(output, "residues_total", "counter",
+						"Residues assigned.");
+	(void) fprintf(output, "ksdssp_residues_total %lld\n", s.residues);
+	printHeader(output, "residues_per_second", "gauge",
+		"Residues assigned per second since the previous snapshot.");
+	(void) fprintf(output, "ksdssp_residues_per_second %.1f\n", rate);
+	printHeader(output, "errors_total", "counter",
+						"Inputs that failed.");
+	(void) fprintf(output, "ksdssp_errors_total %ld\n", s.errors);
+
+	printHeader(output, "stage_seconds", "histogram",
+			"Time spent in each stage of the assignment.");
+	for (int t = 0; t < T_COUNT; t++) {
+		const char *name = StageTimes::stageName(t);
+		long count = 0;
+		for (int b = 0; b <= BUCKET_COUNT; b++) {
+			char bound[32];
+			if (b < BUCKET_COUNT)
+				(void) sprintf(bound, "%g", Bucket[b]);
+			else
+				(void) strcpy(bound, "+Inf");
+			count += s.stageCount[t][b];
+			(void) fprintf(output, "ksdssp_stage_seconds_bucket"
+				"{stage=\"%s\",le=\"%s\"} %ld\n",
+				name, bound, count);
+		}
+		(void) fprintf(output, "ksdssp_stage_seconds_sum"
+			"{stage=\"%s\"} %.9f\n", name, s.stageSum[t]);
+		(void) fprintf(output, "ksdssp_stage_seconds_count"
+			"{stage=\"%s\"} %ld\n", name, count);
+	}
+
+	printHeader(output, "queue_depth", "gauge",
+		"Trajectory frames waiting for a worker or to be printed, "
+		"and server requests being answered.");
+	for (i = 0; i < Q_COUNT; i++)
+		(void) fprintf(output, "ksdssp_queue_depth"
+			"{queue=\"%s\"} %d\n", QueueName[i], s.queue[i]);
+
+	printHeader(output, "cache_hits_total", "counter",
+					"Models found in the cache.");
+	(void) fprintf(output, "ksdssp_cache_hits_total %ld\n", s.cacheHits);
+	printHeader(output, "cache_misses_total", "counter",
+					"Models missing from the cache.");
+	(void) fprintf(output, "ksdssp_cache_misses_total %ld\n",
+							s.cacheMisses);
+	printHeader(output, "cache_hit_ratio", "gauge",
+		"Fraction of the models looked up found in the cache.");
+	long lookups = s.cacheHits + s.cacheMisses;
+	(void) fprintf(output, "ksdssp_cache_hit_ratio %.4f\n",
+			lookups > 0 ? (double) s.cacheHits / lookups : 0.0);
+
+	printHeader(output, "uptime_seconds", "gauge",
+				"Time since counting started.");
+	(void) fprintf(output, "ksdssp_uptime_seconds %.3f\n",
+							now - startTime);
+	return ferror(output) ? -1 : 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef metrics_h
+#define metrics_h
+
+#include "ksdssp.h"
+#include <stdio.h>
+#include <string>
+
+//
+// Kinds of input counted
+//
+#define	I_FILE		0	// PDB file
+#define	I_FRAME		1	// trajectory frame
+#define	I_REQUEST	2	// server request
+#define	I_COUNT		3
+
+//
+// Queues whose depths are reported
+//
+#define	Q_ASSIGN	0	// frames read, waiting for a worker
+#define	Q_PRINT		1	// frames assigned, waiting to be printed
+#define	Q_REQUESTS	2	// server requests being answered
+#define	Q_COUNT		3
+
+//
+// Counts of the work done for -X: inputs, residues, stage times (as
+// histograms), queue depths, cache hits and errors.  Every interval
+// seconds (and when finished), they are written to a file in the
+// Prometheus text exposition format, which is replaced by renaming so
+// that readers never see it half written.  Counting is thread safe.
+//
+class Metrics {
+	static int	enabled_;
+public:
+	static int	start(const char *path, double interval,
+							std::string &error);
+	static void	finish(void);
+	static int	enabled(void) { return enabled_; }
+	static void	countInput(int kind, int models, int residues);
+	static void	countError(void);
+	static void	countCache(int hits, int misses);
+	static void	observeStage(int stage, double seconds);
+	static void	addQueue(int queue, int change);
+	static int	write(FILE *output);
+};
+
+#endif
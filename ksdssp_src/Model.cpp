@@ -30,24 +30,61 @@
  */
 
 #include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include "ksdssp.h"
+#include "Assignment.h"
 #include "Model.h"
+#include "Sha256.h"
 #include "misc.h"
+#ifndef NO_THREADS
+#include <pthread.h>
+#endif
 
 #ifndef DONT_INSTANIATE
-template class List<Residue>;
-template class ListArray<Residue>;
-template class SquareArray<char>;
 template class List<Helix>;
 template class List<Ladder>;
 template class List<Sheet>;
+template class List<Operator>;
+template class List<CopyBonds>;
 #endif
 
 static int	curModelNumber = -1;
+static int	curAtomIndex = 0;
+static float	hBondCutoff = -0.5;
 static int	minStrandLength = 3;
 static int	minHelixLength = 3;
 static int	checkBulges = 1;
+static int	warnings = 1;
+static int	expandMtrix = 0;
+static List<Operator>	mtrixList;
+static Operator	*mtrixOp = NULL;
+static Topology	*lastTopology = NULL;
+static float	neighborSkin = 0;
+static int	timeStages = 0;
+static int	timedModels = 0;
+#ifndef NO_THREADS
+static pthread_mutex_t	timedModelsLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static int	countWork = 0;
+
+//
+// Number a model whose stages are timed (models are made concurrently
+// by the server's workers and the frame scheduler)
+//
+static int
+nextTimedModel(void)
+{
+#ifdef NO_THREADS
+	return ++timedModels;
+#else
+	(void) pthread_mutex_lock(&timedModelsLock);
+	int n = ++timedModels;
+	(void) pthread_mutex_unlock(&timedModelsLock);
+	return n;
+#endif
+}
 
 inline int
 min(int i1, int i2)
@@ -61,17 +98,737 @@ max(int i1, int i2)
 	return i1 > i2 ? i1 : i2;
 }
 
+//
+// Pair of residues (i < j) that may form a bridge, with its type
+// ('P', 'A' or '-' for none once marked, lower case while being
+// assigned to a ladder)
+//
+struct Bridge {
+	int	i, j;
+	char	type;
+};
+
+//
+// Order bridges by first, then second residue
+//
+static int
+bridgeCmp(const void *v1, const void *v2)
+{
+	const Bridge *b1 = (const Bridge *) v1;
+	const Bridge *b2 = (const Bridge *) v2;
+	if (b1->i != b2->i)
+		return b1->i < b2->i ? -1 : 1;
+	if (b1->j != b2->j)
+		return b1->j < b2->j ? -1 : 1;
+	return 0;
+}
+
+//
+// Set of candidate bridges
+//
+class BridgeSet {
+	int	count_, size_;
+	Bridge	*bridge_;
+	void	add(int i, int j, int max);
+public:
+		BridgeSet(void) { count_ = size_ = 0; bridge_ = NULL; }
+		~BridgeSet(void) { delete [] bridge_; }
+	int	count(void) const { return count_; }
+	Bridge	&operator[](int n) { return bridge_[n]; }
+	void	addBond(int a, int b, int max);
+	void	sort(void);
+	Bridge	*find(int i, int j) const;
+	int	replace(const BridgeSet &bs, const int *touched, int count);
+};
+
+//
+// Add the candidate bridges implied by a hydrogen bond from a to b
+//
+void
+BridgeSet::addBond(int a, int b, int max)
+{
+	add(a + 1, b, max);
+	add(a, b, max);
+	add(a + 1, b - 1, max);
+}
+
+//
+// Add a candidate bridge, as long as neither residue is terminal
+//
+void
+BridgeSet::add(int i, int j, int max)
+{
+	if (i > j) {
+		int tmp = i;
+		i = j;
+		j = tmp;
+	}
+	if (i < 1 || j >= max || i == j)
+		return;
+	if (count_ == size_) {
+		size_ = size_ == 0 ? 64 : size_ * 2;
+		Bridge *b = new Bridge[size_];
+		for (int k = 0; k < count_; k++)
+			b[k] = bridge_[k];
+		delete [] bridge_;
+		bridge_ = b;
+	}
+	Bridge &b = bridge_[count_++];
+	b.i = i;
+	b.j = j;
+	b.type = '\0';
+}
+
+//
+// Sort candidates and remove duplicates
+//
+void
+BridgeSet::sort(void)
+{
+	if (count_ == 0)
+		return;
+	qsort(bridge_, count_, sizeof (Bridge), bridgeCmp);
+	int n = 1;
+	for (int k = 1; k < count_; k++)
+		if (bridgeCmp(&bridge_[k], &bridge_[n - 1]) != 0)
+			bridge_[n++] = bridge_[k];
+	count_ = n;
+}
+
+//
+// Check if n is in a sorted list
+//
+static int
+inList(const int *list, int count, int n)
+{
+	int lo = 0;
+	int hi = count - 1;
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		if (list[mid] == n)
+			return 1;
+		if (list[mid] < n)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return 0;
+}
+
+//
+// Check if a bridge involves one of the residues in a sorted list
+//
+static int
+touches(const Bridge &b, const int *list, int count)
+{
+	return inList(list, count, b.i) || inList(list, count, b.j);
+}
+
+//
+// Replace the candidates involving touched residues (a sorted list)
+// by the bridges among those of bs (both sets sorted and marked).
+// Candidates that are not bridges are dropped, since they are
+// collected and marked again whenever their residues are touched.
+// Returns whether any bridge changed (if none did, the set is left
+// as it is).
+//
+int
+BridgeSet::replace(const BridgeSet &bs, const int *touched, int count)
+{
+	int k1 = 0, k2 = 0;
+	for (;;) {
+		while (k1 < count_ && (bridge_[k1].type == '-'
+				|| !touches(bridge_[k1], touched, count)))
+			k1++;
+		while (k2 < bs.count_ && (bs.bridge_[k2].type == '-'
+				|| !touches(bs.bridge_[k2], touched, count)))
+			k2++;
+		if (k1 == count_ || k2 == bs.count_)
+			break;
+		if (bridgeCmp(&bridge_[k1], &bs.bridge_[k2]) != 0
+		||  bridge_[k1].type != bs.bridge_[k2].type)
+			break;
+		k1++;
+		k2++;
+	}
+	if (k1 == count_ && k2 == bs.count_)
+		return 0;
+
+	Bridge *b = new Bridge[count_ + bs.count_ + 1];
+	int n = 0;
+	k1 = k2 = 0;
+	for (;;) {
+		while (k1 < count_ && (bridge_[k1].type == '-'
+				|| touches(bridge_[k1], touched, count)))
+			k1++;
+		while (k2 < bs.count_ && (bs.bridge_[k2].type == '-'
+				|| !touches(bs.bridge_[k2], touched, count)))
+			k2++;
+		if (k1 == count_ && k2 == bs.count_)
+			break;
+		if (k2 == bs.count_ || (k1 < count_
+		&& bridgeCmp(&bridge_[k1], &bs.bridge_[k2]) < 0))
+			b[n++] = bridge_[k1++];
+		else
+			b[n++] = bs.bridge_[k2++];
+	}
+	delete [] bridge_;
+	bridge_ = b;
+	count_ = n;
+	size_ = n + 1;
+	return 1;
+}
+
+//
+// Find candidate bridge between residues i and j
+//
+Bridge *
+BridgeSet::find(int i, int j) const
+{
+	Bridge key;
+	key.i = i;
+	key.j = j;
+	return (Bridge *) bsearch(&key, bridge_, count_, sizeof (Bridge),
+					bridgeCmp);
+}
+
+//
+// Residue pairs (acceptor, donor) whose C and N atoms came within
+// the hydrogen bond cutoff plus a skin distance when the list was
+// built, together with the C and N positions at that time.
+// The list covers all pairs within the cutoff until some atom
+// has moved by more than half the skin.
+//
+class NeighborList {
+	int	count_, size_;
+	int	(*pair_)[2];
+	int	residues_;
+	float	(*ref_)[2][3];
+public:
+		NeighborList(void);
+		~NeighborList(void) { delete [] pair_; delete [] ref_; }
+	int	count(void) const { return count_; }
+	int	acceptor(int k) const { return pair_[k][0]; }
+	int	donor(int k) const { return pair_[k][1]; }
+	void	start(const Residue *r, int n);
+	void	add(int a, int d);
+	int	valid(const Residue *r, int n, float skin) const;
+};
+
+//
+// Constructor for NeighborList (empty, so never valid)
+//
+NeighborList::NeighborList(void)
+{
+	count_ = size_ = 0;
+	pair_ = NULL;
+	residues_ = 0;
+	ref_ = NULL;
+}
+
+//
+// Empty the list and record the current C and N positions
+//
+void
+NeighborList::start(const Residue *r, int n)
+{
+	count_ = 0;
+	if (n != residues_) {
+		delete [] ref_;
+		residues_ = n;
+		ref_ = new float[n][2][3];
+	}
+	for (int i = 0; i < n; i++) {
+		const float *backbone[2] = { r[i].atom(A_C), r[i].atom(A_N) };
+		for (int k = 0; k < 2; k++)
+			for (int d = 0; d < 3; d++)
+				ref_[i][k][d] = backbone[k] == NULL ?
+							0 : backbone[k][d];
+	}
+}
+
+//
+// Add an (acceptor, donor) pair
+//
+void
+NeighborList::add(int a, int d)
+{
+	if (count_ == size_) {
+		size_ = size_ == 0 ? 1024 : size_ * 2;
+		int (*p)[2] = new int[size_][2];
+		if (count_ > 0)
+			memcpy(p, pair_, count_ * sizeof p[0]);
+		delete [] pair_;
+		pair_ = p;
+	}
+	pair_[count_][0] = a;
+	pair_[count_][1] = d;
+	count_++;
+}
+
+//
+// Check that no C or N atom has moved by more than half the skin
+//
+int
+NeighborList::valid(const Residue *r, int n, float skin) const
+{
+	if (n != residues_ || ref_ == NULL)
+		return 0;
+	float limit = skin * skin / 4;
+	for (int i = 0; i < n; i++) {
+		const float *backbone[2] = { r[i].atom(A_C), r[i].atom(A_N) };
+		for (int k = 0; k < 2; k++)
+			if (backbone[k] != NULL
+			&&  distSquared(backbone[k], ref_[i][k]) > limit)
+				return 0;
+	}
+	return 1;
+}
+
+//
+// Hydrogen bonds between residues of the asymmetric unit, as the
+// donors bonded to each acceptor and the acceptors bonded to each
+// donor.  A residue takes part in only a few bonds, so lookups are
+// short searches, and the table grows with the model.
+//
+struct BondList {
+	int	count, size;
+	int	*residue;
+};
+
+class BondTable {
+	int		count_, size_;
+	BondList	*donors_;
+	BondList	*acceptors_;
+	static void	add(BondList &l, int r);
+	static void	remove(BondList &l, int r);
+public:
+			BondTable(void);
+			~BondTable(void);
+	void		resize(int n);
+	void		clear(void);
+	int		bonded(int a, int d) const;
+	void		add(int a, int d);
+	void		removeResidue(int r);
+	const BondList	&donors(int a) const { return donors_[a]; }
+	const BondList	&acceptors(int d) const { return acceptors_[d]; }
+};
+
+//
+// Constructor for BondTable (no residues)
+//
+BondTable::BondTable(void)
+{
+	count_ = size_ = 0;
+	donors_ = NULL;
+	acceptors_ = NULL;
+}
+
+//
+// Destructor for BondTable
+//
+BondTable::~BondTable(void)
+{
+	for (int i = 0; i < size_; i++) {
+		delete [] donors_[i].residue;
+		delete [] acceptors_[i].residue;
+	}
+	delete [] donors_;
+	delete [] acceptors_;
+}
+
+//
+// Set the number of residues (new residues have no bonds)
+//
+void
+BondTable::resize(int n)
+{
+	if (n > size_) {
+		int size = size_ * 2 > n ? size_ * 2 : n;
+		BondList *donors = new BondList[size];
+		BondList *acceptors = new BondList[size];
+		for (int i = 0; i < size; i++) {
+			if (i < size_) {
+				donors[i] = donors_[i];
+				acceptors[i] = acceptors_[i];
+				continue;
+			}
+			donors[i].count = donors[i].size = 0;
+			donors[i].residue = NULL;
+			acceptors[i] = donors[i];
+		}
+		delete [] donors_;
+		delete [] acceptors_;
+		donors_ = donors;
+		acceptors_ = acceptors;
+		size_ = size;
+	}
+	for (int i = count_; i < n; i++)
+		donors_[i].count = acceptors_[i].count = 0;
+	count_ = n;
+}
+
+//
+// Remove all bonds
+//
+void
+BondTable::clear(void)
+{
+	for (int i = 0; i < count_; i++)
+		donors_[i].count = acceptors_[i].count = 0;
+}
+
+//
+// Check if acceptor a is bonded to donor d
+//
+int
+BondTable::bonded(int a, int d) const
+{
+	const BondList &l = donors_[a];
+	for (int k = 0; k < l.count; k++)
+		if (l.residue[k] == d)
+			return 1;
+	return 0;
+}
+
+//
+// Add a bond from acceptor a to donor d
+//
+void
+BondTable::add(int a, int d)
+{
+	add(donors_[a], d);
+	add(acceptors_[d], a);
+}
+
+//
+// Remove all bonds of residue r (as acceptor or donor)
+//
+void
+BondTable::removeResidue(int r)
+{
+	BondList &donors = donors_[r];
+	int k;
+	for (k = 0; k < donors.count; k++)
+		remove(acceptors_[donors.residue[k]], r);
+	donors.count = 0;
+	BondList &acceptors = acceptors_[r];
+	for (k = 0; k < acceptors.count; k++)
+		remove(donors_[acceptors.residue[k]], r);
+	acceptors.count = 0;
+}
+
+//
+// Add residue r to a list
+//
+void
+BondTable::add(BondList &l, int r)
+{
+	if (l.count == l.size) {
+		l.size = l.size == 0 ? 4 : l.size * 2;
+		int *residue = new int[l.size];
+		for (int k = 0; k < l.count; k++)
+			residue[k] = l.residue[k];
+		delete [] l.residue;
+		l.residue = residue;
+	}
+	l.residue[l.count++] = r;
+}
+
+//
+// Remove residue r from a list
+//
+void
+BondTable::remove(BondList &l, int r)
+{
+	for (int k = 0; k < l.count; k++)
+		if (l.residue[k] == r) {
+			l.residue[k] = l.residue[--l.count];
+			return;
+		}
+}
+
+//
+// Residues hashed by the position of one backbone atom (C or N) into
+// cubes with sides of a distance cutoff (that for hydrogen bonds unless
+// given), so that the residues that may bond with a residue are found
+// without going through the whole model
+//
+class AtomGrid {
+	struct Entry {
+		int	cell[3];
+		int	residue;
+		int	next;
+	};
+	int	slot_;
+	float	side_;
+	int	bucketCount_;
+	int	*bucket_;
+	int	count_, size_;
+	Entry	*entry_;
+	int	indexSize_;
+	int	*index_;
+	int	foundCount_, foundSize_;
+	int	*found_;
+	int	hash(const int cell[3]) const;
+	void	rehash(int buckets);
+	void	cellOf(const float *xyz, int cell[3]) const;
+public:
+		AtomGrid(int slot, float side = 7.0);
+		~AtomGrid(void);
+	void	add(int residue, const Residue *r);
+	void	move(int residue, const Residue *r);
+	int	findNear(const float *xyz);
+	int	found(int k) const { return found_[k]; }
+};
+
+//
+// Constructor for AtomGrid (empty, for atoms in the given slot)
+//
+AtomGrid::AtomGrid(int slot, float side)
+{
+	slot_ = slot;
+	side_ = side;
+	bucketCount_ = 0;
+	bucket_ = NULL;
+	count_ = size_ = 0;
+	entry_ = NULL;
+	indexSize_ = 0;
+	index_ = NULL;
+	foundCount_ = foundSize_ = 0;
+	found_ = NULL;
+	rehash(256);
+}
+
+//
+// Destructor for AtomGrid
+//
+AtomGrid::~AtomGrid(void)
+{
+	delete [] bucket_;
+	delete [] entry_;
+	delete [] index_;
+	delete [] found_;
+}
+
+//
+// Find the cell holding a point
+//
+void
+AtomGrid::cellOf(const float *xyz, int cell[3]) const
+{
+	for (int d = 0; d < 3; d++)
+		cell[d] = (int) floorf(xyz[d] / side_);
+}
+
+//
+// Bucket for a cell (the bucket count is a power of two)
+//
+int
+AtomGrid::hash(const int cell[3]) const
+{
+	unsigned int h = (unsigned int) cell[0] * 73856093u
+			^ (unsigned int) cell[1] * 19349663u
+			^ (unsigned int) cell[2] * 83492791u;
+	return h & (bucketCount_ - 1);
+}
+
+//
+// Spread the entries over a new number of buckets
+//
+void
+AtomGrid::rehash(int buckets)
+{
+	delete [] bucket_;
+	bucketCount_ = buckets;
+	bucket_ = new int[bucketCount_];
+	int k;
+	for (k = 0; k < bucketCount_; k++)
+		bucket_[k] = -1;
+	for (k = 0; k < count_; k++) {
+		int h = hash(entry_[k].cell);
+		entry_[k].next = bucket_[h];
+		bucket_[h] = k;
+	}
+}
+
+//
+// Add a residue (unless it lacks the atom)
+//
+void
+AtomGrid::add(int residue, const Residue *r)
+{
+	const float *xyz = r->atom(slot_);
+	if (xyz == NULL)
+		return;
+	if (count_ == size_) {
+		size_ = size_ == 0 ? 256 : size_ * 2;
+		Entry *e = new Entry[size_];
+		if (count_ > 0)
+			memcpy(e, entry_, count_ * sizeof e[0]);
+		delete [] entry_;
+		entry_ = e;
+	}
+	if (residue >= indexSize_) {
+		int size = indexSize_ == 0 ? 256 : indexSize_;
+		while (size <= residue)
+			size *= 2;
+		int *index = new int[size];
+		int k;
+		for (k = 0; k < indexSize_; k++)
+			index[k] = index_[k];
+		for (; k < size; k++)
+			index[k] = -1;
+		delete [] index_;
+		index_ = index;
+		indexSize_ = size;
+	}
+	index_[residue] = count_;
+	Entry &e = entry_[count_++];
+	cellOf(xyz, e.cell);
+	e.residue = residue;
+	if (count_ > 2 * bucketCount_) {
+		rehash(2 * bucketCount_);
+		return;
+	}
+	int h = hash(e.cell);
+	e.next = bucket_[h];
+	bucket_[h] = count_ - 1;
+}
+
+//
+// Move a residue already added to the cell its atom is now in
+//
+void
+AtomGrid::move(int residue, const Residue *r)
+{
+	if (residue >= indexSize_ || index_[residue] < 0)
+		return;
+	int k = index_[residue];
+	Entry &e = entry_[k];
+	int cell[3];
+	cellOf(r->atom(slot_), cell);
+	if (cell[0] == e.cell[0] && cell[1] == e.cell[1]
+	&&  cell[2] == e.cell[2])
+		return;
+	int *link = &bucket_[hash(e.cell)];
+	while (*link != k)
+		link = &entry_[*link].next;
+	*link = e.next;
+	for (int d = 0; d < 3; d++)
+		e.cell[d] = cell[d];
+	int h = hash(e.cell);
+	e.next = bucket_[h];
+	bucket_[h] = k;
+}
+
+//
+// Find the residues in the cells around a point (which include all
+// those whose atom is within the cutoff of it); the number
+// found is returned and the residues are available from found()
+//
+int
+AtomGrid::findNear(const float *xyz)
+{
+	foundCount_ = 0;
+	int center[3];
+	cellOf(xyz, center);
+	int cell[3];
+	for (cell[0] = center[0] - 1; cell[0] <= center[0] + 1; cell[0]++)
+	for (cell[1] = center[1] - 1; cell[1] <= center[1] + 1; cell[1]++)
+	for (cell[2] = center[2] - 1; cell[2] <= center[2] + 1; cell[2]++) {
+		for (int k = bucket_[hash(cell)]; k >= 0; k = entry_[k].next) {
+			const Entry &e = entry_[k];
+			if (e.cell[0] != cell[0] || e.cell[1] != cell[1]
+			||  e.cell[2] != cell[2])
+				continue;
+			if (foundCount_ == foundSize_) {
+				foundSize_ = foundSize_ == 0 ? 64
+							: foundSize_ * 2;
+				int *f = new int[foundSize_];
+				for (int i = 0; i < foundCount_; i++)
+					f[i] = found_[i];
+				delete [] found_;
+				found_ = f;
+			}
+			found_[foundCount_++] = e.residue;
+		}
+	}
+	return foundCount_;
+}
+
+//
+// Constructor for Model (no residues, to be added by appendResidue)
+//
+Model::Model(void)
+	: error_(), helixList_(), ladderList_(), sheetList_(),
+	  fileRecord_(PDB::USER_FILE), copyBondsList_()
+{
+	anyMore_ = 0;
+	topology_ = new Topology;
+	coord_ = NULL;
+	coordSize_ = 0;
+	residue_ = NULL;
+	residueCount_ = 0;
+	residueSize_ = 0;
+	hBond_ = NULL;
+	keepBonds_ = 0;
+	bridges_ = NULL;
+	modelNumber_ = -1;
+	auCount_ = 0;
+	copies_ = 1;
+	copyOp_ = new Operator[1];
+	copyBonds_ = NULL;
+	neighbors_ = NULL;
+	cGrid_ = NULL;
+	nGrid_ = NULL;
+	result_ = NULL;
+	times_ = timeStages ? new StageTimes(nextTimedModel()) : NULL;
+	useDefaults();
+#ifdef WITH_STATS
+	stats_ = countWork ? new WorkStats : NULL;
+#endif
+}
+
 //
 // Constructor for Model (read residues/atoms from PDB file)
+// Only backbone atoms are kept, in a flat coordinate array; the
+// residue identities are shared with the previous model if they match
 //
 Model::Model(FILE *input)
-	: error_(), rList_(), helixList_(), ladderList_(), sheetList_(),
-	  fileRecord_(PDB::USER_FILE)
+	: error_(), helixList_(), ladderList_(), sheetList_(),
+	  fileRecord_(PDB::USER_FILE), copyBondsList_()
 {
-	Residue *r = NULL;
+	Topology *t = new Topology;
+	int size = 0;
+	int endOfFile = 0;
+	coord_ = NULL;
+	coordSize_ = 0;
+	residue_ = NULL;
+	residueCount_ = 0;
+	residueSize_ = 0;
+	hBond_ = NULL;
+	keepBonds_ = 0;
+	bridges_ = NULL;
 	anyMore_ = 0;
+	auCount_ = 0;
+	copies_ = 1;
+	copyOp_ = NULL;
+	copyBonds_ = NULL;
+	neighbors_ = NULL;
+	cGrid_ = NULL;
+	nGrid_ = NULL;
+	result_ = NULL;
+	times_ = NULL;
+	if (timeStages)
+		times_ = new StageTimes(nextTimedModel());
+	useDefaults();
+#ifdef WITH_STATS
+	stats_ = countWork ? new WorkStats : NULL;
+#endif
 	char buf[256];
 	modelNumber_ = curModelNumber;
+	startTimes();
 	while (fgets(buf, sizeof buf, input) != NULL) {
 		PDB pdb(buf);
 		switch (pdb.type()) {
@@ -81,16 +838,32 @@ Model::Model(FILE *input)
 				a.residue.chainId = ' ';
 			if (a.residue.insertCode == '\0')
 				a.residue.insertCode = ' ';
-			if (r == NULL || !r->sameAs(a.residue)) {
-				r = new Residue(a.residue);
-				rList_.append(r);
+			int index = curAtomIndex++;
+			if (!t->sameAsLast(a.residue)) {
+				if (t->count() == size) {
+					size = size == 0 ? 256 : size * 2;
+					growCoords(t->count(), size);
+				}
+				t->addResidue(a.residue);
 			}
-			r->addAtom(new Atom(a.name, a.xyz));
+			int n = t->count() - 1;
+			int slot = Residue::atomSlot(a.name);
+			if (slot < 0 || (t->atoms(n) & (1 << slot)))
+				break;		// Only the first one is used
+			for (int i = 0; i < 3; i++)
+				coord_[n][slot][i] = a.xyz[i];
+			t->addAtom(slot, index);
 			break;
 		  }
+		  case PDB::HETATM:
+			curAtomIndex++;
+			break;
+		  case PDB::MODEL:
+			curAtomIndex = 0;
+			break;
 		  case PDB::TER:
-			if (r != NULL)
-				r->setFlag(R_TER);
+			if (t->count() > 0)
+				t->setFlag(R_TER);
 			anyMore_ = 1;
 			goto done;
 		  case PDB::USER_FILE:
@@ -98,17 +871,620 @@ Model::Model(FILE *input)
 			curModelNumber = pdb.userFile.model;
 			modelNumber_ = curModelNumber;
 			break;
+		  case PDB::MTRIX: {
+			// Operators for copies that are not already
+			// present in the file apply to all models
+			const PDB::Mtrix &m = pdb.mtrix;
+			if (!expandMtrix || m.given)
+				break;
+			if (m.rowNum == 1)
+				mtrixOp = new Operator(m.serialNum);
+			if (mtrixOp == NULL
+			||  mtrixOp->serialNum() != m.serialNum)
+				break;
+			mtrixOp->setRow(m);
+			if (m.rowNum == 3) {
+				mtrixList.append(mtrixOp);
+				mtrixOp = NULL;
+			}
+			break;
+		  }
 		  case PDB::END:
 			curModelNumber = -1;
+			curAtomIndex = 0;
 			anyMore_ = 1;
+			endOfFile = 1;
 			goto done;
 		}
 	}
 done:
-	if (rList_.count() > 0) {
-		rArray_ = new ListArray<Residue>(rList_);
-		hBond_ = new SquareArray<char>(rArray_->count());
+	residueCount_ = t->count();
+	if (residueCount_ > 0) {
+		growCoords(residueCount_, residueCount_);
+		t->complete();
+		if (lastTopology != NULL && lastTopology->sameAs(t)) {
+			t->unref();
+			t = lastTopology;
+			t->ref();
+		}
+		else {
+			if (lastTopology != NULL)
+				lastTopology->unref();
+			lastTopology = t;
+			t->ref();
+		}
+		topology_ = t;
+		makeResidues();
+		copies_ = mtrixList.count() + 1;
+		copyOp_ = new Operator[copies_];
+		int c = 1;
+		for (Pix p = mtrixList.first(); p != 0; mtrixList.next(p))
+			copyOp_[c++] = *mtrixList(p);
 	}
+	if (endOfFile) {
+		// End of file, so operators do not carry over
+		for (Pix p = mtrixList.first(); p != 0; mtrixList.next(p))
+			delete mtrixList(p);
+		mtrixList.clear();
+	}
+	topology_ = t;
+	lap(T_PARSE);
+	PROBE2(model__read, modelNumber_, residueCount_);
+}
+
+//
+// Constructor for Model (from a complete topology and coordinates
+// laid out as for setCoords), with no symmetry copies
+//
+Model::Model(Topology *t, const float *xyz)
+	: error_(), helixList_(), ladderList_(), sheetList_(),
+	  fileRecord_(PDB::USER_FILE), copyBondsList_()
+{
+	anyMore_ = 0;
+	topology_ = t;
+	topology_->ref();
+	int n = t->count();
+	coord_ = NULL;
+	coordSize_ = 0;
+	growCoords(0, n > 0 ? n : 1);
+	for (int i = 0; i < n; i++)
+		for (int slot = 0; slot < A_COUNT; slot++) {
+			int index = t->atomIndex(i, slot);
+			if (index < 0)
+				continue;
+			for (int k = 0; k < 3; k++)
+				coord_[i][slot][k] = xyz[3 * index + k];
+		}
+	makeResidues();
+	hBond_ = NULL;
+	keepBonds_ = 0;
+	bridges_ = NULL;
+	modelNumber_ = -1;
+	copies_ = 1;
+	copyOp_ = new Operator[1];
+	copyBonds_ = NULL;
+	neighbors_ = NULL;
+	cGrid_ = NULL;
+	nGrid_ = NULL;
+	result_ = NULL;
+	times_ = timeStages ? new StageTimes(nextTimedModel()) : NULL;
+	useDefaults();
+#ifdef WITH_STATS
+	stats_ = countWork ? new WorkStats : NULL;
+#endif
+	PROBE2(model__read, modelNumber_, residueCount_);
+}
+
+//
+// Create the residues of the asymmetric unit from the topology
+//
+void
+Model::makeResidues(void)
+{
+	residueCount_ = topology_->count();
+	auCount_ = residueCount_;
+	residueSize_ = residueCount_;
+	residue_ = new Residue[residueSize_];
+	for (int i = 0; i < residueCount_; i++) {
+		residue_[i] = Residue(&topology_->residue(i), coord_[i],
+					topology_->atoms(i));
+		residue_[i].setFlag(topology_->flags(i));
+	}
+}
+
+//
+// Discard secondary structure (and symmetry copies) from a previous
+// call to defineSecondaryStructure
+//
+void
+Model::clearStructure(void)
+{
+	clearHelices();
+	clearSheets();
+	Pix p;
+	for (p = copyBondsList_.first(); p != 0; copyBondsList_.next(p))
+		delete copyBondsList_(p);
+	copyBondsList_.clear();
+	delete [] copyBonds_;
+	copyBonds_ = NULL;
+	delete bridges_;
+	bridges_ = NULL;
+	dropGrids();
+	delete [] residue_;
+	makeResidues();
+}
+
+//
+// Hash the residues by the positions of their C and N atoms, unless
+// already done
+//
+void
+Model::makeGrids(void)
+{
+	if (cGrid_ != NULL)
+		return;
+	cGrid_ = new AtomGrid(A_C);
+	nGrid_ = new AtomGrid(A_N);
+	for (int i = 0; i < auCount_; i++) {
+		cGrid_->add(i, residue(i));
+		nGrid_->add(i, residue(i));
+	}
+}
+
+//
+// Discard the spatial hashes of the residues (once they have moved)
+//
+void
+Model::dropGrids(void)
+{
+	delete cGrid_;
+	cGrid_ = NULL;
+	delete nGrid_;
+	nGrid_ = NULL;
+}
+
+//
+// Discard the helices
+//
+void
+Model::clearHelices(void)
+{
+	for (Pix p = helixList_.first(); p != 0; helixList_.next(p))
+		delete helixList_(p);
+	helixList_.clear();
+}
+
+//
+// Discard the ladders and sheets
+//
+void
+Model::clearSheets(void)
+{
+	Pix p;
+	for (p = ladderList_.first(); p != 0; ladderList_.next(p))
+		delete ladderList_(p);
+	ladderList_.clear();
+	for (p = sheetList_.first(); p != 0; sheetList_.next(p))
+		delete sheetList_(p);
+	sheetList_.clear();
+}
+
+//
+// Replace the backbone coordinates with those of a trajectory frame
+// (x, y and z of each atom, in the order of the file the model was
+// read from), discarding any secondary structure
+//
+void
+Model::setCoords(const float *xyz)
+{
+	for (int i = 0; i < auCount_; i++)
+		for (int slot = 0; slot < A_COUNT; slot++) {
+			int n = topology_->atomIndex(i, slot);
+			if (n < 0)
+				continue;
+			for (int k = 0; k < 3; k++)
+				coord_[i][slot][k] = xyz[3 * n + k];
+		}
+	clearStructure();
+}
+
+//
+// Replace the backbone coordinates of the listed residues (from xyz,
+// laid out as for setCoords) and update the secondary structure.
+//
+// The hydrogen bonds are kept from the previous call, and only
+// the bonds of moved residues (and of the residues following them,
+// whose imide hydrogens they place) are evaluated again, with the
+// residues that the spatial hashes kept from the previous call (and
+// updated for the moved residues) place near them.  Turn and
+// helix flags, and the helices, are then found again in the sequence
+// windows around those residues, and bridges from the bonds next to
+// them.  If a bridge changed, ladders and sheets are rebuilt for the
+// whole model (sheet names depend on every ladder), so that step
+// still grows with the size of the model.
+// The result is the same as that of setCoords followed by
+// defineSecondaryStructure, which is what the first call does (as
+// does every call for models with symmetry copies).
+//
+void
+Model::updateCoords(const float *xyz, const int *moved, int count)
+{
+	if (hBond_ == NULL || bridges_ == NULL || copies_ > 1) {
+		keepBonds_ = 1;
+		setCoords(xyz);
+		defineSecondaryStructure();
+		return;
+	}
+
+	STATS_FOR(stats_);
+	startTimes();
+	if (times_ != NULL)
+		times_->countRun();
+	char *isAffected = new char[auCount_];
+	(void) memset(isAffected, 0, auCount_);
+	int i, j, k;
+	for (k = 0; k < count; k++) {
+		i = moved[k];
+		if (i < 0 || i >= auCount_)
+			continue;
+		for (int slot = 0; slot < A_COUNT; slot++) {
+			int n = topology_->atomIndex(i, slot);
+			if (n < 0)
+				continue;
+			for (int d = 0; d < 3; d++)
+				coord_[i][slot][d] = xyz[3 * n + d];
+		}
+		isAffected[i] = 1;
+		if (i + 1 < auCount_ && !residue_[i].flag(R_TER))
+			isAffected[i + 1] = 1;
+	}
+	int *affected = new int[auCount_];
+	int affectedCount = 0;
+	for (i = 0; i < auCount_; i++)
+		if (isAffected[i])
+			affected[affectedCount++] = i;
+
+	// Place the imide hydrogens again
+	for (k = 0; k < affectedCount; k++) {
+		i = affected[k];
+		int flags = residue_[i].flag(~0);
+		residue_[i] = Residue(&topology_->residue(i), coord_[i],
+					topology_->atoms(i));
+		residue_[i].setFlag(flags);
+	}
+	for (k = 0; k < affectedCount; k++) {
+		i = affected[k];
+		if (i > 0 && !residue_[i - 1].flag(R_TER))
+			(void) residue_[i].addImideHydrogen(&residue_[i - 1]);
+	}
+	lap(T_HYDROGENS);
+
+	// Bonds to and from the affected residues, with the residues
+	// whose C and N atoms lie near their own (the grids are moved
+	// along with the residues, rather than hashed again)
+	makeGrids();
+	for (k = 0; k < affectedCount; k++) {
+		i = affected[k];
+		cGrid_->move(i, residue(i));
+		nGrid_->move(i, residue(i));
+		hBond_->removeResidue(i);
+	}
+	float cutoff = options_.hBondCutoff;
+	long pairs = 0;
+	for (k = 0; k < affectedCount; k++) {
+		i = affected[k];
+		Residue *ri = residue(i);
+		int n;
+		if (ri->atom(A_C) != NULL)
+			for (n = nGrid_->findNear(ri->atom(A_C)); n-- > 0; ) {
+				j = nGrid_->found(n);
+				if (j - i < 2 && i - j < 2)
+					continue;
+				if (ri->hBondedTo(residue(j), cutoff))
+					hBond_->add(i, j);
+				pairs++;
+			}
+		// Bonds from another affected residue were found above
+		if (ri->atom(A_N) != NULL)
+			for (n = cGrid_->findNear(ri->atom(A_N)); n-- > 0; ) {
+				j = cGrid_->found(n);
+				if ((j - i < 2 && i - j < 2) || isAffected[j])
+					continue;
+				if (residue(j)->hBondedTo(ri, cutoff))
+					hBond_->add(j, i);
+				pairs++;
+			}
+	}
+	countPairs(pairs);
+	delete [] isAffected;
+	lap(T_HBONDS);
+
+	updateStructure(affected, affectedCount, 1);
+	delete [] affected;
+}
+
+//
+// Add a residue at the end of the model, given the coordinates of
+// its backbone atoms (by slot, present if the bit for the slot is
+// set in atoms; the imide hydrogen is placed from the previous
+// residue as when reading a file), and update the secondary
+// structure.
+//
+// The first residue added to a model without secondary structure
+// (and every residue for models with symmetry copies) leads to a
+// full assignment.  After that, the new residue is only checked for
+// bonds with the residues whose C and N atoms lie near its own,
+// which are found through spatial hashes, and the secondary
+// structure is updated as for updateCoords.
+//
+void
+Model::appendResidue(const PDB::Residue &r, const float xyz[A_COUNT][3],
+								int atoms)
+{
+	STATS_FOR(stats_);
+	const PDB::Residue *ids = topology_->count() > 0 ?
+					&topology_->residue(0) : NULL;
+	if (topology_->shared()) {
+		Topology *t = new Topology(*topology_);
+		topology_->unref();
+		topology_ = t;
+	}
+	int n = auCount_;
+	topology_->addResidue(r);
+	int index = topology_->atomCount();
+	int slot;
+	for (slot = 0; slot < A_COUNT; slot++)
+		if (atoms & (1 << slot))
+			topology_->addAtom(slot, index++);
+	int moved = n > 0 && &topology_->residue(0) != ids;
+	if (n == coordSize_) {
+		growCoords(n, n == 0 ? 256 : 2 * n);
+		moved = 1;
+	}
+	for (slot = 0; slot < A_COUNT; slot++)
+		if (atoms & (1 << slot))
+			for (int d = 0; d < 3; d++)
+				coord_[n][slot][d] = xyz[slot][d];
+
+	if (hBond_ == NULL || bridges_ == NULL || copies_ > 1) {
+		keepBonds_ = 1;
+		clearStructure();
+		defineSecondaryStructure();
+		return;
+	}
+
+	// Residues point into the coordinate and topology arrays
+	int i;
+	if (moved)
+		for (i = 0; i < n; i++)
+			residue_[i].relocate(&topology_->residue(i), coord_[i]);
+	makeGrids();
+	if (n == residueSize_)
+		growResidues(2 * n);
+	residue_[n] = Residue(&topology_->residue(n), coord_[n],
+				topology_->atoms(n));
+	residueCount_ = auCount_ = n + 1;
+	if (n > 0 && !residue_[n - 1].flag(R_TER))
+		(void) residue_[n].addImideHydrogen(&residue_[n - 1]);
+
+	// Bonds between the new residue and those near it
+	hBond_->resize(auCount_);
+	Residue *rn = residue(n);
+	int k;
+	float cutoff = options_.hBondCutoff;
+	long pairs = 0;
+	if (rn->atom(A_C) != NULL)
+		for (k = nGrid_->findNear(rn->atom(A_C)); k-- > 0; ) {
+			i = nGrid_->found(k);
+			if (i < n - 1 && rn->hBondedTo(residue(i), cutoff))
+				hBond_->add(n, i);
+			pairs++;
+		}
+	if (rn->atom(A_N) != NULL)
+		for (k = cGrid_->findNear(rn->atom(A_N)); k-- > 0; ) {
+			i = cGrid_->found(k);
+			if (i < n - 1 && residue(i)->hBondedTo(rn, cutoff))
+				hBond_->add(i, n);
+			pairs++;
+		}
+	countPairs(pairs);
+	cGrid_->add(n, rn);
+	nGrid_->add(n, rn);
+
+	updateStructure(&n, 1, 0);
+}
+
+//
+// End the chain at the last residue added (as a TER record does),
+// so that the next residue starts a new one
+//
+void
+Model::endChain(void)
+{
+	if (auCount_ == 0)
+		return;
+	if (topology_->shared()) {
+		Topology *t = new Topology(*topology_);
+		topology_->unref();
+		topology_ = t;
+		for (int i = 0; i < auCount_; i++)
+			residue_[i].relocate(&topology_->residue(i), coord_[i]);
+	}
+	topology_->setFlag(R_TER);
+	for (int c = 0; c < copies_; c++)
+		residue_[c * auCount_ + auCount_ - 1].setFlag(R_TER);
+}
+
+//
+// Update the turn and helix flags, bridges, ladders and sheets after
+// the bonds of the affected residues (a sorted list) have changed.
+// Helices are found again around the windows whose helix flags changed
+// (or whose residues moved, which may change their class).  Ladders
+// and sheets are rebuilt for the whole model if any bridge changed,
+// since sheet names depend on the order of every ladder: that is the
+// part of an update whose cost grows with the size of the model.
+//
+void
+Model::updateStructure(const int *affected, int count, int moved)
+{
+	// Turn and helix flags only change within four residues of
+	// a changed bond
+	int *window = new int[2 * count];
+	int windowCount = 0;
+	int i, j, k;
+	for (k = 0; k < count; ) {
+		int lo = max(affected[k] - 4, 0);
+		int hi = min(affected[k] + 4, auCount_ - 1);
+		for (k++; k < count && affected[k] - 4 <= hi + 1; k++)
+			hi = min(affected[k] + 4, auCount_ - 1);
+		int helix[9 + 1];
+		int *was = hi - lo < 9 ? helix : new int[hi - lo + 1];
+		for (j = lo; j <= hi; j++) {
+			was[j - lo] = residue_[j].flag(R_3HELIX | R_4HELIX);
+			residue_[j].clearFlag(R_3DONOR | R_3ACCEPTOR | R_3GAP
+				| R_3HELIX | R_4DONOR | R_4ACCEPTOR | R_4GAP
+				| R_4HELIX);
+		}
+		findTurns(3, lo, hi);
+		markHelices(3, lo, hi);
+		findTurns(4, lo, hi);
+		markHelices(4, lo, hi);
+		int changed = moved;
+		for (j = lo; j <= hi && !changed; j++)
+			if (residue_[j].flag(R_3HELIX | R_4HELIX)
+							!= was[j - lo])
+				changed = 1;
+		if (changed) {
+			window[2 * windowCount] = lo;
+			window[2 * windowCount + 1] = hi;
+			windowCount++;
+		}
+		if (was != helix)
+			delete [] was;
+	}
+	lap(T_TURNS);
+	for (k = 0; k < windowCount; k++)
+		updateHelices(window[2 * k], window[2 * k + 1]);
+	delete [] window;
+	lap(T_HELICES);
+
+	// Bridges only change for residues next to affected ones, so
+	// only their candidates are collected again, from the bonds
+	// that imply them
+	int *touched = new int[3 * count];
+	int touchedCount = 0;
+	for (k = 0; k < count; k++)
+		for (i = affected[k] - 1; i <= affected[k] + 1; i++)
+			if (i >= 0 && i < auCount_ && (touchedCount == 0
+			|| touched[touchedCount - 1] < i))
+				touched[touchedCount++] = i;
+	BridgeSet bs;
+	int lastRow = -1, lastColumn = -1;
+	for (k = 0; k < touchedCount; k++) {
+		for (i = max(touched[k] - 1, lastRow + 1); i <= touched[k];
+									i++) {
+			const BondList &l = hBond_->donors(i);
+			for (j = 0; j < l.count; j++)
+				bs.addBond(i, l.residue[j], auCount_);
+			lastRow = i;
+		}
+		for (i = max(touched[k], lastColumn + 1);
+		i <= touched[k] + 1 && i < auCount_; i++) {
+			const BondList &l = hBond_->acceptors(i);
+			for (j = 0; j < l.count; j++)
+				bs.addBond(l.residue[j], i, auCount_);
+			lastColumn = i;
+		}
+	}
+	bs.sort();
+	markBridges(&bs);
+	int bridgesChanged = bridges_->replace(bs, touched, touchedCount);
+	delete [] touched;
+	if (!bridgesChanged) {
+		lap(T_BRIDGES);
+		observeTimes();
+		return;
+	}
+
+	for (i = 0; i < auCount_; i++)
+		residue_[i].clearFlag(R_PBRIDGE | R_ABRIDGE);
+	markBridges(bridges_);
+	clearSheets();
+	findLadders(bridges_);
+	lap(T_BRIDGES);
+	findSheets();
+	lap(T_SHEETS);
+	observeTimes();
+}
+
+//
+// Copy constructor for Model (same topology, coordinates and
+// symmetry copies, but no secondary structure), so that frames
+// may be processed independently
+//
+Model::Model(const Model &m)
+	: error_(m.error_), helixList_(), ladderList_(), sheetList_(),
+	  fileRecord_(m.fileRecord_), copyBondsList_()
+{
+	anyMore_ = m.anyMore_;
+	modelNumber_ = m.modelNumber_;
+	topology_ = m.topology_;
+	topology_->ref();
+	int n = m.auCount_;
+	coord_ = NULL;
+	growCoords(0, n > 0 ? n : 1);
+	if (n > 0)
+		memcpy(coord_, m.coord_, n * sizeof coord_[0]);
+	makeResidues();
+	hBond_ = NULL;
+	keepBonds_ = 0;
+	bridges_ = NULL;
+	copies_ = m.copies_;
+	copyOp_ = NULL;
+	if (m.copyOp_ != NULL) {
+		copyOp_ = new Operator[copies_];
+		for (int c = 0; c < copies_; c++)
+			copyOp_[c] = m.copyOp_[c];
+	}
+	copyBonds_ = NULL;
+	neighbors_ = NULL;
+	cGrid_ = NULL;
+	nGrid_ = NULL;
+	result_ = NULL;
+	times_ = m.times_ != NULL ? new StageTimes(m.times_->model()) : NULL;
+	options_ = m.options_;
+	warnings_ = m.warnings_;
+#ifdef WITH_STATS
+	stats_ = countWork ? new WorkStats : NULL;
+#endif
+}
+
+//
+// Resize the coordinate array (keeping the first n residues)
+//
+void
+Model::growCoords(int n, int size)
+{
+	float (*coord)[A_COUNT][3] = new float[size][A_COUNT][3];
+	if (n > 0)
+		memcpy(coord, coord_, n * sizeof coord[0]);
+	delete [] coord_;
+	coord_ = coord;
+	coordSize_ = size;
+}
+
+//
+// Resize the residue array (keeping the residues in use)
+//
+void
+Model::growResidues(int size)
+{
+	Residue *r = new Residue[size];
+	for (int i = 0; i < residueCount_; i++)
+		r[i] = residue_[i];
+	delete [] residue_;
+	residue_ = r;
+	residueSize_ = size;
 }
 
 //
@@ -117,18 +1493,28 @@ done:
 Model::~Model(void)
 {
 	Pix p;
-	for (p = rList_.first(); p != 0; rList_.next(p))
-		delete rList_(p);
 	for (p = helixList_.first(); p != 0; helixList_.next(p))
 		delete helixList_(p);
 	for (p = ladderList_.first(); p != 0; ladderList_.next(p))
 		delete ladderList_(p);
 	for (p = sheetList_.first(); p != 0; sheetList_.next(p))
 		delete sheetList_(p);
-	if (rList_.count() > 0) {
-		delete rArray_;
-		delete hBond_;
-	}
+	for (p = copyBondsList_.first(); p != 0; copyBondsList_.next(p))
+		delete copyBondsList_(p);
+	delete [] residue_;
+	delete [] coord_;
+	topology_->unref();
+	delete [] copyOp_;
+	delete [] copyBonds_;
+	delete neighbors_;
+	delete hBond_;
+	delete bridges_;
+	delete cGrid_;
+	delete nGrid_;
+	delete times_;
+#ifdef WITH_STATS
+	delete stats_;
+#endif
 }
 
 //
@@ -137,17 +1523,39 @@ Model::~Model(void)
 void
 Model::defineSecondaryStructure(void)
 {
+	// The hydrogen bonds are only needed while assigning
+	// (unless kept for updateCoords and appendResidue)
+	STATS_FOR(stats_);
+	startTimes();
+	if (times_ != NULL)
+		times_->countRun();
+	if (hBond_ == NULL)
+		hBond_ = new BondTable;
 	addImideHydrogens();
+	lap(T_HYDROGENS);
 	findHBonds();
+	if (copies_ > 1)
+		expandCopies();
+	lap(T_HBONDS);
 
-	findTurns(3);
-	markHelices(3);
-	findTurns(4);
-	markHelices(4);
+	int last = residueCount_ - 1;
+	findTurns(3, 0, last);
+	markHelices(3, 0, last);
+	findTurns(4, 0, last);
+	markHelices(4, 0, last);
+	lap(T_TURNS);
 	findHelices();
+	lap(T_HELICES);
 
 	findBridges();
+	lap(T_BRIDGES);
 	findSheets();
+	lap(T_SHEETS);
+	observeTimes();
+	if (!keepBonds_) {
+		delete hBond_;
+		hBond_ = NULL;
+	}
 }
 
 //
@@ -157,8 +1565,8 @@ void
 Model::printResidues(FILE *output) const
 {
 	int sn = 1;
-	for (Pix p = rList_.first(); p != 0; rList_.next(p))
-		sn = rList_(p)->printAtoms(output, sn);
+	for (int i = 0; i < residueCount_; i++)
+		sn = residue_[i].printAtoms(output, sn);
 }
 
 //
@@ -167,6 +1575,7 @@ Model::printResidues(FILE *output) const
 void
 Model::printSummary(FILE *output) const
 {
+	startTimes();
 	(void) fputs("Helix Summary\n", output);
 	Pix p;
 	for (p = helixList_.first(); p != 0; helixList_.next(p)) {
@@ -217,155 +1626,342 @@ Model::printSummary(FILE *output) const
 	}
 	(void) fputs("\n", output);
 
-	(void) fputs("Residue Summary\n", output);
-	for (p = rList_.first(); p != 0; rList_.next(p))
-		rList_(p)->printSummary(output);
+	(void) fputs("Residue Summary\n", output);
+	for (int n = 0; n < residueCount_; n++) {
+		if (copies_ > 1 && n % auCount_ == 0 && n > 0)
+			(void) fprintf(output, "MTRIX %d\n",
+				copyOp_[n / auCount_].serialNum());
+		residue_[n].printSummary(output);
+	}
+	lap(T_OUTPUT);
+}
+
+//
+// Store the secondary structure code of each residue (see
+// Residue::summaryCode) in codes
+//
+void
+Model::summaryCodes(char *codes) const
+{
+	for (int n = 0; n < residueCount_; n++)
+		codes[n] = residue_[n].summaryCode();
+}
+
+//
+// Add the input of the asymmetric unit to a digest: for each residue,
+// its identity, whether it ends a chain, the atoms present and their
+// coordinates as read (before any imide hydrogens are added)
+//
+void
+Model::digestInput(Sha256 &digest) const
+{
+	int count = topology_->count();
+	digest.update(&count, sizeof count);
+	for (int i = 0; i < count; i++) {
+		const PDB::Residue &r = topology_->residue(i);
+		char id[8];
+		(void) memset(id, 0, sizeof id);
+		(void) memcpy(id, r.name, strnlen(r.name, 4));
+		id[4] = r.chainId;
+		id[5] = r.insertCode;
+		id[6] = (topology_->flags(i) & R_TER) != 0;
+		int atoms = topology_->atoms(i);
+		id[7] = (char) atoms;
+		digest.update(id, sizeof id);
+		digest.update(&r.seqNum, sizeof r.seqNum);
+		for (int slot = 0; slot < A_COUNT; slot++)
+			if (atoms & (1 << slot))
+				digest.update(coord_[i][slot],
+						sizeof coord_[i][slot]);
+	}
 }
 
 //
-// Print pdb HELIX records
+// Print pdb HELIX records (from the result set with setResult, if any)
 // id is a zero-based counter of the number of HELIX records printed
 //
 int
 Model::printHelix(FILE *output, int id) const
+{
+	startTimes();
+	if (result_ != NULL)
+		for (int i = 0; i < result_->helixCount(); i++) {
+			const SSHelix &h = result_->helix(i);
+			id = printHelixRecord(output, id, h.from, h.to, h.type);
+		}
+	else
+		for (Pix p = helixList_.first(); p != 0; helixList_.next(p)) {
+			Helix *h = helixList_(p);
+			id = printHelixRecord(output, id, h->from(), h->to(),
+								h->type());
+		}
+	lap(T_OUTPUT);
+	return id;
+}
+
+//
+// Print the HELIX record for residues from through to
+//
+int
+Model::printHelixRecord(FILE *output, int id, int from, int to,
+							int type) const
 {
 	PDB pdb(PDB::HELIX);
 
 	PDB::Helix &helix = pdb.helix;
-	helix.comment[0] = '\0';
-	for (Pix p = helixList_.first(); p != 0; helixList_.next(p)) {
-		id++;
-		Helix *h = helixList_(p);
-		helix.serialNum = id;
-		(void) sprintf(helix.id, "%d", id);
-		helix.residues[0] = residue(h->from())->residue();
-		helix.residues[1] = residue(h->to())->residue();
-		helix.type = h->type();
-		(void) fprintf(output, "%-71.71s%5d\n", pdb.chars(),
-				h->to() - h->from() + 1);
-	}
+	id++;
+	helix.serialNum = id;
+	(void) sprintf(helix.id, "%d", id);
+	helix.residues[0] = residue(from)->residue();
+	helix.residues[1] = residue(to)->residue();
+	helix.type = type;
+	if (copies_ > 1 && from >= auCount_)
+		(void) sprintf(helix.comment, "MTRIX %d",
+			copyOp_[from / auCount_].serialNum());
+	else
+		helix.comment[0] = '\0';
+	(void) fprintf(output, "%-71.71s%5d\n", pdb.chars(), to - from + 1);
+	PROBE4(helix, modelNumber_, residueCount_, id, to - from + 1);
 	return id;
 }
 
 //
-// Print pdb SHEET records
-// sid is a zero-based counter of the number of HELIX records printed
+// Print pdb SHEET records (from the result set with setResult, if any)
+// sid is a zero-based counter of the number of sheets printed
 //
-char
+int
 Model::printSheet(FILE *output, int sid) const
 {
-	//
-	// Printing the sheet records is a bit tricky because
-	// we need to derive the strands from the ladders.
-	// We do so by first creating an ordered array of the
-	// ladders.  We then define the first strand (method
-	// depends on whether the sheet is cyclic or not), and
-	// then iterate through.  We also have to do some post-
-	// processing if the sheet is cyclic
-	//
-	PDB pdb(PDB::SHEET);
-	PDB::Sheet &sheet = pdb.sheet;
+	startTimes();
+	if (result_ != NULL) {
+		for (int i = 0; i < result_->sheetCount(); i++) {
+			const SSSheet &s = result_->sheet(i);
+			sid = printStrands(output, sid,
+					&result_->strand(s.firstStrand),
+					s.strandCount, s.cyclic);
+		}
+		lap(T_OUTPUT);
+		return sid;
+	}
 	for (Pix p = sheetList_.first(); p != 0; sheetList_.next(p)) {
 		Sheet *s = sheetList_(p);
-		Ladder *fl = s->firstLadder();
-		Ladder *pl = NULL;
-		Ladder *spl = NULL;
 		int ladderCount = s->ladderList().count();
-		Ladder **lList = new Ladder *[ladderCount];
-		int i = 0;
-		for (Ladder *l = fl; l != NULL && !(l == fl && pl != NULL);
-		spl = l, l = l->otherNeighbor(pl), pl = spl)
-			lList[i++] = l;
-		if (i != ladderCount) {
+		Strand *strands = new Strand[ladderCount + 1];
+		int cyclic;
+		int count = sheetStrands(s, strands, &cyclic);
+		int found = cyclic ? count : count - 1;
+		if (found != ladderCount)
 			(void) fprintf(stderr,
 				"Inconsistent ladder count for sheet %c "
 				"(%d should be %d)\n",
-				s->name(), i, ladderCount);
-			ladderCount = i;
+				s->name(), found, ladderCount);
+		sid = printStrands(output, sid, strands, count, cyclic);
+		delete [] strands;
+	}
+	lap(T_OUTPUT);
+	return sid;
+}
+
+//
+// Read the models of a PDB file (those with atoms) from input into
+// modelList
+// Return 0 on success and -1 (with error set) on error
+//
+int
+Model::readModels(FILE *input, List<Model> &modelList, std::string &error)
+{
+	for (;;) {
+		Model *m = new Model(input);
+		if (!m->okay()) {
+			error = m->error();
+			delete m;
+			return -1;
 		}
-		int cyclic = fl->neighborCount() > 1;
-		int overlap[2];
+		int anyMore = m->anyMore();
+		if (m->anyAtoms())
+			modelList.append(m);
+		else
+			delete m;
+		if (!anyMore)
+			return 0;
+	}
+}
+
+//
+// Print helix and sheet records for all models to output (if not NULL)
+// and chain summaries to summary (if not NULL)
+//
+void
+Model::printStructure(List<Model> &modelList, FILE *output, FILE *summary)
+{
+	Pix p;
+	Pix hp = output != NULL ? modelList.first() : 0;
+	Pix sp = hp;
+	int fileCount = 0;
+	while (hp != 0) {
+		if (fileCount++ > 0)
+			(void) fprintf(output, "%s\n", PDB(PDB::END).chars());
+		int helixId = 0;
+		int sheetId = 0;
+		Model *m = modelList(hp);
+		if (m->modelNumber() != -1)
+			fprintf(output, "%s\n", m->fileRecord().chars());
+		int modelNumber = m->modelNumber();
+		for (; hp != 0 && modelList(hp)->modelNumber() == modelNumber;
+		modelList.next(hp))
+			helixId = modelList(hp)->printHelix(output, helixId);
+		for (; sp != hp; modelList.next(sp))
+			sheetId = modelList(sp)->printSheet(output, sheetId);
+	}
+	if (fileCount > 1)
+		(void) fprintf(output, "%s\n", PDB(PDB::END).chars());
+
+	// Print chain summaries
+	if (summary != NULL)
+		for (p = modelList.first(); p != 0; modelList.next(p))
+			modelList(p)->printSummary(summary);
+	for (p = modelList.first(); p != 0; modelList.next(p))
+		modelList(p)->observeTimes();
+}
 
-		PDB firstStrand(PDB::SHEET);
-		PDB::Sheet &firstSheet = firstStrand.sheet;
-		char sheetId[4];
-		int idLen = 0;
-		int idCount = sid++;
-		sheetId[idLen++] = 'A' + (idCount % 26);
+//
+// Print the SHEET records for one sheet, given its strands as found
+// by sheetStrands.  The first strand of a cyclic sheet is printed
+// again at the end, with the registration that closes the cycle.
+//
+int
+Model::printStrands(FILE *output, int sid, const Strand *strands,
+						int count, int cyclic) const
+{
+	char id[4];
+	int idLen = 0;
+	char sheetId[4];
+	int idCount = sid++;
+	sheetId[idLen++] = 'A' + (idCount % 26);
+	idCount = idCount / 26;
+	while (idLen < 3 && idCount > 0) {
+		sheetId[idLen++] = 'A' + (idCount % 26) - 1;
 		idCount = idCount / 26;
-		while (idLen < 3 && idCount > 0) {
-			sheetId[idLen++] = 'A' + (idCount % 26) - 1;
-			idCount = idCount / 26;
-		}
-		char *idPtr = firstSheet.id;
-		while (--idLen >= 0)
-			*idPtr++ = sheetId[idLen];
-		*idPtr++ = '\0';
-		firstSheet.count = ladderCount;
-		firstSheet.strandNum = 1;
-		firstSheet.sense = 0;
-		if (cyclic) {
-			pl = lList[ladderCount - 1];
-			(void) fl->overlaps(pl, overlap);
-			int start = min(fl->start(overlap[0]),
-					pl->start(overlap[1]));
-			int end = max(fl->end(overlap[0]),
-					pl->end(overlap[1]));
-			firstSheet.residues[0] = residue(start)->residue();
-			firstSheet.residues[1] = residue(end)->residue();
-			(void) fprintf(output, "%s\n", firstStrand.chars());
-			registerLadder(pl, &firstSheet, overlap[1]);
+	}
+	char *idPtr = id;
+	while (--idLen >= 0)
+		*idPtr++ = sheetId[idLen];
+	*idPtr++ = '\0';
+
+	for (int i = 0; i <= count; i++) {
+		if (i == count && !cyclic)
+			break;
+		const Strand &st = strands[i % count];
+		PDB pdb(PDB::SHEET);
+		PDB::Sheet &sheet = pdb.sheet;
+		(void) strcpy(sheet.id, id);
+		sheet.count = count;
+		sheet.strandNum = i % count + 1;
+		sheet.residues[0] = residue(st.start)->residue();
+		sheet.residues[1] = residue(st.end)->residue();
+		if (i > 0) {
+			sheet.sense = st.sense;
+			(void) strcpy(sheet.atoms[0].name, " N");
+			sheet.atoms[0].residue =
+				residue(st.nResidue)->residue();
+			(void) strcpy(sheet.atoms[1].name, " O");
+			sheet.atoms[1].residue =
+				residue(st.oResidue)->residue();
 		}
+		else
+			sheet.sense = 0;
+		(void) fprintf(output, "%s\n", pdb.chars());
+	}
+	PROBE4(sheet, modelNumber_, residueCount_, sid, count);
+	return sid;
+}
+
+//
+// Find the strands of a sheet, in the order of its SHEET records.
+// There are as many strands as ladders, plus one unless the sheet is
+// cyclic; the first strand of a cyclic sheet is registered with the
+// last one, and that of other sheets has no registration.  Returns
+// the number of strands.
+//
+int
+Model::sheetStrands(Sheet *s, Strand *strands, int *cyclic) const
+{
+	//
+	// The strands are derived from the ladders.  We do so by
+	// first creating an ordered array of the ladders.  We then
+	// define the first strand (method depends on whether the
+	// sheet is cyclic or not), and then iterate through.
+	//
+	Ladder *fl = s->firstLadder();
+	Ladder *pl = NULL;
+	Ladder *spl = NULL;
+	int ladderCount = s->ladderList().count();
+	Ladder **lList = new Ladder *[ladderCount];
+	int i = 0;
+	for (Ladder *l = fl; l != NULL && !(l == fl && pl != NULL);
+	spl = l, l = l->otherNeighbor(pl), pl = spl)
+		lList[i++] = l;
+	ladderCount = i;
+	*cyclic = fl->neighborCount() > 1;
+	int overlap[2];
+	int n = 0;
+
+	if (*cyclic) {
+		pl = lList[ladderCount - 1];
+		(void) fl->overlaps(pl, overlap);
+		Strand &st = strands[n++];
+		st.start = min(fl->start(overlap[0]), pl->start(overlap[1]));
+		st.end = max(fl->end(overlap[0]), pl->end(overlap[1]));
+		registerLadder(pl, &st, overlap[1]);
+	}
+	else {
+		if (ladderCount == 1)
+			// If there is only one ladder, then strand 0
+			// comes first, then strand 1
+			overlap[0] = 0;
 		else {
-			firstSheet.count++;
-			if (ladderCount == 1)
-				// If there is only one ladder, then we print
-				// strand 0 first, then strand 1
-				overlap[0] = 0;
-			else {
-				// If there are more than one ladder, then
-				// we find the overlapping strand with the
-				// next ladder and use the other one
-				(void) fl->overlaps(lList[1], overlap);
-				overlap[0] = 1 - overlap[0];
-			}
-			firstSheet.residues[0] =
-				residue(fl->start(overlap[0]))->residue();
-			firstSheet.residues[1] =
-				residue(fl->end(overlap[0]))->residue();
-			(void) fprintf(output, "%s\n", firstStrand.chars());
-		}
-
-		sheet = firstSheet;
-		for (i = 1; i < ladderCount; i++) {
-			Ladder *l = lList[i];
-			pl = lList[i - 1];
-			(void) l->overlaps(pl, overlap);
-			sheet.strandNum++;
-			int start = min(l->start(overlap[0]),
-					pl->start(overlap[1]));
-			int end = max(l->end(overlap[0]),
-					pl->end(overlap[1]));
-			sheet.residues[0] = residue(start)->residue();
-			sheet.residues[1] = residue(end)->residue();
-			registerLadder(pl, &sheet, 1 - overlap[1]);
-			(void) fprintf(output, "%s\n", pdb.chars());
-		}
-
-		if (cyclic)
-			(void) fprintf(output, "%s\n", firstStrand.chars());
-		else {
-			sheet.strandNum++;
-			int n = 1 - overlap[0];
-			Ladder *&last = lList[ladderCount - 1];
-			sheet.residues[0] = residue(last->start(n))->residue();
-			sheet.residues[1] = residue(last->end(n))->residue();
-			registerLadder(last, &sheet, overlap[0]);
-			(void) fprintf(output, "%s\n", pdb.chars());
+			// If there are more than one ladder, then
+			// we find the overlapping strand with the
+			// next ladder and use the other one
+			(void) fl->overlaps(lList[1], overlap);
+			overlap[0] = 1 - overlap[0];
 		}
-		delete [] lList;
+		Strand &st = strands[n++];
+		st.start = fl->start(overlap[0]);
+		st.end = fl->end(overlap[0]);
+		st.sense = 0;
+		st.nResidue = st.oResidue = -1;
 	}
-	return sid;
+
+	for (i = 1; i < ladderCount; i++) {
+		Ladder *l = lList[i];
+		pl = lList[i - 1];
+		(void) l->overlaps(pl, overlap);
+		Strand &st = strands[n++];
+		st.start = min(l->start(overlap[0]), pl->start(overlap[1]));
+		st.end = max(l->end(overlap[0]), pl->end(overlap[1]));
+		registerLadder(pl, &st, 1 - overlap[1]);
+	}
+
+	if (!*cyclic) {
+		int other = 1 - overlap[0];
+		Ladder *last = lList[ladderCount - 1];
+		Strand &st = strands[n++];
+		st.start = last->start(other);
+		st.end = last->end(other);
+		registerLadder(last, &st, overlap[0]);
+	}
+	delete [] lList;
+	return n;
+}
+
+//
+// Set the energy cutoff for hydrogen bondedness
+//
+void
+Model::setHBondCutoff(float cutoff)
+{
+	hBondCutoff = cutoff;
 }
 
 //
@@ -390,9 +1986,121 @@ Model::setMinStrandLength(int n)
 // Set whether we should try to merge ladders in beta-bulges
 //
 void
-Model::ignoreBulges(void)
+Model::ignoreBulges(int ignore)
+{
+	checkBulges = !ignore;
+}
+
+//
+// Set whether problems found while assigning (such as strands paired
+// with too many ladders) are reported on stderr
+//
+void
+Model::setWarnings(int on)
+{
+	warnings = on;
+}
+
+//
+// Set the options and whether warnings are reported for this model
+// alone (models start with the settings of the functions above)
+//
+void
+Model::setOptions(const SSOptions &options, int warnings)
+{
+	options_ = options;
+	warnings_ = warnings;
+}
+
+//
+// Take the options and warnings setting made for all models
+//
+void
+Model::useDefaults(void)
+{
+	options_.hBondCutoff = hBondCutoff;
+	options_.minHelixLength = minHelixLength;
+	options_.minStrandLength = minStrandLength;
+	options_.checkBulges = checkBulges;
+	warnings_ = warnings;
+}
+
+//
+// Set whether MTRIX operators should be used to generate copies
+// of each model (the input being the asymmetric unit)
+//
+void
+Model::useMtrix(void)
+{
+	expandMtrix = 1;
+}
+
+//
+// Forget the state carried between models read from the same input
+// (model number, atom index, MTRIX operators and the last topology),
+// as at the end of a file, before reading another input
+//
+void
+Model::endInput(void)
+{
+	curModelNumber = -1;
+	curAtomIndex = 0;
+	for (Pix p = mtrixList.first(); p != 0; mtrixList.next(p))
+		delete mtrixList(p);
+	mtrixList.clear();
+	delete mtrixOp;
+	mtrixOp = NULL;
+	if (lastTopology != NULL) {
+		lastTopology->unref();
+		lastTopology = NULL;
+	}
+}
+
+//
+// Set the distance beyond the hydrogen bond cutoff within which
+// residue pairs are kept as candidates, so that the candidates can
+// be reused while atoms move by less than half of it (e.g., between
+// trajectory frames)
+//
+void
+Model::setNeighborSkin(float skin)
+{
+	neighborSkin = skin;
+}
+
+//
+// Record the time spent in each stage (see Timings.h) for models
+// created from now on
+//
+void
+Model::recordTimes(int on)
+{
+	timeStages = on;
+}
+
+//
+// Count the work done (see Stats.h) for models created from now on
+// (if counting is compiled in)
+//
+void
+Model::recordStats(int on)
+{
+	countWork = on;
+}
+
+//
+// Add the stage times and work counts of another model (e.g., a copy
+// used for some of the frames of a trajectory)
+//
+void
+Model::addProfile(const Model &m)
 {
-	checkBulges = 0;
+	if (times_ != NULL && m.times_ != NULL)
+		times_->add(*m.times_);
+#ifdef WITH_STATS
+	if (stats_ != NULL && m.stats_ != NULL)
+		stats_->add(*m.stats_);
+#endif
 }
 
 //
@@ -401,10 +2109,9 @@ Model::ignoreBulges(void)
 void
 Model::addImideHydrogens(void)
 {
-	Pix p = rList_.first();
-	Residue *prev = rList_(p);
-	for (rList_.next(p); p != 0; rList_.next(p)) {
-		Residue *r = rList_(p);
+	Residue *prev = residue(0);
+	for (int i = 1; i < residueCount_; i++) {
+		Residue *r = residue(i);
 		(void) r->addImideHydrogen(prev);
 		if (r->flag(R_TER))
 			prev = NULL;
@@ -416,52 +2123,241 @@ Model::addImideHydrogens(void)
 //
 // Find hydrogen bonds
 //
+// Only the residue pairs in the neighbor list are examined; the list
+// is rebuilt if some C or N atom has moved by more than half the
+// skin distance since it was built.
+//
 void
 Model::findHBonds(void)
 {
-	int max = rArray_->count();
-	for (int i = 0; i < max; i++)
-		for (int j = i + 2; j < max; j++) {
-			(*hBond_)(i, j) = residue(i)->hBondedTo(residue(j));
-			(*hBond_)(j, i) = residue(j)->hBondedTo(residue(i));
+	hBond_->resize(auCount_);
+	hBond_->clear();
+	if (neighbors_ == NULL)
+		neighbors_ = new NeighborList;
+	if (!neighbors_->valid(residue_, auCount_, neighborSkin))
+		findNeighbors(7.0 + neighborSkin);
+	for (int k = 0; k < neighbors_->count(); k++) {
+		int a = neighbors_->acceptor(k);
+		int d = neighbors_->donor(k);
+		if (residue(a)->hBondedTo(residue(d), options_.hBondCutoff))
+			hBond_->add(a, d);
+	}
+	countPairs(neighbors_->count());
+}
+
+//
+// Build the neighbor list: residue pairs (not adjacent in sequence)
+// whose C and N atoms are within cutoff
+//
+// The N atoms are hashed into cubes with sides of the cutoff, and
+// each C atom is compared only with those in the cubes around it, so
+// the time grows with the number of residues rather than its square.
+//
+void
+Model::findNeighbors(float cutoff)
+{
+	neighbors_->start(residue_, auCount_);
+
+	// Slightly generous, so that rounding never loses a pair
+	float cutoff2 = cutoff * cutoff + 1e-3;
+	AtomGrid grid(A_N, sqrtf(cutoff2));
+	int i;
+	for (i = 0; i < auCount_; i++)
+		grid.add(i, residue(i));
+	for (i = 0; i < auCount_; i++) {
+		const float *c = residue(i)->atom(A_C);
+		if (c == NULL)
+			continue;
+		for (int k = grid.findNear(c); k-- > 0; ) {
+			int j = grid.found(k);
+			if (j - i < 2 && i - j < 2)
+				continue;
+			if (distSquared(c, residue(j)->atom(A_N)) <= cutoff2)
+				neighbors_->add(i, j);
+		}
+	}
+}
+
+//
+// Add residues for the symmetry copies of the asymmetric unit and find
+// the hydrogen bonds between copies that come within contact distance.
+// Bonds within each copy are the same as those of the asymmetric unit
+// and bonds between two copies only depend on their relative placement,
+// so each distinct relative operator is only evaluated once.
+//
+void
+Model::expandCopies(void)
+{
+	// Bounding sphere of the C and N atoms
+	float center[3] = { 0, 0, 0 };
+	int count = 0;
+	int i, k;
+	for (i = 0; i < auCount_; i++) {
+		const float *backbone[2] = { residue(i)->atom(A_C),
+						residue(i)->atom(A_N) };
+		for (k = 0; k < 2; k++) {
+			const float *c = backbone[k];
+			if (c == NULL)
+				continue;
+			for (int d = 0; d < 3; d++)
+				center[d] += c[d];
+			count++;
+		}
+	}
+	if (count == 0)
+		return;
+	for (k = 0; k < 3; k++)
+		center[k] /= count;
+	float radius = 0;
+	for (i = 0; i < auCount_; i++) {
+		const float *backbone[2] = { residue(i)->atom(A_C),
+						residue(i)->atom(A_N) };
+		for (k = 0; k < 2; k++)
+			if (backbone[k] != NULL) {
+				float d = distance(center, backbone[k]);
+				if (d > radius)
+					radius = d;
+			}
+	}
+
+	float (*copyCenter)[3] = new float[copies_][3];
+	for (int c = 0; c < copies_; c++)
+		copyOp_[c].apply(copyCenter[c], center);
+	copyBonds_ = new CopyBonds *[copies_ * copies_];
+	for (int c1 = 0; c1 < copies_; c1++)
+		for (int c2 = 0; c2 < copies_; c2++) {
+			CopyBonds *&cb = copyBonds_[c1 * copies_ + c2];
+			cb = NULL;
+			if (c1 == c2 || distance(copyCenter[c1],
+					copyCenter[c2]) > 2 * radius + 7.0)
+				continue;
+			Operator rel;
+			copyOp_[c1].relative(copyOp_[c2], &rel);
+			for (Pix p = copyBondsList_.first(); p != 0;
+			copyBondsList_.next(p))
+				if (copyBondsList_(p)->op().sameAs(rel)) {
+					cb = copyBondsList_(p);
+					break;
+				}
+			if (cb == NULL) {
+				cb = new CopyBonds(rel, residue_, auCount_,
+							options_.hBondCutoff);
+				copyBondsList_.append(cb);
+			}
 		}
+	delete [] copyCenter;
+
+	// Residues of the copies share identity and coordinates with
+	// the asymmetric unit; only their flags are their own
+	residueCount_ = copies_ * auCount_;
+	residueSize_ = residueCount_;
+	Residue *r = new Residue[residueCount_];
+	for (i = 0; i < residueCount_; i++)
+		r[i] = residue_[i % auCount_];
+	delete [] residue_;
+	residue_ = r;
+}
+
+//
+// Check if residue i is hydrogen bonded to residue j
+// (as found by findHBonds, so residues adjacent in sequence never are)
+//
+int
+Model::hBonded(int i, int j)
+{
+	int max = residueCount_;
+	if (i < 0 || i >= max || j < 0 || j >= max)
+		return 0;
+	if (copies_ == 1)
+		return hBond_->bonded(i, j);
+	int ci = i / auCount_;
+	int cj = j / auCount_;
+	if (ci == cj)
+		return hBond_->bonded(i % auCount_, j % auCount_);
+	if (i - j < 2 && j - i < 2)
+		return 0;
+	CopyBonds *cb = copyBonds_[ci * copies_ + cj];
+	return cb != NULL && cb->bonded(i % auCount_, j % auCount_);
 }
 
 //
-// Find the n-turns (n = 3,4)
+// Check if residue i is hydrogen bonded to residue j
+// (regardless of their separation in sequence)
+//
+int
+Model::residueHBonded(int i, int j) const
+{
+	if (copies_ == 1)
+		return residue(i)->hBondedTo(residue(j), options_.hBondCutoff);
+	int ci = i / auCount_;
+	int cj = j / auCount_;
+	if (ci == cj)
+		return residue(i % auCount_)->hBondedTo(residue(j % auCount_),
+							options_.hBondCutoff);
+	CopyBonds *cb = copyBonds_[ci * copies_ + cj];
+	return cb != NULL && cb->bonded(i % auCount_, j % auCount_);
+}
+
+//
+// Get coordinates of the named atom of residue n
+//
+int
+Model::atomCoord(int n, int slot, float xyz[3]) const
+{
+	const float *a = residue(n % auCount_)->atom(slot);
+	if (a == NULL)
+		return -1;
+	if (n < auCount_) {
+		for (int i = 0; i < 3; i++)
+			xyz[i] = a[i];
+	}
+	else
+		copyOp_[n / auCount_].apply(xyz, a);
+	return 0;
+}
+
+//
+// Find the n-turns (n = 3,4), setting flags only for residues
+// lo to hi
 //
 void
-Model::findTurns(int n)
+Model::findTurns(int n, int lo, int hi)
 {
 	int donor = n == 3 ? R_3DONOR : R_4DONOR;
 	int acceptor = n == 3 ? R_3ACCEPTOR : R_4ACCEPTOR;
 	int gap = n == 3 ? R_3GAP : R_4GAP;
-	int max = rArray_->count() - n;
-	for (int i = 0; i < max; i++)
+	int max = residueCount_ - n;
+	if (max > hi + 1)
+		max = hi + 1;
+	for (int i = lo - n < 0 ? 0 : lo - n; i < max; i++)
 		if (hBonded(i, i + n)) {
-			residue(i)->setFlag(acceptor);
+			if (i >= lo)
+				residue(i)->setFlag(acceptor);
 			for (int j = 1; j < n; j++)
-				residue(i + j)->setFlag(gap);
-			residue(i + n)->setFlag(donor);
+				if (i + j >= lo && i + j <= hi)
+					residue(i + j)->setFlag(gap);
+			if (i + n <= hi)
+				residue(i + n)->setFlag(donor);
 		}
 }
 
 //
-// Mark helices based on n-turn information
+// Mark helices based on n-turn information, for residues lo to hi
 //
 void
-Model::markHelices(int n)
+Model::markHelices(int n, int lo, int hi)
 {
-	int donor = n == 3 ? R_3DONOR : R_4DONOR;
 	int acceptor = n == 3 ? R_3ACCEPTOR : R_4ACCEPTOR;
-	int gap = n == 3 ? R_3GAP : R_4GAP;
 	int helix = n == 3 ? R_3HELIX : R_4HELIX;
-	int max = rArray_->count() - n;
-	for (int i = 1; i < max; i++)
+	int max = residueCount_ - n;
+	if (max > hi + 1)
+		max = hi + 1;
+	for (int i = lo - n + 1 < 1 ? 1 : lo - n + 1; i < max; i++)
 		if (residue(i - 1)->flag(acceptor)
 		&&  residue(i)->flag(acceptor))
 			for (int j = 0; j < n; j++)
-				residue(i + j)->setFlag(helix);
+				if (i + j >= lo && i + j <= hi)
+					residue(i + j)->setFlag(helix);
 }
 
 //
@@ -470,7 +2366,7 @@ Model::markHelices(int n)
 void
 Model::findHelices(void)
 {
-	int max = rArray_->count();
+	int max = residueCount_;
 	int first = -1;
 	for (int i = 0; i < max; i++)
 		if (residue(i)->flag(R_3HELIX | R_4HELIX)) {
@@ -478,7 +2374,7 @@ Model::findHelices(void)
 				first = i;
 		}
 		else if (first >= 0) {
-			if (i - first >= minHelixLength) {
+			if (i - first >= options_.minHelixLength) {
 				Helix *h = new Helix(first, i - 1);
 				helixList_.append(h);
 				h->setType(helixClass(h));
@@ -487,107 +2383,236 @@ Model::findHelices(void)
 		}
 }
 
+//
+// Find the helices again among residues lo to hi, whose helix flags
+// have changed, and the runs of helix flags reaching into them, as
+// findHelices would; the helices elsewhere are kept.  Only the
+// helix list is walked to find where they go.
+//
+void
+Model::updateHelices(int lo, int hi)
+{
+	int max = residueCount_;
+	while (lo > 0 && residue(lo - 1)->flag(R_3HELIX | R_4HELIX))
+		lo--;
+	while (hi + 1 < max && residue(hi + 1)->flag(R_3HELIX | R_4HELIX))
+		hi++;
+	Pix prev = 0;
+	Pix p = helixList_.first();
+	while (p != 0 && helixList_(p)->to() < lo) {
+		prev = p;
+		helixList_.next(p);
+	}
+	while (p != 0 && helixList_(p)->from() <= hi) {
+		Helix *h = helixList_(p);
+		helixList_.next(p);
+		(void) helixList_.remove(h);
+		delete h;
+	}
+	int first = -1;
+	for (int i = lo; i <= hi + 1 && i < max; i++)
+		if (residue(i)->flag(R_3HELIX | R_4HELIX)) {
+			if (first < 0)
+				first = i;
+		}
+		else if (first >= 0) {
+			if (i - first >= options_.minHelixLength) {
+				Helix *h = new Helix(first, i - 1);
+				prev = helixList_.insert(prev, h);
+				h->setType(helixClass(h));
+			}
+			first = -1;
+		}
+}
+
 //
 // Find bridges
 //
 void
 Model::findBridges(void)
 {
-	int max = rArray_->count();
+	// First we collect the residue pairs that could form a bridge
+	// given the hydrogen bonds, and mark the bridges among them
+	BridgeSet *bs = new BridgeSet;
+	addBridgeCandidates(bs);
+	bs->sort();
+	markBridges(bs);
+	findLadders(bs);
+	if (keepBonds_) {
+		delete bridges_;
+		bridges_ = bs;
+	}
+	else
+		delete bs;
+}
 
-	// First we construct a matrix and mark the bridges
-	SquareArray<char> bridge(max);
-	bridge.zero();
-	int i;
-	for (i = 1; i < max; i++) {
-		for (int j = i + 1; j < max; j++) {
+//
+// Mark the candidates that are bridges (unless already marked) and
+// flag their residues
+//
+void
+Model::markBridges(BridgeSet *bs)
+{
+	for (int n = 0; n < bs->count(); n++) {
+		Bridge &b = (*bs)[n];
+		int i = b.i;
+		int j = b.j;
+		if (b.type == '\0') {
+			STAT(S_CANDIDATES);
 			if ((hBonded(i - 1, j) && hBonded(j, i + 1))
-			||  (hBonded(j - 1, i) && hBonded(i, j + 1))) {
-				bridge(i, j) = 'P';
-				residue(i)->setFlag(R_PBRIDGE);
-				residue(j)->setFlag(R_PBRIDGE);
-			}
+			||  (hBonded(j - 1, i) && hBonded(i, j + 1)))
+				b.type = 'P';
 			else if ((hBonded(i, j) && hBonded(j, i))
-			|| (hBonded(i - 1, j + 1) && hBonded(j - 1, i + 1))) {
-				bridge(i, j) = 'A';
-				residue(i)->setFlag(R_ABRIDGE);
-				residue(j)->setFlag(R_ABRIDGE);
-			}
+			|| (hBonded(i - 1, j + 1) && hBonded(j - 1, i + 1)))
+				b.type = 'A';
+			else
+				b.type = '-';
+			if (b.type != '-')
+				STAT(S_BRIDGES);
+		}
+		if (b.type == 'P') {
+			residue(i)->setFlag(R_PBRIDGE);
+			residue(j)->setFlag(R_PBRIDGE);
+		}
+		else if (b.type == 'A') {
+			residue(i)->setFlag(R_ABRIDGE);
+			residue(j)->setFlag(R_ABRIDGE);
 		}
 	}
+}
+
+//
+// Build the ladders from the marked bridges
+//
+void
+Model::findLadders(BridgeSet *bridges)
+{
+	BridgeSet &bs = *bridges;
+	int n;
 
 	// Now we loop through and find the ladders
 	int k;
-	for (i = 0; i < max; i++) {
-		for (int j = i + 1; j < max; j++) {
-			switch (bridge(i, j)) {
-			  case 'P':
-				for (k = 0; bridge(i + k, j + k) == 'P'; k++) 
-					bridge(i + k, j + k) = 'p';
-				k--;
-				ladderList_.append(new Ladder(B_PARA,
-								i, i + k,
-								j, j + k));
-				break;
-			  case 'A':
-				for (k = 0; bridge(i + k, j - k) == 'A'; k++) 
-					bridge(i + k, j - k) = 'a';
-				k--;
-				ladderList_.append(new Ladder(B_ANTI,
-								i, i + k,
-								j - k , j));
-				break;
-			}
+	Bridge *b;
+	for (n = 0; n < bs.count(); n++) {
+		int i = bs[n].i;
+		int j = bs[n].j;
+		switch (bs[n].type) {
+		  case 'P':
+			for (k = 0; (b = bs.find(i + k, j + k)) != NULL
+			&& b->type == 'P'; k++)
+				b->type = 'p';
+			k--;
+			STAT(S_LADDERS);
+			ladderList_.append(new Ladder(B_PARA,
+							i, i + k,
+							j, j + k));
+			break;
+		  case 'A':
+			for (k = 0; (b = bs.find(i + k, j - k)) != NULL
+			&& b->type == 'A'; k++)
+				b->type = 'a';
+			k--;
+			STAT(S_LADDERS);
+			ladderList_.append(new Ladder(B_ANTI,
+							i, i + k,
+							j - k , j));
+			break;
 		}
 	}
+	for (n = 0; n < bs.count(); n++)
+		if (bs[n].type == 'p')
+			bs[n].type = 'P';
+		else if (bs[n].type == 'a')
+			bs[n].type = 'A';
 
 	// Now we merge ladders of beta-bulges
-	if (checkBulges)
-		while (findBetaBulge())
-			continue;
+	if (options_.checkBulges) {
+		lap(T_BRIDGES);
+		mergeBetaBulges();
+		lap(T_BULGES);
+	}
 
 	// Finally we get rid of any ladder that is too short
 	// (on either strand)
-	int pruned;
-	do {
-		pruned = 0;
-		for (Pix p = ladderList_.first(); p != 0; ladderList_.next(p)) {
-			Ladder *l = ladderList_(p);
-			if (l->end(0) - l->start(0) + 1 < minStrandLength
-			||  l->end(1) - l->start(1) + 1 < minStrandLength) {
-				ladderList_.remove(l);
-				pruned = 1;
-				break;
-			}
+	Pix p = ladderList_.first();
+	while (p != 0) {
+		Ladder *l = ladderList_(p);
+		ladderList_.next(p);
+		if (l->end(0) - l->start(0) + 1 < options_.minStrandLength
+		||  l->end(1) - l->start(1) + 1 < options_.minStrandLength) {
+			STAT(S_PRUNED);
+			ladderList_.remove(l);
+			delete l;
+		}
+	}
+}
+
+//
+// Add the residue pairs that may form bridges to the candidate set.
+// Each bridge requires a hydrogen bond (a, b) as the first of its
+// pair of bonds, giving pairs (a + 1, b), (a, b) and (a + 1, b - 1).
+//
+void
+Model::addBridgeCandidates(BridgeSet *bs)
+{
+	int max = residueCount_;
+	for (int a = 0; a < auCount_; a++) {
+		const BondList &l = hBond_->donors(a);
+		for (int k = 0; k < l.count; k++)
+			for (int c = 0; c < copies_; c++)
+				bs->addBond(c * auCount_ + a,
+					c * auCount_ + l.residue[k], max);
+	}
+	if (copies_ == 1)
+		return;
+	for (int c1 = 0; c1 < copies_; c1++)
+		for (int c2 = 0; c2 < copies_; c2++) {
+			CopyBonds *cb = copyBonds_[c1 * copies_ + c2];
+			if (cb == NULL)
+				continue;
+			for (int k = 0; k < cb->count(); k++)
+				bs->addBond(c1 * auCount_ + cb->acceptor(k),
+					c2 * auCount_ + cb->donor(k), max);
 		}
-	} while (pruned);
 }
 
 //
 // Find beta-bulges and merge the ladders
 //
-int
-Model::findBetaBulge(void)
+// Each ladder is merged with the first later ladder it forms a bulge
+// with.  Merged ladders go to the end of the list and are not merged
+// again, so a single pass gives the same ladders as restarting from
+// the head of the list after every merge: the ladders before a merged
+// one could not be merged with any ladder that is left.
+//
+void
+Model::mergeBetaBulges(void)
 {
-	for (Pix p1 = ladderList_.first(); p1 != 0; ladderList_.next(p1)) {
+	Pix p1 = ladderList_.first();
+	while (p1 != 0) {
 		Ladder *l1 = ladderList_(p1);
+		ladderList_.next(p1);
 		if (l1->isBulge())
 			continue;
 		Pix p2 = p1;
-		for (ladderList_.next(p2); p2 != 0; ladderList_.next(p2)) {
+		for (; p2 != 0; ladderList_.next(p2)) {
 			Ladder *l2 = ladderList_(p2);
 			if (l2->isBulge())
 				continue;
 			Ladder *l = Ladder::mergeBulge(l1, l2);
 			if (l != NULL) {
+				STAT(S_BULGES);
+				if (p1 == p2)
+					ladderList_.next(p1);
 				ladderList_.remove(l1);
 				ladderList_.remove(l2);
+				delete l1;
+				delete l2;
 				ladderList_.append(l);
-				return 1;
+				break;
 			}
 		}
 	}
-	return 0;
 }
 
 //
@@ -601,6 +2626,7 @@ Model::findSheets(void)
 		Ladder *l = ladderList_(p);
 		if (l->sheet() != NULL)
 			continue;
+		STAT(S_SHEETS);
 		Sheet *s = new Sheet(sName);
 		sheetList_.append(s);
 		if (sName == 'Z')
@@ -608,12 +2634,22 @@ Model::findSheets(void)
 		else
 			sName++;
 		markLadder(l, s);
+		Sheet *tail = s->closeBarrel(sName);
+		if (tail != NULL) {
+			STAT(S_SHEETS);
+			sheetList_.append(tail);
+			if (sName == 'Z')
+				sName = 'A';
+			else
+				sName++;
+		}
 	}
 }
 
 //
-// Mark this ladder (and all overlapped ladders, including closure)
-// as part of given sheet
+// Mark this ladder (and all overlapped ladders) as part of given sheet.
+// Ladders already in the sheet are not linked again; the ladder that
+// closes a barrel is linked afterwards by Sheet::closeBarrel.
 //
 void
 Model::markLadder(Ladder *ladder, Sheet *sheet)
@@ -650,6 +2686,8 @@ void
 Model::reportOverlap(const Ladder *l, int side,
 			const Ladder *o1, const Ladder *o2) const
 {
+	if (!warnings_)
+		return;
 	const PDB::Residue &first = residue(l->start(side))->residue();
 	const PDB::Residue &last = residue(l->end(side))->residue();
 	const PDB::Residue &ofirst = residue(l->start(1 - side))->residue();
@@ -689,51 +2727,35 @@ Model::reportOverlap(const Ladder *l, int side,
 // Generate registration information for given ladder
 //
 void
-Model::registerLadder(const Ladder *l, PDB::Sheet *sheet, int prev) const
+Model::registerLadder(const Ladder *l, Strand *st, int prev) const
 {
 	int cur = 1 - prev;
 	if (l->type() == B_PARA) {
 		//
 		// We know that hBond(l->start(prev), l->start(cur))
 		//
-		sheet->sense = 1;
-		Residue *r = residue(l->start(prev));
-		if (r->hBondedTo(residue(l->start(cur) + 1))) {
-			(void) strcpy(sheet->atoms[1].name, " O");
-			sheet->atoms[1].residue = r->residue();
-			r = residue(l->start(cur) + 1);
-			(void) strcpy(sheet->atoms[0].name, " N");
-			sheet->atoms[0].residue = r->residue();
+		st->sense = 1;
+		if (residueHBonded(l->start(prev), l->start(cur) + 1)) {
+			st->oResidue = l->start(prev);
+			st->nResidue = l->start(cur) + 1;
 		}
 		else {
-			r = residue(l->start(prev) + 1);
-			(void) strcpy(sheet->atoms[1].name, " O");
-			sheet->atoms[1].residue = r->residue();
-			r = residue(l->start(cur));
-			(void) strcpy(sheet->atoms[0].name, " N");
-			sheet->atoms[0].residue = r->residue();
+			st->oResidue = l->start(prev) + 1;
+			st->nResidue = l->start(cur);
 		}
 	}
 	else {
 		//
 		// We know that hBond(l->start(prev), l->end(cur))
 		//
-		sheet->sense = -1;
-		Residue *r = residue(l->start(prev));
-		if (r->hBondedTo(residue(l->end(cur)))) {
-			(void) strcpy(sheet->atoms[1].name, " O");
-			sheet->atoms[1].residue = r->residue();
-			r = residue(l->end(cur));
-			(void) strcpy(sheet->atoms[0].name, " N");
-			sheet->atoms[0].residue = r->residue();
+		st->sense = -1;
+		if (residueHBonded(l->start(prev), l->end(cur))) {
+			st->oResidue = l->start(prev);
+			st->nResidue = l->end(cur);
 		}
 		else {
-			r = residue(l->start(prev) + 1);
-			(void) strcpy(sheet->atoms[1].name, " O");
-			sheet->atoms[1].residue = r->residue();
-			r = residue(l->end(cur) - 1);
-			(void) strcpy(sheet->atoms[0].name, " N");
-			sheet->atoms[0].residue = r->residue();
+			st->oResidue = l->start(prev) + 1;
+			st->nResidue = l->end(cur) - 1;
 		}
 	}
 }
@@ -744,16 +2766,15 @@ Model::registerLadder(const Ladder *l, PDB::Sheet *sheet, int prev) const
 int
 Model::helixClass(const Helix *h) const
 {
-	Atom *ca[4];
+	float ca[4][3];
 	int from = h->from();
 	Residue *r = residue(from);
 	for (int i = 0; i < 4; i++) {
-		ca[i] = residue(from + i)->atom(" CA");
-		if (ca[i] == NULL)
+		if (residue(from + i) == NULL
+		||  atomCoord(from + i, A_CA, ca[i]) < 0)
 			return 0;
 	}
-	float angle = dihedral(ca[0]->coord(), ca[1]->coord(),
-				ca[2]->coord(), ca[3]->coord());
+	float angle = dihedral(ca[0], ca[1], ca[2], ca[3]);
 	if (angle > 0) {
 		if (r->flag(R_4HELIX))
 			return 1;
@@ -34,58 +34,185 @@
 
 #include <stdio.h>
 #include <string>
+#include "Assignment.h"
 #include "Residue.h"
 #include "List.h"
-#include "ListArray.h"
-#include "SquareArray.h"
 #include "Structure.h"
+#include "Probes.h"
+#include "Stats.h"
+#include "Symmetry.h"
+#include "Timings.h"
+#include "Topology.h"
+
+class Assignment;
+class AtomGrid;
+class BondTable;
+class BridgeSet;
+class NeighborList;
+class Sha256;
 
 class Model {
 	int			anyMore_;
 	std::string		error_;
-	List<Residue>		rList_;
-	ListArray<Residue>	*rArray_;
-	SquareArray<char>	*hBond_;
+	Topology		*topology_;
+	float			(*coord_)[A_COUNT][3];
+	int			coordSize_;
+	Residue			*residue_;
+	int			residueCount_;
+	int			residueSize_;
+	BondTable		*hBond_;
+	int			keepBonds_;
+	BridgeSet		*bridges_;
 	List<Helix>		helixList_;
 	List<Ladder>		ladderList_;
 	List<Sheet>		sheetList_;
 	int			modelNumber_;
 	PDB			fileRecord_;
+	int			auCount_;
+	int			copies_;
+	Operator		*copyOp_;
+	CopyBonds		**copyBonds_;
+	List<CopyBonds>		copyBondsList_;
+	NeighborList		*neighbors_;
+	AtomGrid		*cGrid_;
+	AtomGrid		*nGrid_;
+	const Assignment	*result_;
+	StageTimes		*times_;
+	SSOptions		options_;
+	int			warnings_;
+#ifdef WITH_STATS
+	WorkStats		*stats_;
+#endif
 public:
+			Model(void);
 			Model(FILE *input);
+			Model(Topology *t, const float *xyz);
+			Model(const Model &m);
 			~Model(void);
 	int		okay(void) const { return error_ == ""; }
 	int		anyMore(void) const { return anyMore_; }
-	int		anyAtoms(void) const { return rList_.count() > 0; }
+	int		anyAtoms(void) const { return residueCount_ > 0; }
+	int		atomCount(void) const
+				{ return topology_->atomCount(); }
 	const char	*error(void) const { return error_.c_str(); }
 	int		modelNumber(void) const { return modelNumber_; }
 	const PDB	&fileRecord(void) const { return fileRecord_; }
+	int		residueCount(void) const { return residueCount_; }
+	const PDB::Residue &
+			residueId(int n) const
+				{ return residue_[n].residue(); }
+	void		setCoords(const float *xyz);
+	void		updateCoords(const float *xyz, const int *moved,
+					int count);
+	void		appendResidue(const PDB::Residue &r,
+					const float xyz[A_COUNT][3], int atoms);
+	void		endChain(void);
 	void		defineSecondaryStructure(void);
 	void		printResidues(FILE *output) const;
 	void		printSummary(FILE *output) const;
+	void		summaryCodes(char *codes) const;
+	void		digestInput(Sha256 &digest) const;
 	int		printHelix(FILE *output, int id) const;
-	char		printSheet(FILE *output, int id) const;
+	int		printSheet(FILE *output, int id) const;
+	void		setResult(const Assignment *a) { result_ = a; }
+	const SSOptions	&options(void) const { return options_; }
+	void		setOptions(const SSOptions &options, int warnings);
+	const List<Helix> &
+			helixList(void) const { return helixList_; }
+	const List<Ladder> &
+			ladderList(void) const { return ladderList_; }
+	const List<Sheet> &
+			sheetList(void) const { return sheetList_; }
+	int		sheetStrands(Sheet *s, Strand *strands,
+					int *cyclic) const;
+	const StageTimes *
+			times(void) const { return times_; }
+#ifdef WITH_STATS
+	const WorkStats	*stats(void) const { return stats_; }
+#endif
+	void		addProfile(const Model &m);
 public:
+	static void	setHBondCutoff(float cutoff);
 	static void	setMinStrandLength(int n);
 	static void	setMinHelixLength(int n);
-	static void	ignoreBulges(void);
+	static void	ignoreBulges(int ignore = 1);
+	static void	setWarnings(int on);
+	static void	useMtrix(void);
+	static void	endInput(void);
+	static int	readModels(FILE *input, List<Model> &modelList,
+					std::string &error);
+	static void	printStructure(List<Model> &modelList, FILE *output,
+					FILE *summary);
+	static void	setNeighborSkin(float skin);
+	static void	recordTimes(int on);
+	static void	recordStats(int on);
 private:
-	int		hBonded(int i, int j) { return (*hBond_)(i, j); }
-	Residue		*residue(int n) const { return (*rArray_)(n); }
+	void		startTimes(void) const
+			{
+				PROBE2(stages__start, modelNumber_,
+							residueCount_);
+				if (times_ != NULL)
+					times_->start();
+			}
+	void		lap(int stage) const
+			{
+				if (times_ != NULL)
+					times_->lap(stage);
+				PROBE3(stage__done, stage, modelNumber_,
+							residueCount_);
+			}
+	void		observeTimes(void) const
+				{ if (times_ != NULL) times_->observe(); }
+	void		countPairs(long n) const
+				{ if (times_ != NULL) times_->countPairs(n); }
+	int		hBonded(int i, int j);
+	int		residueHBonded(int i, int j) const;
+	Residue		*residue(int n) const;
+	int		atomCoord(int n, int slot, float xyz[3]) const;
+	void		growCoords(int n, int size);
+	void		growResidues(int size);
+	void		makeResidues(void);
+	void		useDefaults(void);
+	void		clearStructure(void);
+	void		clearHelices(void);
+	void		clearSheets(void);
 	void		addImideHydrogens(void);
 	void		findHBonds(void);
-	void		findTurns(int n);
-	void		markHelices(int n);
+	void		makeGrids(void);
+	void		dropGrids(void);
+	void		updateStructure(const int *affected, int count,
+					int moved);
+	void		findNeighbors(float cutoff);
+	void		expandCopies(void);
+	void		addBridgeCandidates(BridgeSet *bs);
+	void		markBridges(BridgeSet *bs);
+	void		findLadders(BridgeSet *bs);
+	void		findTurns(int n, int lo, int hi);
+	void		markHelices(int n, int lo, int hi);
 	void		findHelices(void);
+	void		updateHelices(int lo, int hi);
 	void		findBridges(void);
-	int		findBetaBulge(void);
+	void		mergeBetaBulges(void);
 	void		findSheets(void);
 	void		markLadder(Ladder *ladder, Sheet *sheet);
 	void		reportOverlap(const Ladder *l, int s, const Ladder *o1,
 					const Ladder *o2) const;
-	void		registerLadder(const Ladder *l, PDB::Sheet *sheet,
+	void		registerLadder(const Ladder *l, Strand *st,
 					int prev) const;
 	int		helixClass(const Helix *h) const;
+	int		printHelixRecord(FILE *output, int id, int from,
+					int to, int type) const;
+	int		printStrands(FILE *output, int sid,
+					const Strand *strands, int count,
+					int cyclic) const;
 };
 
+inline Residue *
+Model::residue(int n) const
+{
+	if (n < 0 || n >= residueCount_)
+		return NULL;
+	return &residue_[n];
+}
+
 #endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef probes_h
+#define probes_h
+
+//
+// Static probes (USDT) for tracing tools such as bpftrace, perf and
+// SystemTap to attach to in a running ksdssp, with provider ksdssp:
+//
+//	model__read(model, residues)		a model has been read
+//	stages__start(model, residues)		assignment or output begins
+//	stage__done(stage, model, residues)	stage (T_*) has ended and
+//						the next one begins
+//	helix(model, residues, id, length)	HELIX record printed
+//	sheet(model, residues, id, strands)	SHEET records printed
+//	file__start(name)			input file opened
+//	file__done(name, models, residues)	its records printed
+//	request__start(kind, length)		server request received
+//	request__done(kind, models, residues)	its reply made
+//
+// model is the MODEL record number (-1 if none).  A stage lasts from
+// the previous stages__start or stage__done of the same thread.
+//
+// The probes are compiled in with -DWITH_PROBES, which needs
+// <sys/sdt.h> (from SystemTap); each is then a single nop until a
+// tool attaches to it.  Otherwise they are compiled out (their
+// arguments are not evaluated).
+//
+#ifdef WITH_PROBES
+#include <sys/sdt.h>
+#define	PROBE1(name, a)		DTRACE_PROBE1(ksdssp, name, a)
+#define	PROBE2(name, a, b)	DTRACE_PROBE2(ksdssp, name, a, b)
+#define	PROBE3(name, a, b, c)	DTRACE_PROBE3(ksdssp, name, a, b, c)
+#define	PROBE4(name, a, b, c, d) DTRACE_PROBE4(ksdssp, name, a, b, c, d)
+#else
+#define	PROBE1(name, a)		((void) sizeof (a))
+#define	PROBE2(name, a, b)	((void) sizeof ((a), (b)))
+#define	PROBE3(name, a, b, c)	((void) sizeof ((a), (b), (c)))
+#define	PROBE4(name, a, b, c, d) ((void) sizeof ((a), (b), (c), (d)))
+#endif
+
+#endif
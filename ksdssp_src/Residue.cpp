@@ -33,30 +33,10 @@
 #include <string.h>
 #include "ksdssp.h"
 #include "Residue.h"
+#include "Stats.h"
 #include "misc.h"
 
-#ifndef DONT_INSTANIATE
-template class List<Atom>;
-#endif
-
-static float	hBondCutoff = -0.5;
-
-//
-// Check if two PDB residues are the same
-//
-int
-Residue::sameAs(const PDB::Residue &r) const
-{
-	if (r.seqNum != residue_.seqNum)
-		return 0;
-	if (r.chainId != residue_.chainId)
-		return 0;
-	if (r.insertCode != residue_.insertCode)
-		return 0;
-	if (strncmp(r.name, residue_.name, sizeof (PDB::RName)) != 0)
-		return 0;
-	return 1;
-}
+static const char *atomNames[A_COUNT] = { " N", " CA", " C", " O", " H" };
 
 //
 // Add the imide hydrogen if it is missing
@@ -64,28 +44,28 @@ Residue::sameAs(const PDB::Residue &r) const
 int
 Residue::addImideHydrogen(const Residue *prev)
 {
-	if (prev == NULL || atom(" H") != NULL)
+	if (prev == NULL || atom(A_H) != NULL)
 		return 0;		// Already there
-	Atom *n = atom(" N");
-	if (n == NULL) {
+	const float *nCoord = atom(A_N);
+	if (nCoord == NULL) {
 		if (verbose)
 			(void) fprintf(stderr,
 				"N missing in residue %d%c[%c]\n",
-				residue_.seqNum, residue_.chainId,
-				residue_.insertCode);
+				residue_->seqNum, residue_->chainId,
+				residue_->insertCode);
 		return -1;
 	}
-	Atom *ca = atom(" CA");
-	if (ca == NULL) {
+	const float *caCoord = atom(A_CA);
+	if (caCoord == NULL) {
 		if (verbose)
 			(void) fprintf(stderr,
 				"CA missing in residue %d%c[%c]\n",
-				residue_.seqNum, residue_.chainId,
-				residue_.insertCode);
+				residue_->seqNum, residue_->chainId,
+				residue_->insertCode);
 		return -1;
 	}
-	Atom *c = prev->atom(" C");
-	if (c == NULL) {
+	const float *cCoord = prev->atom(A_C);
+	if (cCoord == NULL) {
 		if (verbose)
 			(void) fprintf(stderr,
 				"C missing in residue %d%c[%c]\n",
@@ -94,8 +74,8 @@ Residue::addImideHydrogen(const Residue *prev)
 				prev->residue().insertCode);
 		return -1;
 	}
-	Atom *o = prev->atom(" O");
-	if (o == NULL) {
+	const float *oCoord = prev->atom(A_O);
+	if (oCoord == NULL) {
 		if (verbose)
 			(void) fprintf(stderr,
 				"O missing in residue %d%c[%c]\n",
@@ -105,10 +85,6 @@ Residue::addImideHydrogen(const Residue *prev)
 		return -1;
 	}
 
-	const float *nCoord = n->coord();
-	const float *caCoord = ca->coord();
-	const float *cCoord = c->coord();
-	const float *oCoord = o->coord();
 	float v1[3], v2[3], v3[3];
 	int i;
 	for (i = 0; i < 3; i++) {
@@ -124,42 +100,49 @@ Residue::addImideHydrogen(const Residue *prev)
 	bisect(hDir, p1, v3);
 
 	const float nhLength = 1.01;
-	float hCoord[3];
+	float *hCoord = xyz_[A_H];
 	for (i = 0; i < 3; i++)
 		hCoord[i] = nCoord[i] - nhLength * hDir[i];
-
-	addAtom(new Atom(" H", hCoord));
+	atoms_ |= 1 << A_H;
 	return 0;
 }
 
 //
-// Check if other residue is hydrogen bonded to this one
+// Check if other residue is hydrogen bonded to this one (with an
+// energy below cutoff)
 //
 int
-Residue::hBondedTo(const Residue *other) const
+Residue::hBondedTo(const Residue *other, float cutoff) const
 {
 	const float q1 = 0.42;
 	const float q2 = 0.20;
 	const float f = 332;
 
-	Atom *c = atom(" C");
-	Atom *o = atom(" O");
+	const float *c = atom(A_C);
+	const float *o = atom(A_O);
 	if (c == NULL || o == NULL)
 		return 0;
-	Atom *n = other->atom(" N");
-	Atom *h = other->atom(" H");
+	const float *n = other->atom(A_N);
+	const float *h = other->atom(A_H);
 	if (n == NULL || h == NULL)
 		return 0;
-	float rCN = distSquared(c->coord(), n->coord());
-	if (rCN > 49.0)		// Optimize a little bit
+	STAT(S_PAIRS);
+	float rCN = distSquared(c, n);
+	if (rCN > 49.0) {	// Optimize a little bit
+		STAT(S_FAR);
 		return 0;
+	}
 	rCN = sqrtf(rCN);
-	float rON = distance(o->coord(), n->coord());
-	float rCH = distance(c->coord(), h->coord());
-	float rOH = distance(o->coord(), h->coord());
+	float rON = distance(o, n);
+	float rCH = distance(c, h);
+	float rOH = distance(o, h);
 
 	float E = q1 * q2 * (1 / rON + 1 / rCH - 1 / rOH - 1 / rCN) * f;
-	return E < hBondCutoff;
+	if (E < cutoff) {
+		STAT(S_HBONDS);
+		return 1;
+	}
+	return 0;
 }
 
 //
@@ -168,15 +151,15 @@ Residue::hBondedTo(const Residue *other) const
 int
 Residue::printAtoms(FILE *output, int sn) const
 {
-	for (Pix p = aList_.first(); p != 0; aList_.next(p)) {
-		Atom *a = aList_(p);
-		const float *c = a->coord();
+	for (int slot = 0; slot < A_COUNT; slot++) {
+		const float *c = atom(slot);
+		if (c == NULL)
+			continue;
 		PDB pdb(PDB::ATOM);
 		PDB::Atom &atom = pdb.atom;
 		atom.serialNum = sn++;
-		(void) strncpy(atom.name, a->name().c_str(),
-				sizeof (PDB::AName));
-		atom.residue = residue_;
+		(void) strcpy(atom.name, atomNames[slot]);
+		atom.residue = *residue_;
 		for (int i = 0; i < 3; i++)
 			atom.xyz[i] = c[i];
 		(void) fprintf(output, "%s\n", pdb.chars());
@@ -185,18 +168,28 @@ Residue::printAtoms(FILE *output, int sn) const
 }
 
 //
-// Print summary of residue state
+// Return the secondary structure code of the residue
+// (G, H, E or blank)
 //
-void
-Residue::printSummary(FILE *output) const
+char
+Residue::summaryCode(void) const
 {
-	char summary = ' ';
 	if (flag(R_3HELIX))
-		summary = 'G';
+		return 'G';
 	else if (flag(R_4HELIX))
-		summary = 'H';
+		return 'H';
 	else if (flag(R_PBRIDGE | R_ABRIDGE))
-		summary = 'E';
+		return 'E';
+	return ' ';
+}
+
+//
+// Print summary of residue state
+//
+void
+Residue::printSummary(FILE *output) const
+{
+	char summary = summaryCode();
 
 	char turn3 = ' ';
 	if (flag(R_3DONOR) && flag(R_3ACCEPTOR))
@@ -227,16 +220,28 @@ Residue::printSummary(FILE *output) const
 		bridge = 'A';
 
 	(void) fprintf(output, "%4.4s %4d%c[%c] -> %c %c %c %c\n",
-		residue_.name, residue_.seqNum,
-		residue_.chainId, residue_.insertCode,
+		residue_->name, residue_->seqNum,
+		residue_->chainId, residue_->insertCode,
 		summary, turn3, turn4, bridge);
 }
 
 //
-// Set the energy cutoff for hydrogen bondedness
+// Find the backbone slot for an atom name (-1 if not a backbone atom)
 //
-void
-Residue::setHBondCutoff(float cutoff)
+int
+Residue::atomSlot(const char *name)
+{
+	for (int slot = 0; slot < A_COUNT; slot++)
+		if (strcmp(name, atomNames[slot]) == 0)
+			return slot;
+	return -1;
+}
+
+//
+// Get the atom name for a backbone slot
+//
+const char *
+Residue::atomName(int slot)
 {
-	hBondCutoff = cutoff;
+	return atomNames[slot];
 }
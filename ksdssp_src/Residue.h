@@ -40,8 +40,6 @@
 
 #include <stdio.h>
 #include <pdb++.h>
-#include "Atom.h"
-#include "List.h"
 
 #define	R_3DONOR	0x0001
 #define	R_3ACCEPTOR	0x0002
@@ -55,60 +53,75 @@
 #define	R_ABRIDGE	0x0200
 #define	R_TER		0x8000
 
-class Residue;
+// Backbone atom slots
+#define	A_N		0
+#define	A_CA		1
+#define	A_C		2
+#define	A_O		3
+#define	A_H		4
+#define	A_COUNT		5
 
+//
+// A residue of one model: identity is shared with the other models
+// through the topology, and backbone coordinates live in the flat
+// coordinate array of the model
+//
 class Residue {
-	PDB::Residue	residue_;
-	List<Atom>	aList_;
-	int		flags_;
+	const PDB::Residue	*residue_;
+	float			(*xyz_)[3];
+	int			atoms_;
+	int			flags_;
 public:
-			Residue(const PDB::Residue &r);
-			~Residue(void);
+			Residue(void);
+			Residue(const PDB::Residue *r, float (*xyz)[3],
+					int atoms);
+	void		relocate(const PDB::Residue *r, float (*xyz)[3]);
 	const PDB::Residue &
-			residue(void) const { return residue_; }
-	void		addAtom(Atom *a);
+			residue(void) const { return *residue_; }
+	const float	*atom(int slot) const;
 	int		addImideHydrogen(const Residue *prev);
-	Atom		*atom(const std::string &name) const;
-	int		sameAs(const PDB::Residue &r) const;
-	int		hBondedTo(const Residue *other) const;
+	int		hBondedTo(const Residue *other, float cutoff) const;
 	int		printAtoms(FILE *output, int sn) const;
+	char		summaryCode(void) const;
 	void		printSummary(FILE *output) const;
 	int		flag(int f) const;
 	void		setFlag(int f);
+	void		clearFlag(int f);
 public:
-	static void	setHBondCutoff(float cutoff);
+	static int	atomSlot(const char *name);
+	static const char
+			*atomName(int slot);
 };
 
 inline
-Residue::Residue(const PDB::Residue &r)
-	: aList_()
+Residue::Residue(void)
 {
-	residue_ = r;
+	residue_ = NULL;
+	xyz_ = NULL;
+	atoms_ = 0;
 	flags_ = 0;
 }
 
 inline
-Residue::~Residue(void)
+Residue::Residue(const PDB::Residue *r, float (*xyz)[3], int atoms)
 {
-	for (Pix p = aList_.first(); p != 0; aList_.next(p))
-		delete aList_(p);
+	residue_ = r;
+	xyz_ = xyz;
+	atoms_ = atoms;
+	flags_ = 0;
 }
 
 inline void
-Residue::addAtom(Atom *a)
+Residue::relocate(const PDB::Residue *r, float (*xyz)[3])
 {
-	aList_.append(a);
+	residue_ = r;
+	xyz_ = xyz;
 }
 
-inline Atom *
-Residue::atom(const std::string &name) const
+inline const float *
+Residue::atom(int slot) const
 {
-	for (Pix p = aList_.first(); p != 0; aList_.next(p)) {
-		Atom *a = aList_(p);
-		if (a->name() == name)
-			return a;
-	}
-	return NULL;
+	return atoms_ & (1 << slot) ? xyz_[slot] : NULL;
 }
 
 inline int
@@ -123,4 +136,10 @@ Residue::setFlag(int f)
 	flags_ |= f;
 }
 
+inline void
+Residue::clearFlag(int f)
+{
+	flags_ &= ~f;
+}
+
 #endif
@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "Series.h"
+
+// Changes separated by fewer unchanged residues are written as one
+static const int	MergeGap = 4;
+
+//
+// Constructor for SeriesWriter (the header is written with the
+// first frame, once the residues are known)
+//
+SeriesWriter::SeriesWriter(FILE *output, int stride, int interval)
+{
+	output_ = output;
+	stride_ = stride;
+	interval_ = interval < 1 ? 1 : interval;
+	offset_ = 0;
+	residueCount_ = 0;
+	prev_ = NULL;
+	cur_ = NULL;
+	frames_ = 0;
+	keySize_ = 64;
+	key_ = new long[keySize_];
+}
+
+//
+// Destructor for SeriesWriter
+//
+SeriesWriter::~SeriesWriter(void)
+{
+	delete [] prev_;
+	delete [] cur_;
+	delete [] key_;
+}
+
+//
+// Write n characters, keeping track of the offset (the output need
+// not be seekable)
+//
+void
+SeriesWriter::put(const char *s, int n)
+{
+	(void) fwrite(s, 1, n, output_);
+	offset_ += n;
+}
+
+void
+SeriesWriter::putNumber(long n)
+{
+	char buf[32];
+	put(buf, sprintf(buf, "%ld", n));
+}
+
+//
+// Write run-length encoded codes
+//
+void
+SeriesWriter::putCodes(const char *codes, int n)
+{
+	for (int i = 0; i < n; ) {
+		int j = i + 1;
+		while (j < n && codes[j] == codes[i])
+			j++;
+		if (j - i > 1)
+			putNumber(j - i);
+		put(&codes[i], 1);
+		i = j;
+	}
+}
+
+//
+// Write the file header (list of residues and frame numbering)
+//
+void
+SeriesWriter::putHeader(List<Model> &modelList, int first)
+{
+	char buf[64];
+	residueCount_ = 0;
+	Pix p;
+	for (p = modelList.first(); p != 0; modelList.next(p))
+		residueCount_ += modelList(p)->residueCount();
+	put(buf, sprintf(buf, "KSDSSP SERIES 1\nRESIDUES %d\n",
+							residueCount_));
+	int m = 1;
+	for (p = modelList.first(); p != 0; modelList.next(p), m++) {
+		const Model *model = modelList(p);
+		for (int n = 0; n < model->residueCount(); n++) {
+			const PDB::Residue &r = model->residueId(n);
+			put(buf, sprintf(buf, "%d %4.4s %4d%c[%c]\n", m,
+				r.name, r.seqNum, r.chainId, r.insertCode));
+		}
+	}
+	put(buf, sprintf(buf, "FRAMES %d %d\n", first, stride_));
+	prev_ = new char[residueCount_ + 1];
+	cur_ = new char[residueCount_ + 1];
+}
+
+//
+// Add the secondary structure assigned to the models for a frame
+//
+void
+SeriesWriter::addFrame(List<Model> &modelList, int frame)
+{
+	if (frames_ == 0)
+		putHeader(modelList, frame);
+	int n = 0;
+	for (Pix p = modelList.first(); p != 0; modelList.next(p)) {
+		const Model *model = modelList(p);
+		if (n + model->residueCount() > residueCount_)
+			break;
+		model->summaryCodes(cur_ + n);
+		n += model->residueCount();
+	}
+	for (int i = 0; i < residueCount_; i++)
+		if (i >= n || cur_[i] == ' ')
+			cur_[i] = '-';
+
+	if (frames_ % interval_ == 0) {
+		if (frames_ / interval_ == keySize_) {
+			long *key = new long[keySize_ * 2];
+			memcpy(key, key_, keySize_ * sizeof key[0]);
+			delete [] key_;
+			key_ = key;
+			keySize_ *= 2;
+		}
+		key_[frames_ / interval_] = offset_;
+		put("K ", 2);
+		putCodes(cur_, residueCount_);
+	}
+	else {
+		put("D", 1);
+		for (int i = 0; i < residueCount_; ) {
+			if (cur_[i] == prev_[i]) {
+				i++;
+				continue;
+			}
+			int end = i + 1;
+			for (int j = end; j < residueCount_
+					&& j < end + MergeGap; j++)
+				if (cur_[j] != prev_[j])
+					end = j + 1;
+			put(" ", 1);
+			putNumber(i);
+			put(":", 1);
+			putCodes(cur_ + i, end - i);
+			i = end;
+		}
+	}
+	put("\n", 1);
+	char *t = prev_;
+	prev_ = cur_;
+	cur_ = t;
+	frames_++;
+}
+
+//
+// Write the index of key frames
+// Return 0 on success and -1 on a write error
+//
+int
+SeriesWriter::finish(void)
+{
+	char buf[64];
+	if (frames_ == 0)
+		put(buf, sprintf(buf, "KSDSSP SERIES 1\nRESIDUES 0\n"
+					"FRAMES 1 %d\n", stride_));
+	long index = offset_;
+	put(buf, sprintf(buf, "INDEX %d %d\n", frames_, interval_));
+	int keys = (frames_ + interval_ - 1) / interval_;
+	for (int i = 0; i < keys; i++)
+		put(buf, sprintf(buf, "%ld\n", key_[i]));
+	put(buf, sprintf(buf, "%20ld\n", index));
+	if (fflush(output_) != 0 || ferror(output_))
+		return -1;
+	return 0;
+}
+
+//
+// Constructor for SeriesReader (read the header and the index)
+//
+SeriesReader::SeriesReader(FILE *input)
+	: error_()
+{
+	input_ = input;
+	residueCount_ = 0;
+	first_ = 1;
+	stride_ = 1;
+	frames_ = 0;
+	interval_ = 1;
+	key_ = NULL;
+	codes_ = NULL;
+	last_ = -1;
+
+	int version;
+	if (fscanf(input_, "KSDSSP SERIES %d\n", &version) != 1
+	|| version != 1
+	|| fscanf(input_, "RESIDUES %d\n", &residueCount_) != 1
+	|| residueCount_ < 0) {
+		error_ = "not a secondary structure series";
+		return;
+	}
+	for (int n = 0; n < residueCount_; n++) {
+		int c;
+		while ((c = getc(input_)) != '\n')
+			if (c == EOF) {
+				error_ = "truncated residue list";
+				return;
+			}
+	}
+	long index;
+	if (fscanf(input_, "FRAMES %d %d\n", &first_, &stride_) != 2
+	|| fseek(input_, -21, SEEK_END) != 0
+	|| fscanf(input_, "%ld", &index) != 1
+	|| fseek(input_, index, SEEK_SET) != 0
+	|| fscanf(input_, "INDEX %d %d\n", &frames_, &interval_) != 2
+	|| frames_ < 0 || interval_ < 1) {
+		error_ = "missing or bad frame index";
+		return;
+	}
+	int keys = (frames_ + interval_ - 1) / interval_;
+	key_ = new long[keys > 0 ? keys : 1];
+	for (int i = 0; i < keys; i++)
+		if (fscanf(input_, "%ld\n", &key_[i]) != 1) {
+			error_ = "truncated frame index";
+			return;
+		}
+	codes_ = new char[residueCount_ + 1];
+	codes_[residueCount_] = '\0';
+}
+
+//
+// Destructor for SeriesReader
+//
+SeriesReader::~SeriesReader(void)
+{
+	delete [] key_;
+	delete [] codes_;
+}
+
+//
+// Decode run-length encoded codes into codes_ starting at pos
+// Return 0 on success and -1 if the codes do not fit
+//
+int
+SeriesReader::readCodes(int pos)
+{
+	for (;;) {
+		int c = getc(input_);
+		if (c == ' ' || c == '\n' || c == EOF) {
+			(void) ungetc(c, input_);
+			return 0;
+		}
+		int count = 1;
+		if (c >= '0' && c <= '9') {
+			count = 0;
+			while (c >= '0' && c <= '9') {
+				count = count * 10 + c - '0';
+				c = getc(input_);
+			}
+			if (c == ' ' || c == '\n' || c == EOF)
+				return -1;
+		}
+		if (count > residueCount_ - pos)
+			return -1;
+		memset(codes_ + pos, c, count);
+		pos += count;
+	}
+}
+
+//
+// Apply the next frame record to codes_
+// Return 0 on success and -1 on a malformed record
+//
+int
+SeriesReader::readRecord(void)
+{
+	int c = getc(input_);
+	if (c == 'K') {
+		if (getc(input_) != ' ' || readCodes(0) < 0)
+			return -1;
+		return getc(input_) == '\n' ? 0 : -1;
+	}
+	if (c != 'D' || last_ < 0)
+		return -1;
+	while ((c = getc(input_)) == ' ') {
+		int pos;
+		if (fscanf(input_, "%d:", &pos) != 1 || pos < 0
+		|| pos > residueCount_ || readCodes(pos) < 0)
+			return -1;
+	}
+	return c == '\n' ? 0 : -1;
+}
+
+//
+// Return the codes for the k-th frame in the file (counting from 0),
+// or NULL on error
+//
+const char *
+SeriesReader::codes(int k)
+{
+	if (!okay())
+		return NULL;
+	if (k < 0 || k >= frames_) {
+		error_ = "frame not in series";
+		return NULL;
+	}
+	if (k == last_)
+		return codes_;
+	// Continue from the last frame read if no key frame is between
+	int start = last_ + 1;
+	if (last_ < 0 || k < last_ || k / interval_ != last_ / interval_) {
+		start = k / interval_ * interval_;
+		last_ = -1;
+		if (fseek(input_, key_[k / interval_], SEEK_SET) != 0) {
+			error_ = "cannot seek to key frame";
+			return NULL;
+		}
+	}
+	for (int f = start; f <= k; f++) {
+		if (readRecord() < 0) {
+			error_ = "bad frame record";
+			last_ = -1;
+			return NULL;
+		}
+		last_ = f;
+	}
+	return codes_;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef series_h
+#define series_h
+
+#include <stdio.h>
+#include <string>
+#include "List.h"
+#include "Model.h"
+
+//
+// Secondary structure time series, one code per residue per frame
+// (G, H or E as in the residue summary, - for none):
+//
+//	KSDSSP SERIES 1
+//	RESIDUES n
+//	model name seqNum chainId[insertCode]	(n lines)
+//	FRAMES first stride
+//	K codes				(key frame)
+//	D pos:codes pos:codes ...	(changes from the previous frame)
+//	...
+//	INDEX frames interval
+//	offset				(of each key frame line)
+//	...
+//	offset of the INDEX line, right-justified in 20 columns
+//
+// Codes are run-length encoded as characters, each optionally
+// preceded by a repeat count.  Residues of all models are numbered
+// from 0 in file order (symmetry copies follow the asymmetric unit).
+// Every interval-th frame is a key frame, so any frame is found by
+// reading at most interval lines from the key frame before it.
+//
+class SeriesWriter {
+	FILE		*output_;
+	int		stride_;
+	int		interval_;
+	long		offset_;
+	int		residueCount_;
+	char		*prev_;
+	char		*cur_;
+	int		frames_;
+	long		*key_;
+	int		keySize_;
+	void		put(const char *s, int n);
+	void		putNumber(long n);
+	void		putCodes(const char *codes, int n);
+	void		putHeader(List<Model> &modelList, int first);
+public:
+			SeriesWriter(FILE *output, int stride,
+					int interval = 1000);
+			~SeriesWriter(void);
+	void		addFrame(List<Model> &modelList, int frame);
+	int		finish(void);
+};
+
+class SeriesReader {
+	FILE		*input_;
+	std::string	error_;
+	int		residueCount_;
+	int		first_, stride_;
+	int		frames_;
+	int		interval_;
+	long		*key_;
+	char		*codes_;
+	int		last_;
+	int		readCodes(int pos);
+	int		readRecord(void);
+public:
+			SeriesReader(FILE *input);
+			~SeriesReader(void);
+	int		okay(void) const { return error_ == ""; }
+	const char	*error(void) const { return error_.c_str(); }
+	int		residueCount(void) const { return residueCount_; }
+	int		frameCount(void) const { return frames_; }
+	int		frameNumber(int k) const
+				{ return first_ + k * stride_; }
+	const char	*codes(int k);
+};
+
+#endif
@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Server.h"
+
+#ifndef NO_SERVER
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "Assignment.h"
+#include "Metrics.h"
+#include "Probes.h"
+#include "SharedSegment.h"
+
+// Initial size of the request buffer of each worker
+static const size_t	InitialBuffer = 1 << 20;
+
+//
+// Read exactly count bytes from fd
+// Return 1 on success, 0 at end of input before any byte was read,
+// and -1 on error or at end of input part way through
+//
+static int
+readFully(int fd, void *buf, size_t count)
+{
+	char *p = (char *) buf;
+	size_t done = 0;
+	while (done < count) {
+		ssize_t n = read(fd, p + done, count - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return n == 0 && done == 0 ? 0 : -1;
+		done += n;
+	}
+	return 1;
+}
+
+//
+// Write count bytes to fd; return 0 on success and -1 on error
+//
+static int
+writeFully(int fd, const void *buf, size_t count)
+{
+	const char *p = (const char *) buf;
+	while (count > 0) {
+		ssize_t n = write(fd, p, count);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		count -= n;
+	}
+	return 0;
+}
+
+//
+// Fill in the address of the socket at path
+// Return 0 on success and -1 (with error set) if path is too long
+//
+static int
+socketAddress(const char *path, struct sockaddr_un *addr, std::string &error)
+{
+	(void) memset(addr, 0, sizeof *addr);
+	addr->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof addr->sun_path) {
+		error = "socket path too long";
+		return -1;
+	}
+	(void) strcpy(addr->sun_path, path);
+	return 0;
+}
+
+//
+// Constructor for Server (create and listen on the socket)
+//
+Server::Server(const char *path, StructurePrinter printer, int workers)
+	: error_(), path_(path)
+{
+	listen_ = -1;
+	printer_ = printer;
+	workers_ = workers < 1 ? 1 : workers;
+#ifndef NO_THREADS
+	(void) pthread_mutex_init(&lock_, NULL);
+#endif
+	struct sockaddr_un addr;
+	if (socketAddress(path, &addr, error_) < 0)
+		return;
+
+	// Leave the socket of a running server alone, but replace
+	// one left behind by a server that has gone
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		error_ = strerror(errno);
+		return;
+	}
+	if (connect(fd, (struct sockaddr *) &addr, sizeof addr) == 0) {
+		(void) close(fd);
+		error_ = "socket in use by another server";
+		return;
+	}
+	(void) close(fd);
+	(void) unlink(path);
+
+	listen_ = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_ < 0
+	|| bind(listen_, (struct sockaddr *) &addr, sizeof addr) < 0
+	|| listen(listen_, 64) < 0) {
+		error_ = strerror(errno);
+		if (listen_ >= 0)
+			(void) close(listen_);
+		listen_ = -1;
+		return;
+	}
+
+	// Clients that go away must not stop the server
+	(void) signal(SIGPIPE, SIG_IGN);
+}
+
+//
+// Destructor for Server
+//
+Server::~Server(void)
+{
+	if (listen_ >= 0) {
+		(void) close(listen_);
+		(void) unlink(path_.c_str());
+	}
+#ifndef NO_THREADS
+	(void) pthread_mutex_destroy(&lock_);
+#endif
+}
+
+//
+// Serialize the parts of a request that use static state
+//
+void
+Server::lock(void)
+{
+#ifndef NO_THREADS
+	(void) pthread_mutex_lock(&lock_);
+#endif
+}
+
+void
+Server::unlock(void)
+{
+#ifndef NO_THREADS
+	(void) pthread_mutex_unlock(&lock_);
+#endif
+}
+
+#ifndef NO_THREADS
+//
+// Thread entry point
+//
+void *
+Server::startWorker(void *arg)
+{
+	((Server *) arg)->worker();
+	return NULL;
+}
+#endif
+
+//
+// Serve requests until the socket fails
+//
+void
+Server::run(void)
+{
+#ifndef NO_THREADS
+	pthread_t *threads = new pthread_t[workers_];
+	int i;
+	for (i = 0; i < workers_; i++)
+		(void) pthread_create(&threads[i], NULL, startWorker, this);
+	for (i = 0; i < workers_; i++)
+		(void) pthread_join(threads[i], NULL);
+	delete [] threads;
+#else
+	worker();
+#endif
+}
+
+//
+// Accept connections and serve each in turn
+//
+void
+Server::worker(void)
+{
+	size_t size = InitialBuffer;
+	char *buf = new char[size];
+	for (;;) {
+		int fd = accept(listen_, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+		serve(fd, buf, size);
+		(void) close(fd);
+	}
+	delete [] buf;
+}
+
+//
+// Answer the requests on one connection until the client closes it
+// (buf, of the given size, is grown as needed)
+//
+void
+Server::serve(int fd, char *&buf, size_t &size)
+{
+	for (;;) {
+		int header[2];
+		if (readFully(fd, header, sizeof header) <= 0)
+			return;
+		std::string reply;
+		int status = 0;
+		size_t length = (unsigned int) header[1];
+		if (length > SERVE_MAX_PAYLOAD) {
+			reply = "request too long";
+			status = 1;
+		}
+		else {
+			if (length > size) {
+				while (size < length)
+					size *= 2;
+				delete [] buf;
+				buf = new char[size];
+			}
+			if (readFully(fd, buf, length) < 0)
+				return;
+			Metrics::addQueue(Q_REQUESTS, 1);
+			if (process(header[0], buf, length, reply) < 0)
+				status = 1;
+			Metrics::addQueue(Q_REQUESTS, -1);
+		}
+		if (status != 0)
+			Metrics::countError();
+		int replyHeader[2];
+		replyHeader[0] = status;
+		replyHeader[1] = (int) reply.size();
+		if (writeFully(fd, replyHeader, sizeof replyHeader) < 0
+		|| writeFully(fd, reply.data(), reply.size()) < 0
+		|| length > SERVE_MAX_PAYLOAD)
+			return;
+	}
+}
+
+//
+// Assign secondary structure for one request, leaving the records
+// (or an error message) in reply
+// Return 0 on success and -1 on error
+//
+int
+Server::process(int kind, const char *data, size_t length,
+							std::string &reply)
+{
+	List<Model> modelList;
+	Pix p;
+	PROBE2(request__start, kind, length);
+	if (kind == SERVE_PDB) {
+		lock();
+		FILE *input = length > 0
+			? fmemopen((void *) data, length, "r") : NULL;
+		if (input != NULL) {
+			(void) Model::readModels(input, modelList, reply);
+			(void) fclose(input);
+		}
+		Model::endInput();
+		unlock();
+	}
+	else if (kind == SERVE_COORDS) {
+		int count = -1;
+		if (length >= sizeof count)
+			(void) memcpy(&count, data, sizeof count);
+		if (count < 1 || length != sizeof count
+				+ (size_t) count * SS_RECORD_SIZE
+				+ (size_t) count * A_COUNT * 3 * sizeof (float))
+			reply = "bad coordinate request";
+		else {
+			SSResidue *residues = new SSResidue[count];
+			int *atoms = new int[count];
+			const char *records = data + sizeof count;
+			const float *xyz = (const float *)
+					(records + count * SS_RECORD_SIZE);
+			Assignment::unpackRecords(records, count,
+							residues, atoms);
+			modelList.append(Assignment::makeModel(residues, xyz,
+								atoms, count));
+			delete [] residues;
+			delete [] atoms;
+		}
+	}
+	else if (kind == SERVE_SHM) {
+#ifndef NO_SHM
+		std::string name(data, length);
+		SharedSegment segment(name.c_str());
+		if (segment.assign() < 0) {
+			reply = segment.error();
+			return -1;
+		}
+		Metrics::countInput(I_REQUEST, 1, segment.residueCount());
+		return 0;
+#else
+		reply = "shared memory not supported";
+#endif
+	}
+	else
+		reply = "unknown request";
+	if (modelList.count() == 0) {
+		if (reply == "")
+			reply = "no atoms read";
+		return -1;
+	}
+
+	int residues = 0;
+	for (p = modelList.first(); p != 0; modelList.next(p)) {
+		modelList(p)->defineSecondaryStructure();
+		residues += modelList(p)->residueCount();
+	}
+
+	char *text = NULL;
+	size_t textSize = 0;
+	lock();
+	FILE *output = open_memstream(&text, &textSize);
+	if (output != NULL) {
+		(*printer_)(modelList, output, NULL);
+		(void) fclose(output);
+	}
+	unlock();
+	if (text != NULL) {
+		reply.assign(text, textSize);
+		free(text);
+	}
+	PROBE3(request__done, kind, modelList.count(), residues);
+	Metrics::countInput(I_REQUEST, modelList.count(), residues);
+	for (p = modelList.first(); p != 0; modelList.next(p))
+		delete modelList(p);
+	return output != NULL ? 0 : -1;
+}
+
+//
+// Send the PDB file read from input to the server at path and write
+// the records it returns to output
+// Return 0 on success and -1 (with error set) on error
+//
+int
+Server::request(const char *path, FILE *input, FILE *output,
+							std::string &error)
+{
+	std::string text;
+	char buf[BUFSIZ];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof buf, input)) > 0)
+		text.append(buf, n);
+	if (ferror(input)) {
+		error = strerror(errno);
+		return -1;
+	}
+
+	struct sockaddr_un addr;
+	if (socketAddress(path, &addr, error) < 0)
+		return -1;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0
+	|| connect(fd, (struct sockaddr *) &addr, sizeof addr) < 0) {
+		error = strerror(errno);
+		if (fd >= 0)
+			(void) close(fd);
+		return -1;
+	}
+	int header[2];
+	header[0] = SERVE_PDB;
+	header[1] = (int) text.size();
+	int replyHeader[2];
+	if (writeFully(fd, header, sizeof header) < 0
+	|| writeFully(fd, text.data(), text.size()) < 0
+	|| readFully(fd, replyHeader, sizeof replyHeader) <= 0) {
+		error = "connection to server lost";
+		(void) close(fd);
+		return -1;
+	}
+	std::string reply((unsigned int) replyHeader[1], '\0');
+	if (reply.size() > 0 && readFully(fd, &reply[0], reply.size()) <= 0) {
+		error = "incomplete reply from server";
+		(void) close(fd);
+		return -1;
+	}
+	(void) close(fd);
+	if (replyHeader[0] != 0) {
+		error = reply;
+		return -1;
+	}
+	if (fwrite(reply.data(), 1, reply.size(), output) != reply.size()) {
+		error = strerror(errno);
+		return -1;
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef server_h
+#define server_h
+
+#include "ksdssp.h"
+
+#ifndef NO_SERVER
+
+#include <stdio.h>
+#include <string>
+#ifndef NO_THREADS
+#include <pthread.h>
+#endif
+#include "List.h"
+#include "Model.h"
+
+//
+// Protocol between ksdssp -C (or any other client) and ksdssp -D,
+// over a Unix domain stream socket.  A connection carries any number
+// of requests, each answered before the next is read.  All integers
+// are 32 bits, in the byte order of the host (both ends are on the
+// same machine).
+//
+// Request:	kind, length, then length bytes of payload
+// Reply:	status (0 for success), length, then length bytes of text:
+//		the HELIX and SHEET records ksdssp would print for the
+//		request (or an error message)
+//
+// SERVE_PDB payloads are the text of a PDB file.  SERVE_COORDS
+// payloads are a residue count n, then n residue records (see
+// SS_RECORD_SIZE in Assignment.h), then n * A_COUNT * 3 floats, laid
+// out as for Assignment::assign.  SERVE_SHM payloads are the name of a
+// shared memory segment (see SharedSegment.h), which the server fills
+// in; the reply then has no text.
+//
+#define	SERVE_PDB	1
+#define	SERVE_COORDS	2
+#define	SERVE_SHM	3
+#define	SERVE_MAX_PAYLOAD	(1 << 30)
+
+//
+// Function that prints the secondary structure assigned to models
+//
+typedef void	(*StructurePrinter)(List<Model> &modelList, FILE *output,
+							FILE *summary);
+
+//
+// Serve requests on a Unix domain socket.  Each worker thread accepts
+// connections and serves them in turn, reusing its request buffer.
+// Reading PDB text and printing records are serialized (the PDB
+// library and the model reader keep static state); assignment runs
+// in parallel.  The assignment options are those of the server.
+//
+class Server {
+	std::string	error_;
+	std::string	path_;
+	int		listen_;
+	StructurePrinter printer_;
+	int		workers_;
+#ifndef NO_THREADS
+	pthread_mutex_t	lock_;
+	static void	*startWorker(void *arg);
+#endif
+	void		lock(void);
+	void		unlock(void);
+	void		worker(void);
+	void		serve(int fd, char *&buf, size_t &size);
+	int		process(int kind, const char *data, size_t length,
+				std::string &reply);
+public:
+			Server(const char *path, StructurePrinter printer,
+								int workers);
+			~Server(void);
+	int		okay(void) const { return error_ == ""; }
+	const char	*error(void) const { return error_.c_str(); }
+	void		run(void);
+	static int	request(const char *path, FILE *input, FILE *output,
+							std::string &error);
+};
+
+#endif
+
+#endif
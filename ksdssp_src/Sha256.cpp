@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "Sha256.h"
+
+static const unsigned int	K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline unsigned int
+rotr(unsigned int x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+//
+// Constructor for Sha256 (empty message)
+//
+Sha256::Sha256(void)
+{
+	h_[0] = 0x6a09e667;
+	h_[1] = 0xbb67ae85;
+	h_[2] = 0x3c6ef372;
+	h_[3] = 0xa54ff53a;
+	h_[4] = 0x510e527f;
+	h_[5] = 0x9b05688c;
+	h_[6] = 0x1f83d9ab;
+	h_[7] = 0x5be0cd19;
+	blockUsed_ = 0;
+	length_ = 0;
+}
+
+//
+// Process one 64-byte block
+//
+void
+Sha256::compress(const unsigned char *block)
+{
+	unsigned int w[64];
+	int i;
+	for (i = 0; i < 16; i++)
+		w[i] = ((unsigned int) block[4 * i] << 24)
+			| ((unsigned int) block[4 * i + 1] << 16)
+			| ((unsigned int) block[4 * i + 2] << 8)
+			| (unsigned int) block[4 * i + 3];
+	for (i = 16; i < 64; i++) {
+		unsigned int s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18)
+				^ (w[i - 15] >> 3);
+		unsigned int s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19)
+				^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+	unsigned int a = h_[0], b = h_[1], c = h_[2], d = h_[3];
+	unsigned int e = h_[4], f = h_[5], g = h_[6], h = h_[7];
+	for (i = 0; i < 64; i++) {
+		unsigned int s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+		unsigned int ch = (e & f) ^ (~e & g);
+		unsigned int t1 = h + s1 + ch + K[i] + w[i];
+		unsigned int s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+		unsigned int maj = (a & b) ^ (a & c) ^ (b & c);
+		unsigned int t2 = s0 + maj;
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+	h_[0] += a;
+	h_[1] += b;
+	h_[2] += c;
+	h_[3] += d;
+	h_[4] += e;
+	h_[5] += f;
+	h_[6] += g;
+	h_[7] += h;
+}
+
+//
+// Add count bytes to the message
+//
+void
+Sha256::update(const void *data, size_t count)
+{
+	const unsigned char *p = (const unsigned char *) data;
+	length_ += count;
+	while (count > 0) {
+		size_t n = 64 - blockUsed_;
+		if (n > count)
+			n = count;
+		(void) memcpy(block_ + blockUsed_, p, n);
+		blockUsed_ += n;
+		p += n;
+		count -= n;
+		if (blockUsed_ == 64) {
+			compress(block_);
+			blockUsed_ = 0;
+		}
+	}
+}
+
+//
+// Finish the message and return its digest
+//
+void
+Sha256::final(unsigned char digest[DigestSize])
+{
+	unsigned long long bits = length_ * 8;
+	unsigned char pad = 0x80;
+	update(&pad, 1);
+	pad = 0;
+	while (blockUsed_ != 56)
+		update(&pad, 1);
+	unsigned char len[8];
+	for (int i = 0; i < 8; i++)
+		len[i] = (unsigned char) (bits >> (56 - 8 * i));
+	update(len, 8);
+	for (int i = 0; i < 8; i++) {
+		digest[4 * i] = (unsigned char) (h_[i] >> 24);
+		digest[4 * i + 1] = (unsigned char) (h_[i] >> 16);
+		digest[4 * i + 2] = (unsigned char) (h_[i] >> 8);
+		digest[4 * i + 3] = (unsigned char) h_[i];
+	}
+}
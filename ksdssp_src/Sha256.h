@@ -29,36 +29,26 @@
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef atom_h
-#define atom_h
+#ifndef sha256_h
+#define sha256_h
 
-#include <stdio.h>
-#include <string>
+#include <stddef.h>
 
-class Atom {
-	std::string	name_;
-	float		coord_[3];
+//
+// SHA-256 message digest (FIPS 180-4)
+//
+class Sha256 {
+	unsigned int	h_[8];
+	unsigned char	block_[64];
+	size_t		blockUsed_;
+	unsigned long long
+			length_;
+	void		compress(const unsigned char *block);
 public:
-			Atom(const std::string &name, double coord[3]);
-			Atom(const std::string &name, float coord[3]);
-	const std::string	&name(void) const { return name_; }
-	const float	*coord(void) const { return coord_; }
+	static const int DigestSize = 32;
+			Sha256(void);
+	void		update(const void *data, size_t count);
+	void		final(unsigned char digest[DigestSize]);
 };
 
-inline
-Atom::Atom(const std::string &name, double coord[3])
-	: name_(name)
-{
-	for (int i = 0; i < 3; i++)
-		coord_[i] = coord[i];
-}
-
-inline
-Atom::Atom(const std::string &name, float coord[3])
-	: name_(name)
-{
-	for (int i = 0; i < 3; i++)
-		coord_[i] = coord[i];
-}
-
 #endif
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "SharedSegment.h"
+
+#ifndef NO_SHM
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Assignment.h"
+#include "Model.h"
+
+//
+// Constructor for SharedSegment (map the named segment)
+//
+SharedSegment::SharedSegment(const char *name) : error_()
+{
+	base_ = NULL;
+	size_ = 0;
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0) {
+		error_ = strerror(errno);
+		return;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		error_ = strerror(errno);
+		(void) close(fd);
+		return;
+	}
+	size_ = st.st_size;
+	if (size_ < sizeof (SharedHeader)) {
+		error_ = "segment too small";
+		(void) close(fd);
+		return;
+	}
+	void *p = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	(void) close(fd);
+	if (p == MAP_FAILED) {
+		error_ = strerror(errno);
+		return;
+	}
+	base_ = (char *) p;
+	SharedHeader *h = (SharedHeader *) base_;
+	if (memcmp(h->magic, SHM_MAGIC, sizeof h->magic) != 0
+	|| h->version != SHM_VERSION)
+		error_ = "not a ksdssp segment";
+}
+
+//
+// Destructor for SharedSegment
+//
+SharedSegment::~SharedSegment(void)
+{
+	if (base_ != NULL)
+		(void) munmap(base_, size_);
+}
+
+//
+// Report an error in the segment (and in error)
+// Return -1
+//
+int
+SharedSegment::fail(const char *message)
+{
+	error_ = message;
+	SharedHeader *h = (SharedHeader *) base_;
+	(void) strncpy(h->error, message, sizeof h->error - 1);
+	h->error[sizeof h->error - 1] = '\0';
+	__sync_synchronize();
+	h->status = SHM_ERROR;
+	return -1;
+}
+
+//
+// Whether count bytes at offset lie within a segment of size bytes
+//
+static int
+inside(size_t size, long offset, long count)
+{
+	return offset >= 0 && count >= 0 && (size_t) offset <= size
+		&& (size_t) count <= size - offset;
+}
+
+//
+// Assign secondary structure to the residues in the segment and
+// write the results into it
+// Return 0 on success and -1 (with error set) on error
+//
+int
+SharedSegment::assign(void)
+{
+	if (base_ == NULL || !okay())
+		return -1;
+	SharedHeader *h = (SharedHeader *) base_;
+	long n = h->residueCount;
+	if (n < 1)
+		return fail("no residues given");
+	if (!inside(size_, h->recordOffset, n * SS_RECORD_SIZE)
+	|| !inside(size_, h->coordOffset, n * A_COUNT * 3 * sizeof (float))
+	|| !inside(size_, h->resultOffset, h->resultSize)
+	|| h->coordOffset % 4 != 0 || h->resultOffset % 4 != 0)
+		return fail("bad segment layout");
+
+	// The records are unpacked and the coordinates copied into a
+	// model of our own (which adds imide hydrogens to them), as for
+	// a structure received over a socket
+	SSResidue *residues = new SSResidue[n];
+	int *atoms = new int[n];
+	Assignment::unpackRecords(base_ + h->recordOffset, (int) n,
+							residues, atoms);
+	Model *m = Assignment::makeModel(residues,
+		(const float *) (base_ + h->coordOffset), atoms, (int) n);
+	delete [] residues;
+	delete [] atoms;
+	Assignment a;
+	int status = a.assign(*m);
+	delete m;
+	if (status < 0)
+		return fail(a.error());
+
+	long codeBytes = (n + 3) / 4 * 4;
+	long needed = 4 * sizeof (int) + codeBytes
+		+ (3L * a.helixCount() + 6L * a.ladderCount()
+		+ 3L * a.sheetCount() + 5L * a.strandCount()) * sizeof (int);
+	if (needed > h->resultSize)
+		return fail("result region too small");
+
+	int *counts = (int *) (base_ + h->resultOffset);
+	counts[0] = a.helixCount();
+	counts[1] = a.ladderCount();
+	counts[2] = a.sheetCount();
+	counts[3] = a.strandCount();
+	char *codes = (char *) (counts + 4);
+	(void) memcpy(codes, a.codes(), n);
+	(void) memset(codes + n, 0, codeBytes - n);
+	int *out = (int *) (codes + codeBytes);
+	int i;
+	for (i = 0; i < a.helixCount(); i++) {
+		const SSHelix &x = a.helix(i);
+		*out++ = x.from;
+		*out++ = x.to;
+		*out++ = x.type;
+	}
+	for (i = 0; i < a.ladderCount(); i++) {
+		const SSLadder &x = a.ladder(i);
+		*out++ = x.parallel;
+		*out++ = x.start[0];
+		*out++ = x.end[0];
+		*out++ = x.start[1];
+		*out++ = x.end[1];
+		*out++ = x.sheet;
+	}
+	for (i = 0; i < a.sheetCount(); i++) {
+		const SSSheet &x = a.sheet(i);
+		*out++ = x.firstStrand;
+		*out++ = x.strandCount;
+		*out++ = x.cyclic;
+	}
+	for (i = 0; i < a.strandCount(); i++) {
+		const Strand &x = a.strand(i);
+		*out++ = x.start;
+		*out++ = x.end;
+		*out++ = x.sense;
+		*out++ = x.nResidue;
+		*out++ = x.oResidue;
+	}
+
+	// The results are complete before the host can see the status
+	h->error[0] = '\0';
+	__sync_synchronize();
+	h->status = SHM_DONE;
+	return 0;
+}
+
+#endif
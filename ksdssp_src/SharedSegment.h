@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef sharedsegment_h
+#define sharedsegment_h
+
+#include "ksdssp.h"
+
+#ifndef NO_SHM
+
+#include <stddef.h>
+#include <string>
+
+//
+// Layout of a POSIX shared memory segment (shm_open) through which a
+// host process passes a structure to ksdssp and gets its secondary
+// structure back.  All integers are 32 bits in host byte order, and
+// offsets are in bytes from the start of the segment.  The host fills
+// in the header (with status SHM_PENDING), the residue records and
+// the coordinates; ksdssp writes the results and then sets status to
+// SHM_DONE (or SHM_ERROR, with a message in error).  The segment saves
+// writing, sending and parsing the structure; ksdssp still copies the
+// coordinates into its model, since it writes imide hydrogens there.
+//
+// At recordOffset:	residueCount residue records (see SS_RECORD_SIZE
+//			in Assignment.h)
+// At coordOffset:	residueCount * A_COUNT * 3 floats, laid out as
+//			for Assignment::assign (4-byte aligned)
+// At resultOffset:	(4-byte aligned, at most resultSize bytes)
+//			helixCount, ladderCount, sheetCount, strandCount,
+//			then residueCount codes (see Residue::summaryCode),
+//			padded with nulls to a multiple of 4 bytes,
+//			then for each helix: from, to, type,
+//			for each ladder: parallel, start[0], end[0],
+//				start[1], end[1], sheet,
+//			for each sheet: firstStrand, strandCount, cyclic,
+//			for each strand: start, end, sense, nResidue,
+//				oResidue
+//			(see the SS structures in Assignment.h)
+//
+#define	SHM_MAGIC	"KSSM"
+#define	SHM_VERSION	1
+
+#define	SHM_PENDING	0
+#define	SHM_DONE	1
+#define	SHM_ERROR	2
+
+struct SharedHeader {
+	char	magic[4];		// SHM_MAGIC
+	int	version;		// SHM_VERSION
+	int	residueCount;
+	int	recordOffset;
+	int	coordOffset;
+	int	resultOffset;
+	int	resultSize;
+	int	status;
+	char	error[96];
+};
+
+//
+// Shared memory segment, mapped for the life of the object
+//
+class SharedSegment {
+	std::string	error_;
+	char		*base_;
+	size_t		size_;
+	int		fail(const char *message);
+public:
+			SharedSegment(const char *name);
+			~SharedSegment(void);
+	int		okay(void) const { return error_ == ""; }
+	const char	*error(void) const { return error_.c_str(); }
+	int		assign(void);
+	int		residueCount(void) const
+			{
+				return base_ == NULL ? 0 :
+				((const SharedHeader *) base_)->residueCount;
+			}
+};
+
+#endif
+
+#endif
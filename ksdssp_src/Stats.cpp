@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Stats.h"
+
+#ifdef WITH_STATS
+
+#include "Model.h"
+
+THREAD_LOCAL WorkStats	*WorkStats::current = NULL;
+
+static const char	*StatName[S_COUNT] = {
+	"pairs", "far", "hbonds", "candidates", "bridges",
+	"ladders", "bulges", "pruned", "sheets"
+};
+
+//
+// Constructor for WorkStats (nothing counted yet)
+//
+WorkStats::WorkStats(void)
+{
+	for (int n = 0; n < S_COUNT; n++)
+		count_[n] = 0;
+}
+
+//
+// Add the counts of another model (or copy of this one)
+//
+void
+WorkStats::add(const WorkStats &s)
+{
+	for (int n = 0; n < S_COUNT; n++)
+		count_[n] += s.count_[n];
+}
+
+//
+// Print the counts of each model, and their sum
+//
+void
+WorkStats::printTable(FILE *output, List<Model> &modelList)
+{
+	int n;
+	(void) fprintf(output, "%5s %8s", "model", "residues");
+	for (n = 0; n < S_COUNT; n++)
+		(void) fprintf(output, " %10s", StatName[n]);
+	(void) fprintf(output, "\n");
+
+	WorkStats sum;
+	int residues = 0;
+	int model = 0;
+	for (Pix p = modelList.first(); p != 0; modelList.next(p)) {
+		const Model *m = modelList(p);
+		const WorkStats *s = m->stats();
+		if (s == NULL)
+			continue;
+		sum.add(*s);
+		residues += m->residueCount();
+		(void) fprintf(output, "%5d %8d", ++model, m->residueCount());
+		for (n = 0; n < S_COUNT; n++)
+			(void) fprintf(output, " %10ld", s->value(n));
+		(void) fprintf(output, "\n");
+	}
+	(void) fprintf(output, "%5s %8d", "all", residues);
+	for (n = 0; n < S_COUNT; n++)
+		(void) fprintf(output, " %10ld", sum.value(n));
+	(void) fprintf(output, "\n");
+}
+
+#endif
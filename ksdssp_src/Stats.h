@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef stats_h
+#define stats_h
+
+#include <stdio.h>
+#include "ksdssp.h"
+#include "List.h"
+
+class Model;
+
+//
+// Work counted for each model with -w (when built with WITH_STATS;
+// otherwise the counting compiles to nothing)
+//
+#define	S_PAIRS		0	// residue pairs given to hBondedTo
+#define	S_FAR		1	// pairs rejected by the C-N distance test
+#define	S_HBONDS	2	// pairs within the energy cutoff
+#define	S_CANDIDATES	3	// bridge candidates examined
+#define	S_BRIDGES	4	// candidates marked as bridges
+#define	S_LADDERS	5	// ladders built from the bridges
+#define	S_BULGES	6	// ladder pairs merged across a bulge
+#define	S_PRUNED	7	// ladders dropped as too short
+#define	S_SHEETS	8	// sheets found
+#define	S_COUNT		9
+
+#ifdef WITH_STATS
+
+//
+// Counts of the work done for one model (summed over the frames of
+// a trajectory).  Work is counted in the WorkStats of the thread,
+// which a model sets (with STATS_FOR) before working.
+//
+class WorkStats {
+	long		count_[S_COUNT];
+public:
+			WorkStats(void);
+	void		count(int n) { count_[n]++; }
+	long		value(int n) const { return count_[n]; }
+	void		add(const WorkStats &s);
+	static THREAD_LOCAL WorkStats
+			*current;
+	static void	printTable(FILE *output, List<Model> &modelList);
+};
+
+#define	STAT(n)		do { \
+				if (WorkStats::current != NULL) \
+					WorkStats::current->count(n); \
+			} while (0)
+#define	STATS_FOR(s)	(WorkStats::current = (s))
+
+#else
+
+#define	STAT(n)		do { } while (0)
+#define	STATS_FOR(s)	((void) 0)
+
+#endif
+
+#endif
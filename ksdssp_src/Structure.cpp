@@ -33,6 +33,18 @@
 #include <ctype.h>
 #include "Structure.h"
 
+inline int
+min(int i1, int i2)
+{
+	return i1 < i2 ? i1 : i2;
+}
+
+inline int
+max(int i1, int i2)
+{
+	return i1 > i2 ? i1 : i2;
+}
+
 //
 // Constructor for Ladder
 //
@@ -187,3 +199,124 @@ Sheet::firstLadder(void)
 	}
 	return ladderList_.head();
 }
+
+//
+// Check whether side s1 of ladder l1 and side s2 of ladder l2 share
+// residues
+//
+static int
+sidesOverlap(const Ladder *l1, int s1, const Ladder *l2, int s2)
+{
+	return l1->end(s1) >= l2->start(s2) && l2->end(s2) >= l1->start(s1);
+}
+
+//
+// Check whether the strands of a ring of count ladders would be
+// distinct (share no residues), the ring being closed by linking side
+// lastSide of the last ladder with side firstSide of the first.  Each
+// strand spans the sides of the two ladders it links.
+//
+static int
+distinctStrands(Ladder **ring, int count, int lastSide, int firstSide)
+{
+	int *start = new int[count];
+	int *end = new int[count];
+	int i;
+	for (i = 0; i < count; i++) {
+		Ladder *l = ring[i];
+		Ladder *next = ring[(i + 1) % count];
+		int s, ns;
+		if (i == count - 1) {
+			s = lastSide;
+			ns = firstSide;
+		}
+		else {
+			s = l->neighbor(0) == next ? 0 : 1;
+			ns = next->neighbor(0) == l ? 0 : 1;
+		}
+		start[i] = min(l->start(s), next->start(ns));
+		end[i] = max(l->end(s), next->end(ns));
+	}
+	int distinct = 1;
+	for (i = 0; i < count && distinct; i++)
+		for (int k = i + 1; k < count; k++)
+			if (end[i] >= start[k] && end[k] >= start[i]) {
+				distinct = 0;
+				break;
+			}
+	delete [] start;
+	delete [] end;
+	return distinct;
+}
+
+//
+// Close a barrel, so that the sheet is cyclic.  The ladders of a sheet
+// form a chain, and the ladders at its two ends are linked if they
+// overlap on their free sides and the strands of the cycle are
+// distinct.  A barrel may also be entered through a strand that pairs
+// with a third ladder, so that an end of the chain overlaps a ladder
+// further along on the side that links it back towards the other end,
+// while pairing with a different part of that strand than the ladder
+// linked there.  That link is then broken to close the barrel on the
+// end, and the ladders cut off are returned as a new sheet named name.
+// The longest cycle is closed.  Returns NULL unless a new sheet was
+// made.
+//
+Sheet *
+Sheet::closeBarrel(char name)
+{
+	int count = ladderList_.count();
+	if (count < 3 || firstLadder()->neighborCount() != 1)
+		return NULL;
+	Ladder **chain = new Ladder *[count];
+	int n = 0;
+	Ladder *pl = NULL;
+	for (Ladder *l = firstLadder(); l != NULL && n < count; ) {
+		chain[n++] = l;
+		Ladder *next = l->otherNeighbor(pl);
+		pl = l;
+		l = next;
+	}
+
+	Sheet *tail = NULL;
+	for (int pass = 0; pass < 2 && n == count; pass++) {
+		if (pass == 1)
+			for (int k = 0; k < n / 2; k++) {
+				Ladder *t = chain[k];
+				chain[k] = chain[n - 1 - k];
+				chain[n - 1 - k] = t;
+			}
+		Ladder *end = chain[n - 1];
+		int side = end->neighbor(0) == NULL ? 0 : 1;
+		for (int i = 0; i <= n - 3; i++) {
+			Ladder *l = chain[i];
+			for (int lside = 0; lside < 2; lside++) {
+				if (!sidesOverlap(end, side, l, lside))
+					continue;
+				Ladder *cut = i == 0 ? NULL : chain[i - 1];
+				if (l->neighbor(lside) != cut)
+					continue;
+				if (!distinctStrands(chain + i, n - i, side, lside))
+					continue;
+				if (cut != NULL) {
+					int cside = cut->neighbor(0) == l ? 0 : 1;
+					if (sidesOverlap(end, side, cut, cside))
+						continue;
+					cut->setNeighbor(cside, NULL);
+					tail = new Sheet(name);
+					for (int k = 0; k < i; k++) {
+						(void) ladderList_.remove(chain[k]);
+						tail->addLadder(chain[k]);
+						chain[k]->setSheet(tail);
+					}
+				}
+				l->setNeighbor(lside, end);
+				end->setNeighbor(side, l);
+				delete [] chain;
+				return tail;
+			}
+		}
+	}
+	delete [] chain;
+	return NULL;
+}
@@ -79,6 +79,18 @@ public:
 		*mergeBulge(const Ladder *l1, const Ladder *l2);
 };
 
+//
+// Strand of a sheet, as in a PDB SHEET record: residues start to end,
+// with the sense relative to the previous strand (1 parallel, -1
+// antiparallel, 0 for none) and the residues whose N (on this strand)
+// and O (on the previous strand) atoms register the two
+//
+struct Strand {
+	int	start, end;
+	int	sense;
+	int	nResidue, oResidue;
+};
+
 class Sheet {
 	char		name_;
 	List<Ladder>	ladderList_;
@@ -89,6 +101,7 @@ public:
 	const List<Ladder> &
 		ladderList(void) const { return ladderList_; }
 	Ladder	*firstLadder(void);
+	Sheet	*closeBarrel(char name);
 };
 
 #endif
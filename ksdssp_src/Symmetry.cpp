@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "ksdssp.h"
+#include "Symmetry.h"
+
+//
+// Constructor for Operator (identity until rows are set)
+//
+Operator::Operator(int serialNum)
+{
+	serialNum_ = serialNum;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 4; j++)
+			m_[i][j] = i == j ? 1 : 0;
+}
+
+//
+// Set one row of the operator from a MTRIX record
+//
+void
+Operator::setRow(const PDB::Mtrix &m)
+{
+	int row = m.rowNum - 1;
+	if (row < 0 || row > 2)
+		return;
+	m_[row][0] = m.m1;
+	m_[row][1] = m.m2;
+	m_[row][2] = m.m3;
+	m_[row][3] = m.v;
+}
+
+//
+// Apply operator to a point
+//
+void
+Operator::apply(float out[3], const float in[3]) const
+{
+	for (int i = 0; i < 3; i++)
+		out[i] = m_[i][0] * in[0] + m_[i][1] * in[1]
+			+ m_[i][2] * in[2] + m_[i][3];
+}
+
+//
+// Compute the operator that maps the asymmetric unit onto copy "o"
+// as seen from the frame of this copy (inverse(this) * o)
+// The rotation part is assumed to be orthonormal
+//
+void
+Operator::relative(const Operator &o, Operator *r) const
+{
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			float s = 0;
+			for (int k = 0; k < 3; k++)
+				s += m_[k][i] * o.m_[k][j];
+			r->m_[i][j] = s;
+		}
+		float t = 0;
+		for (int k = 0; k < 3; k++)
+			t += m_[k][i] * (o.m_[k][3] - m_[k][3]);
+		r->m_[i][3] = t;
+	}
+}
+
+//
+// Check if two operators are the same (within coordinate precision)
+//
+int
+Operator::sameAs(const Operator &o) const
+{
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++)
+			if (fabs(m_[i][j] - o.m_[i][j]) > 1e-3)
+				return 0;
+		if (fabs(m_[i][3] - o.m_[i][3]) > 1e-2)
+			return 0;
+	}
+	return 1;
+}
+
+//
+// Order bond pairs by acceptor, then donor
+//
+static int
+pairCmp(const void *v1, const void *v2)
+{
+	const int *p1 = (const int *) v1;
+	const int *p2 = (const int *) v2;
+	if (p1[0] != p2[0])
+		return p1[0] < p2[0] ? -1 : 1;
+	if (p1[1] != p2[1])
+		return p1[1] < p2[1] ? -1 : 1;
+	return 0;
+}
+
+//
+// Constructor for CopyBonds (find hydrogen bonds, with energies below
+// cutoff, between the n residues of the asymmetric unit and their image
+// under op)
+//
+CopyBonds::CopyBonds(const Operator &op, const Residue *au, int n,
+								float cutoff)
+	: op_(op)
+{
+	count_ = 0;
+	pair_ = NULL;
+
+	// Place donor N and H of each residue in the frame of the
+	// asymmetric unit, and find the box around the acceptor C atoms
+	float (*xyz)[A_COUNT][3] = new float[n][A_COUNT][3];
+	Residue *donor = new Residue[n];
+	float lo[3], hi[3];
+	int empty = 1;
+	int i, j, k;
+	for (i = 0; i < n; i++) {
+		const Residue &r = au[i];
+		const float *a = r.atom(A_N);
+		const float *h = r.atom(A_H);
+		if (a != NULL && h != NULL) {
+			op.apply(xyz[i][A_N], a);
+			op.apply(xyz[i][A_H], h);
+			donor[i] = Residue(&r.residue(), xyz[i],
+					(1 << A_N) | (1 << A_H));
+		}
+		const float *c = r.atom(A_C);
+		if (c == NULL)
+			continue;
+		for (k = 0; k < 3; k++) {
+			if (empty || c[k] < lo[k])
+				lo[k] = c[k];
+			if (empty || c[k] > hi[k])
+				hi[k] = c[k];
+		}
+		empty = 0;
+	}
+
+	int size = 0;
+	for (j = 0; j < n && !empty; j++) {
+		const float *a = donor[j].atom(A_N);
+		if (a == NULL)
+			continue;
+		float d2 = 0;
+		for (k = 0; k < 3; k++) {
+			float gap = a[k] < lo[k] ? lo[k] - a[k] :
+					a[k] > hi[k] ? a[k] - hi[k] : 0;
+			d2 += gap * gap;
+		}
+		if (d2 > 49.0)
+			continue;
+		for (i = 0; i < n; i++) {
+			if (!au[i].hBondedTo(&donor[j], cutoff))
+				continue;
+			if (count_ == size) {
+				size = size == 0 ? 16 : size * 2;
+				Pair *p = new Pair[size];
+				for (k = 0; k < count_; k++)
+					p[k] = pair_[k];
+				delete [] pair_;
+				pair_ = p;
+			}
+			pair_[count_].acceptor = i;
+			pair_[count_].donor = j;
+			count_++;
+		}
+	}
+	qsort(pair_, count_, sizeof (Pair), pairCmp);
+
+	delete [] donor;
+	delete [] xyz;
+}
+
+//
+// Check if acceptor (in the asymmetric unit) is hydrogen bonded
+// to donor (in the copy)
+//
+int
+CopyBonds::bonded(int acceptor, int donor) const
+{
+	Pair key;
+	key.acceptor = acceptor;
+	key.donor = donor;
+	return bsearch(&key, pair_, count_, sizeof (Pair), pairCmp) != NULL;
+}
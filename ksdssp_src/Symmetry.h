@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef symmetry_h
+#define symmetry_h
+
+#include <pdb++.h>
+#include "Residue.h"
+
+//
+// Rigid-body operator mapping asymmetric unit coordinates onto
+// one copy of the assembly (as given by PDB MTRIX records)
+//
+class Operator {
+	int	serialNum_;
+	float	m_[3][4];
+public:
+		Operator(int serialNum = 0);
+	int	serialNum(void) const { return serialNum_; }
+	void	setRow(const PDB::Mtrix &m);
+	void	apply(float out[3], const float in[3]) const;
+	void	relative(const Operator &o, Operator *r) const;
+	int	sameAs(const Operator &o) const;
+};
+
+//
+// Hydrogen bonds between residues of the asymmetric unit (acceptors)
+// and residues of a copy placed by a relative operator (donors)
+//
+class CopyBonds {
+	struct Pair {
+		int	acceptor, donor;
+	};
+	Operator	op_;
+	int		count_;
+	Pair		*pair_;
+public:
+			CopyBonds(const Operator &op,
+					const Residue *au, int n,
+					float cutoff);
+			~CopyBonds(void) { delete [] pair_; }
+	const Operator	&op(void) const { return op_; }
+	int		count(void) const { return count_; }
+	int		acceptor(int k) const { return pair_[k].acceptor; }
+	int		donor(int k) const { return pair_[k].donor; }
+	int		bonded(int acceptor, int donor) const;
+};
+
+#endif
@@ -0,0 +1,536 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Timings.h"
+#include "Model.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+int			StageTimes::countMemory = 0;
+int			StageTimes::countEvents = 0;
+THREAD_LOCAL long long	StageTimes::allocatedBytes = 0;
+THREAD_LOCAL long long	StageTimes::allocationCount = 0;
+
+static const char	*StageName[T_COUNT] = {
+	"parse", "hydrogens", "hbonds", "turns", "helices",
+	"bridges", "bulges", "sheets", "output"
+};
+
+//
+// Constructor for StageTimes (nothing timed yet) for the given model
+// (a number for the trace, 0 if none)
+//
+StageTimes::StageTimes(int model)
+{
+	for (int s = 0; s < T_COUNT; s++)
+		time_[s] = 0;
+	runs_ = 0;
+	last_ = 0;
+	model_ = model;
+	for (int s = 0; s < T_COUNT; s++) {
+		bytes_[s] = allocations_[s] = 0;
+		rssGrowth_[s] = 0;
+	}
+	lastBytes_ = lastAllocations_ = 0;
+	lastRss_ = 0;
+	for (int s = 0; s < T_COUNT; s++)
+		for (int e = 0; e < HC_COUNT; e++)
+			events_[s][e] = 0;
+	for (int e = 0; e < HC_COUNT; e++)
+		lastEvents_[e] = -1;
+	pairs_ = 0;
+	for (int s = 0; s < T_COUNT; s++)
+		unobserved_[s] = 0;
+	lapped_ = 0;
+}
+
+//
+// Record the time charged to each stage lapped since the last call in
+// the metrics of -X
+//
+void
+StageTimes::observe(void)
+{
+	for (int s = 0; s < T_COUNT; s++) {
+		if (!(lapped_ & (1 << s)))
+			continue;
+		if (Metrics::enabled())
+			Metrics::observeStage(s, unobserved_[s]);
+		unobserved_[s] = 0;
+	}
+	lapped_ = 0;
+}
+
+//
+// Note the memory counts at the start of a stage
+//
+void
+StageTimes::markMemory(void)
+{
+	lastBytes_ = allocatedBytes;
+	lastAllocations_ = allocationCount;
+	lastRss_ = peakRss();
+}
+
+//
+// Charge the memory allocated since the start of a stage to it
+//
+void
+StageTimes::chargeMemory(int stage)
+{
+	bytes_[stage] += allocatedBytes - lastBytes_;
+	allocations_[stage] += allocationCount - lastAllocations_;
+	long rss = peakRss();
+	rssGrowth_[stage] += rss - lastRss_;
+	markMemory();
+}
+
+//
+// Note the hardware event counts at the start of a stage
+//
+void
+StageTimes::markEvents(void)
+{
+	HardwareCounters::read(lastEvents_);
+}
+
+//
+// Charge the hardware events counted since the start of a stage to it
+//
+void
+StageTimes::chargeEvents(int stage)
+{
+	long long value[HC_COUNT];
+	HardwareCounters::read(value);
+	for (int e = 0; e < HC_COUNT; e++) {
+		if (value[e] >= 0 && lastEvents_[e] >= 0
+		&& value[e] > lastEvents_[e])
+			events_[stage][e] += value[e] - lastEvents_[e];
+		lastEvents_[e] = value[e];
+	}
+}
+
+//
+// Return the peak resident set size of the process in kilobytes
+// (0 if unknown)
+//
+// On Linux, the peak of the process image is read from /proc, as
+// getrusage also counts the peak of the process that ran this
+// program (which a fork and exec from a large process, such as a
+// Python interpreter, would otherwise report).
+//
+long
+StageTimes::peakRss(void)
+{
+#ifdef _WIN32
+	return 0;
+#else
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/status", "r");
+	if (f != NULL) {
+		char buf[256];
+		long kb = -1;
+		while (kb < 0 && fgets(buf, sizeof buf, f) != NULL)
+			if (sscanf(buf, "VmHWM: %ld", &kb) != 1)
+				kb = -1;
+		(void) fclose(f);
+		if (kb >= 0)
+			return kb;
+	}
+#endif
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) < 0)
+		return 0;
+#ifdef __APPLE__
+	return ru.ru_maxrss / 1024;	// bytes
+#else
+	return ru.ru_maxrss;
+#endif
+#endif
+}
+
+//
+// Add the times of another model (or copy of this one)
+//
+void
+StageTimes::add(const StageTimes &t)
+{
+	for (int s = 0; s < T_COUNT; s++) {
+		time_[s] += t.time_[s];
+		bytes_[s] += t.bytes_[s];
+		allocations_[s] += t.allocations_[s];
+		rssGrowth_[s] += t.rssGrowth_[s];
+		for (int e = 0; e < HC_COUNT; e++)
+			events_[s][e] += t.events_[s][e];
+	}
+	runs_ += t.runs_;
+	pairs_ += t.pairs_;
+}
+
+//
+// Return the time spent in all stages
+//
+double
+StageTimes::total(void) const
+{
+	double t = 0;
+	for (int s = 0; s < T_COUNT; s++)
+		t += time_[s];
+	return t;
+}
+
+//
+// Return the time in seconds from an arbitrary start, on a clock
+// that is not affected by changes to the time of day
+//
+double
+StageTimes::now(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, frequency;
+	(void) QueryPerformanceCounter(&count);
+	(void) QueryPerformanceFrequency(&frequency);
+	return (double) count.QuadPart / frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+	struct timeval tv;
+	(void) gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+const char *
+StageTimes::stageName(int stage)
+{
+	return StageName[stage];
+}
+
+//
+// Print the times of each model, and their sum, in milliseconds
+//
+void
+StageTimes::printTable(FILE *output, List<Model> &modelList)
+{
+	int s;
+	(void) fprintf(output, "%5s %8s %6s", "model", "residues", "runs");
+	for (s = 0; s < T_COUNT; s++)
+		(void) fprintf(output, " %9s", StageName[s]);
+	(void) fprintf(output, " %9s\n", "total");
+
+	StageTimes sum;
+	int residues = 0;
+	int n = 0;
+	for (Pix p = modelList.first(); p != 0; modelList.next(p)) {
+		const Model *m = modelList(p);
+		const StageTimes *t = m->times();
+		if (t == NULL)
+			continue;
+		sum.add(*t);
+		residues += m->residueCount();
+		(void) fprintf(output, "%5d %8d %6d", ++n,
+					m->residueCount(), t->runs());
+		for (s = 0; s < T_COUNT; s++)
+			(void) fprintf(output, " %9.3f", t->time(s) * 1e3);
+		(void) fprintf(output, " %9.3f\n", t->total() * 1e3);
+	}
+	(void) fprintf(output, "%5s %8d %6d", "all", residues, sum.runs());
+	for (s = 0; s < T_COUNT; s++)
+		(void) fprintf(output, " %9.3f", sum.time(s) * 1e3);
+	(void) fprintf(output, " %9.3f\n", sum.total() * 1e3);
+	(void) fprintf(output, "(times in milliseconds)\n");
+}
+
+//
+// Print the memory allocated by each model in each stage (in
+// kilobytes, then as the number of allocations), and in all; then
+// how much each stage raised the peak resident set size, and the peak
+//
+void
+StageTimes::printMemoryTable(FILE *output, List<Model> &modelList)
+{
+	int s;
+	(void) fprintf(output, "%5s %8s %6s", "model", "residues", "");
+	for (s = 0; s < T_COUNT; s++)
+		(void) fprintf(output, " %9s", StageName[s]);
+	(void) fprintf(output, " %9s\n", "total");
+
+	StageTimes sum;
+	int residues = 0;
+	int n = 0;
+	for (Pix p = modelList.first(); p != 0; modelList.next(p)) {
+		const Model *m = modelList(p);
+		const StageTimes *t = m->times();
+		if (t == NULL)
+			continue;
+		sum.add(*t);
+		residues += m->residueCount();
+		long long total = 0;
+		(void) fprintf(output, "%5d %8d %6s", ++n,
+					m->residueCount(), "KB");
+		for (s = 0; s < T_COUNT; s++) {
+			(void) fprintf(output, " %9lld", t->bytes(s) / 1024);
+			total += t->bytes(s);
+		}
+		(void) fprintf(output, " %9lld\n", total / 1024);
+		total = 0;
+		(void) fprintf(output, "%5s %8s %6s", "", "", "allocs");
+		for (s = 0; s < T_COUNT; s++) {
+			(void) fprintf(output, " %9lld", t->allocations(s));
+			total += t->allocations(s);
+		}
+		(void) fprintf(output, " %9lld\n", total);
+	}
+	long long bytes = 0, allocations = 0;
+	long growth = 0;
+	(void) fprintf(output, "%5s %8d %6s", "all", residues, "KB");
+	for (s = 0; s < T_COUNT; s++) {
+		(void) fprintf(output, " %9lld", sum.bytes(s) / 1024);
+		bytes += sum.bytes(s);
+	}
+	(void) fprintf(output, " %9lld\n", bytes / 1024);
+	(void) fprintf(output, "%5s %8s %6s", "", "", "allocs");
+	for (s = 0; s < T_COUNT; s++) {
+		(void) fprintf(output, " %9lld", sum.allocations(s));
+		allocations += sum.allocations(s);
+	}
+	(void) fprintf(output, " %9lld\n", allocations);
+	(void) fprintf(output, "%5s %8s %6s", "", "", "RSS KB");
+	for (s = 0; s < T_COUNT; s++) {
+		(void) fprintf(output, " %9ld", sum.rssGrowth(s));
+		growth += sum.rssGrowth(s);
+	}
+	(void) fprintf(output, " %9ld\n", growth);
+	(void) fprintf(output, "(RSS KB is the growth of the peak resident "
+		"set size; peak %ld KB)\n", peakRss());
+}
+
+//
+// Print the start of a row of the event table: the model and its
+// residues on the first row, then only the label
+//
+static void
+printRowStart(FILE *output, int row, const char *model, int residues,
+							const char *label)
+{
+	if (row == 0)
+		(void) fprintf(output, "%5s %8d %6s", model, residues, label);
+	else
+		(void) fprintf(output, "%5s %8s %6s", "", "", label);
+}
+
+static double
+ratio(long long n, long long d)
+{
+	return d > 0 ? (double) n / d : 0.0;
+}
+
+//
+// Print the rows of the event table for one model (or all of them)
+//
+static void
+printEventRows(FILE *output, const StageTimes &t, const char *model,
+							int residues)
+{
+	static const char *label[HC_COUNT] = {
+		"Mcyc", "Minsn", "Kllc", "Kbr"
+	};
+	static const double scale[HC_COUNT] = { 1e-6, 1e-6, 1e-3, 1e-3 };
+	long long total[HC_COUNT];
+	int row = 0;
+	int s, e;
+	for (e = 0; e < HC_COUNT; e++) {
+		total[e] = 0;
+		for (s = 0; s < T_COUNT; s++)
+			total[e] += t.events(s, e);
+		if (!HardwareCounters::available(e))
+			continue;
+		printRowStart(output, row++, model, residues, label[e]);
+		for (s = 0; s < T_COUNT; s++)
+			(void) fprintf(output, " %9.3f",
+						t.events(s, e) * scale[e]);
+		(void) fprintf(output, " %9.3f\n", total[e] * scale[e]);
+	}
+	if (!HardwareCounters::available(HC_CYCLES)
+	|| !HardwareCounters::available(HC_INSTRUCTIONS))
+		return;
+	printRowStart(output, row, model, residues, "IPC");
+	for (s = 0; s < T_COUNT; s++)
+		(void) fprintf(output, " %9.2f",
+				ratio(t.events(s, HC_INSTRUCTIONS),
+				t.events(s, HC_CYCLES)));
+	(void) fprintf(output, " %9.2f\n",
+			ratio(total[HC_INSTRUCTIONS], total[HC_CYCLES]));
+}
+
+//
+// Print the hardware events counted for each model in each stage,
+// and in all (cycles and instructions in millions, cache and branch
+// misses in thousands); then the events per residue pair examined
+// for hydrogen bonds
+//
+void
+StageTimes::printEventTable(FILE *output, List<Model> &modelList)
+{
+	int s;
+	(void) fprintf(output, "%5s %8s %6s", "model", "residues", "");
+	for (s = 0; s < T_COUNT; s++)
+		(void) fprintf(output, " %9s", StageName[s]);
+	(void) fprintf(output, " %9s\n", "total");
+
+	StageTimes sum;
+	int residues = 0;
+	int n = 0;
+	char model[16];
+	for (Pix p = modelList.first(); p != 0; modelList.next(p)) {
+		const Model *m = modelList(p);
+		const StageTimes *t = m->times();
+		if (t == NULL)
+			continue;
+		sum.add(*t);
+		residues += m->residueCount();
+		(void) sprintf(model, "%d", ++n);
+		printEventRows(output, *t, model, m->residueCount());
+	}
+	printEventRows(output, sum, "all", residues);
+	(void) fprintf(output, "(Mcyc, Minsn: millions of cycles and "
+		"instructions; Kllc, Kbr: thousands of\n last level cache "
+		"and branch misses; IPC: instructions per cycle)\n");
+	if (sum.pairs() == 0)
+		return;
+	(void) fprintf(output, "per residue pair examined for hydrogen "
+					"bonds (%ld pairs):\n ", sum.pairs());
+	const char *sep = "";
+	for (int e = 0; e < HC_COUNT; e++)
+		if (HardwareCounters::available(e)) {
+			(void) fprintf(output, "%s %s %.2f", sep,
+				HardwareCounters::eventName(e),
+				ratio(sum.events(T_HBONDS, e), sum.pairs()));
+			sep = ",";
+		}
+	(void) fprintf(output, "\n");
+}
+
+//
+// Print the hardware events counted in each stage as JSON members
+//
+static void
+printEvents(FILE *output, const StageTimes &t)
+{
+	(void) fprintf(output, ", \"pairs\": %ld, \"events\": {", t.pairs());
+	int n = 0;
+	for (int e = 0; e < HC_COUNT; e++) {
+		if (!HardwareCounters::available(e))
+			continue;
+		(void) fprintf(output, "%s\"%s\": {", n++ > 0 ? ", " : "",
+					HardwareCounters::eventName(e));
+		for (int s = 0; s < T_COUNT; s++)
+			(void) fprintf(output, "%s\"%s\": %lld",
+				s > 0 ? ", " : "", StageTimes::stageName(s),
+				t.events(s, e));
+		(void) fprintf(output, "}");
+	}
+	(void) fprintf(output, "}");
+}
+
+//
+// Print the stage times (and event and memory counts, if kept) as
+// JSON members
+//
+static void
+printStages(FILE *output, const StageTimes &t)
+{
+	(void) fprintf(output, "\"runs\": %d, \"seconds\": {", t.runs());
+	for (int s = 0; s < T_COUNT; s++)
+		(void) fprintf(output, "\"%s\": %.9f, ",
+					StageTimes::stageName(s), t.time(s));
+	(void) fprintf(output, "\"total\": %.9f}", t.total());
+	if (StageTimes::countEvents)
+		printEvents(output, t);
+	if (!StageTimes::countMemory)
+		return;
+	(void) fprintf(output, ", \"bytes\": {");
+	int s;
+	for (s = 0; s < T_COUNT; s++)
+		(void) fprintf(output, "%s\"%s\": %lld", s > 0 ? ", " : "",
+				StageTimes::stageName(s), t.bytes(s));
+	(void) fprintf(output, "}, \"allocations\": {");
+	for (s = 0; s < T_COUNT; s++)
+		(void) fprintf(output, "%s\"%s\": %lld", s > 0 ? ", " : "",
+				StageTimes::stageName(s), t.allocations(s));
+	(void) fprintf(output, "}, \"rssGrowthKB\": {");
+	for (s = 0; s < T_COUNT; s++)
+		(void) fprintf(output, "%s\"%s\": %ld", s > 0 ? ", " : "",
+				StageTimes::stageName(s), t.rssGrowth(s));
+	(void) fprintf(output, "}");
+}
+
+//
+// Print the times of each model, and their sum, as a JSON object
+// (times in seconds)
+//
+void
+StageTimes::printJson(FILE *output, List<Model> &modelList)
+{
+	(void) fprintf(output, "{\"models\": [");
+	StageTimes sum;
+	int residues = 0;
+	int n = 0;
+	for (Pix p = modelList.first(); p != 0; modelList.next(p)) {
+		const Model *m = modelList(p);
+		const StageTimes *t = m->times();
+		if (t == NULL)
+			continue;
+		sum.add(*t);
+		residues += m->residueCount();
+		(void) fprintf(output, "%s\n  {\"model\": %d, "
+			"\"modelNumber\": %d, \"residues\": %d, ",
+			n > 0 ? "," : "", n + 1, m->modelNumber(),
+			m->residueCount());
+		printStages(output, *t);
+		(void) fprintf(output, "}");
+		n++;
+	}
+	(void) fprintf(output, "\n],\n\"all\": {\"models\": %d, "
+				"\"residues\": %d, ", n, residues);
+	printStages(output, sum);
+	if (countMemory)
+		(void) fprintf(output, ", \"peakRssKB\": %ld", peakRss());
+	(void) fprintf(output, "}}\n");
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef timings_h
+#define timings_h
+
+#include <stdio.h>
+#include "ksdssp.h"
+#include "Counters.h"
+#include "Metrics.h"
+#include "List.h"
+#include "Trace.h"
+
+class Model;
+
+//
+// Stages of the work done for a model, timed with -p and -P
+//
+#define	T_PARSE		0	// reading the model (Model::Model)
+#define	T_HYDROGENS	1	// placing imide hydrogens
+#define	T_HBONDS	2	// finding hydrogen bonds (and copy contacts)
+#define	T_TURNS		3	// turn and helix flags
+#define	T_HELICES	4	// helices from the flags
+#define	T_BRIDGES	5	// bridges and ladders
+#define	T_BULGES	6	// merging ladders across beta bulges
+#define	T_SHEETS	7	// sheets from the ladders
+#define	T_OUTPUT	8	// printing records and summaries
+#define	T_COUNT		9
+
+//
+// Time spent in each stage for one model (summed over the frames of
+// a trajectory), measured with a monotonic clock.  Each call to lap
+// charges the time since the last start or lap to a stage (and
+// records it as a span if tracing).  The time charged to each stage
+// since the last call to observe is recorded in the metrics of -X by
+// observe, so that they count each stage once per model.
+//
+// With -u, lap also charges the memory allocated with operator new
+// by the calling thread (counted by the hook in Allocations.cpp,
+// which only the ksdssp program links in) and the growth of the
+// peak resident set size of the process.  With -H, it charges the
+// hardware events counted on the calling thread.
+//
+class StageTimes {
+	double		time_[T_COUNT];
+	int		runs_;
+	double		last_;
+	int		model_;
+	long long	bytes_[T_COUNT];
+	long long	allocations_[T_COUNT];
+	long		rssGrowth_[T_COUNT];
+	long long	lastBytes_;
+	long long	lastAllocations_;
+	long		lastRss_;
+	long long	events_[T_COUNT][HC_COUNT];
+	long long	lastEvents_[HC_COUNT];
+	long		pairs_;
+	double		unobserved_[T_COUNT];
+	int		lapped_;	// stages lapped since observe
+	void		markMemory(void);
+	void		chargeMemory(int stage);
+	void		markEvents(void);
+	void		chargeEvents(int stage);
+public:
+			StageTimes(int model = 0);
+	void		start(void)
+			{
+				last_ = now();
+				if (countMemory)
+					markMemory();
+				if (countEvents)
+					markEvents();
+			}
+	void		lap(int stage)
+			{
+				double t = now();
+				time_[stage] += t - last_;
+				unobserved_[stage] += t - last_;
+				lapped_ |= 1 << stage;
+				if (Trace::enabled())
+					Trace::span(stageName(stage), "stage",
+							last_, t, model_);
+				last_ = t;
+				if (countEvents)
+					chargeEvents(stage);
+				if (countMemory)
+					chargeMemory(stage);
+			}
+	int		model(void) const { return model_; }
+	void		observe(void);
+	void		countRun(void) { runs_++; }
+	void		countPairs(long n) { pairs_ += n; }
+	void		add(const StageTimes &t);
+	double		time(int stage) const { return time_[stage]; }
+	double		total(void) const;
+	long long	bytes(int stage) const { return bytes_[stage]; }
+	long long	allocations(int stage) const
+				{ return allocations_[stage]; }
+	long		rssGrowth(int stage) const
+				{ return rssGrowth_[stage]; }
+	long long	events(int stage, int event) const
+				{ return events_[stage][event]; }
+	long		pairs(void) const { return pairs_; }
+	int		runs(void) const { return runs_; }
+	static int	countMemory;
+	static int	countEvents;
+	static THREAD_LOCAL long long
+			allocatedBytes;
+	static THREAD_LOCAL long long
+			allocationCount;
+	static double	now(void);
+	static long	peakRss(void);
+	static const char
+			*stageName(int stage);
+	static void	printTable(FILE *output, List<Model> &modelList);
+	static void	printMemoryTable(FILE *output,
+						List<Model> &modelList);
+	static void	printEventTable(FILE *output,
+						List<Model> &modelList);
+	static void	printJson(FILE *output, List<Model> &modelList);
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "Topology.h"
+
+//
+// Constructor for Topology (empty, filled in while reading)
+//
+Topology::Topology(void)
+{
+	refCount_ = 1;
+	count_ = 0;
+	size_ = 0;
+	residue_ = NULL;
+	flags_ = NULL;
+	atoms_ = NULL;
+	atomIndex_ = NULL;
+	atomCount_ = 0;
+	complete_ = 0;
+	segmentCount_ = 0;
+	segmentStart_ = NULL;
+}
+
+//
+// Copy constructor for Topology (unshared, for a model that is
+// about to add residues)
+//
+Topology::Topology(const Topology &t)
+{
+	refCount_ = 1;
+	count_ = t.count_;
+	size_ = t.count_;
+	residue_ = new PDB::Residue[size_];
+	flags_ = new int[size_];
+	atoms_ = new int[size_];
+	atomIndex_ = new int[size_][A_COUNT];
+	for (int i = 0; i < count_; i++) {
+		residue_[i] = t.residue_[i];
+		flags_[i] = t.flags_[i];
+		atoms_[i] = t.atoms_[i];
+		for (int k = 0; k < A_COUNT; k++)
+			atomIndex_[i][k] = t.atomIndex_[i][k];
+	}
+	atomCount_ = t.atomCount_;
+	complete_ = 0;
+	segmentCount_ = 0;
+	segmentStart_ = NULL;
+}
+
+//
+// Destructor for Topology
+//
+Topology::~Topology(void)
+{
+	delete [] residue_;
+	delete [] flags_;
+	delete [] atoms_;
+	delete [] atomIndex_;
+	delete [] segmentStart_;
+}
+
+//
+// Release a reference (and the topology when no model uses it)
+//
+void
+Topology::unref(void)
+{
+	if (--refCount_ <= 0)
+		delete this;
+}
+
+//
+// Check if two PDB residues are the same
+//
+static int
+sameResidue(const PDB::Residue &r1, const PDB::Residue &r2)
+{
+	if (r1.seqNum != r2.seqNum)
+		return 0;
+	if (r1.chainId != r2.chainId)
+		return 0;
+	if (r1.insertCode != r2.insertCode)
+		return 0;
+	if (strncmp(r1.name, r2.name, sizeof (PDB::RName)) != 0)
+		return 0;
+	return 1;
+}
+
+//
+// Check if a PDB residue is the same as the last one added
+//
+int
+Topology::sameAsLast(const PDB::Residue &r) const
+{
+	return count_ > 0 && sameResidue(r, residue_[count_ - 1]);
+}
+
+//
+// Add a residue (with no backbone atoms yet)
+//
+void
+Topology::addResidue(const PDB::Residue &r)
+{
+	if (count_ == size_) {
+		size_ = size_ == 0 ? 256 : size_ * 2;
+		PDB::Residue *residue = new PDB::Residue[size_];
+		int *flags = new int[size_];
+		int *atoms = new int[size_];
+		int (*atomIndex)[A_COUNT] = new int[size_][A_COUNT];
+		for (int i = 0; i < count_; i++) {
+			residue[i] = residue_[i];
+			flags[i] = flags_[i];
+			atoms[i] = atoms_[i];
+			for (int k = 0; k < A_COUNT; k++)
+				atomIndex[i][k] = atomIndex_[i][k];
+		}
+		delete [] residue_;
+		delete [] flags_;
+		delete [] atoms_;
+		delete [] atomIndex_;
+		residue_ = residue;
+		flags_ = flags;
+		atoms_ = atoms;
+		atomIndex_ = atomIndex;
+	}
+	residue_[count_] = r;
+	flags_[count_] = 0;
+	atoms_[count_] = 0;
+	for (int k = 0; k < A_COUNT; k++)
+		atomIndex_[count_][k] = -1;
+	count_++;
+	complete_ = 0;
+}
+
+//
+// Add a backbone atom to the last residue, given its index in the file
+//
+void
+Topology::addAtom(int slot, int index)
+{
+	atoms_[count_ - 1] |= 1 << slot;
+	atomIndex_[count_ - 1][slot] = index;
+	if (index >= atomCount_)
+		atomCount_ = index + 1;
+}
+
+//
+// Finish reading: split residues into segments (at TER or
+// chain identifier changes)
+//
+void
+Topology::complete(void)
+{
+	delete [] segmentStart_;
+	segmentStart_ = new int[count_ + 1];
+	segmentCount_ = 0;
+	for (int i = 0; i < count_; i++)
+		if (i == 0 || (flags_[i - 1] & R_TER)
+		|| residue_[i - 1].chainId != residue_[i].chainId)
+			segmentStart_[segmentCount_++] = i;
+	segmentStart_[segmentCount_] = count_;
+	complete_ = 1;
+}
+
+//
+// Check if two topologies are identical
+//
+int
+Topology::sameAs(const Topology *t) const
+{
+	if (t->count_ != count_)
+		return 0;
+	for (int i = 0; i < count_; i++)
+		if (!sameResidue(t->residue_[i], residue_[i])
+		||  t->flags_[i] != flags_[i] || t->atoms_[i] != atoms_[i]
+		||  memcmp(t->atomIndex_[i], atomIndex_[i],
+						sizeof atomIndex_[i]) != 0)
+			return 0;
+	return 1;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef topology_h
+#define topology_h
+
+#include <pdb++.h>
+#include "Residue.h"
+
+//
+// Residue identity, chain breaks and backbone atoms present for a
+// model, with the index of each backbone atom among the atoms of its
+// file (used to find its coordinates in trajectory frames).  Models
+// read with identical topology (e.g., the models of an NMR ensemble)
+// share one Topology, which is not changed while shared; a model
+// that grows residue by residue works on a copy of its own.
+//
+class Topology {
+	int		refCount_;
+	int		count_, size_;
+	PDB::Residue	*residue_;
+	int		*flags_;
+	int		*atoms_;
+	int		(*atomIndex_)[A_COUNT];
+	int		atomCount_;
+	int		complete_;
+	int		segmentCount_;
+	int		*segmentStart_;
+public:
+			Topology(void);
+			Topology(const Topology &t);
+			~Topology(void);
+	void		ref(void) { refCount_++; }
+	void		unref(void);
+	int		shared(void) const { return refCount_ > 1; }
+	int		count(void) const { return count_; }
+	const PDB::Residue &
+			residue(int n) const { return residue_[n]; }
+	int		flags(int n) const { return flags_[n]; }
+	int		atoms(int n) const { return atoms_[n]; }
+	int		atomIndex(int n, int slot) const
+				{ return atomIndex_[n][slot]; }
+	int		atomCount(void) const { return atomCount_; }
+	int		segmentCount(void) const { return segmentCount_; }
+	int		segmentStart(int s) const { return segmentStart_[s]; }
+	int		segmentEnd(int s) const
+				{ return segmentStart_[s + 1] - 1; }
+	int		sameAsLast(const PDB::Residue &r) const;
+	void		addResidue(const PDB::Residue &r);
+	void		addAtom(int slot, int index);
+	void		setFlag(int f)
+				{ flags_[count_ - 1] |= f; complete_ = 0; }
+	void		complete(void);
+	int		isComplete(void) const { return complete_; }
+	int		sameAs(const Topology *t) const;
+};
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "Trace.h"
+#include "Timings.h"
+#ifndef NO_THREADS
+#include <pthread.h>
+#endif
+
+//
+// Recorded span (or thread name, if category is NULL); names and
+// categories are static strings
+//
+struct TraceEvent {
+	const char	*name;
+	const char	*category;
+	double		start, end;
+	int		thread;
+	int		model;
+	int		frame;
+};
+
+int			Trace::enabled_ = 0;
+static double		traceStart;
+static TraceEvent	*events = NULL;
+static int		eventCount = 0;
+static int		eventSize = 0;
+#ifndef NO_THREADS
+static pthread_mutex_t	traceLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t	*threads = NULL;
+static int		threadCount = 0;
+#endif
+
+//
+// Start recording spans
+//
+void
+Trace::enable(void)
+{
+	traceStart = StageTimes::now();
+	enabled_ = 1;
+}
+
+//
+// Return the time for the start or end of a span (see StageTimes::now),
+// or 0 if not tracing
+//
+double
+Trace::now(void)
+{
+	return enabled_ ? StageTimes::now() : 0;
+}
+
+//
+// Return the number of the calling thread (with traceLock held)
+//
+static int
+threadNumber(void)
+{
+#ifndef NO_THREADS
+	pthread_t self = pthread_self();
+	for (int i = 0; i < threadCount; i++)
+		if (pthread_equal(threads[i], self))
+			return i + 1;
+	pthread_t *t = new pthread_t[threadCount + 1];
+	for (int i = 0; i < threadCount; i++)
+		t[i] = threads[i];
+	t[threadCount++] = self;
+	delete [] threads;
+	threads = t;
+	return threadCount;
+#else
+	return 1;
+#endif
+}
+
+//
+// Add an event to the trace
+//
+static void
+addEvent(const char *name, const char *category, double start,
+					double end, int model, int frame)
+{
+#ifndef NO_THREADS
+	(void) pthread_mutex_lock(&traceLock);
+#endif
+	if (eventCount == eventSize) {
+		eventSize = eventSize == 0 ? 1024 : eventSize * 2;
+		TraceEvent *e = new TraceEvent[eventSize];
+		if (eventCount > 0)
+			(void) memcpy(e, events, eventCount * sizeof e[0]);
+		delete [] events;
+		events = e;
+	}
+	TraceEvent &e = events[eventCount++];
+	e.name = name;
+	e.category = category;
+	e.start = start;
+	e.end = end;
+	e.thread = threadNumber();
+	e.model = model;
+	e.frame = frame;
+#ifndef NO_THREADS
+	(void) pthread_mutex_unlock(&traceLock);
+#endif
+}
+
+//
+// Record a span of work (times from StageTimes::now); model and frame
+// are omitted if 0
+//
+void
+Trace::span(const char *name, const char *category, double start,
+					double end, int model, int frame)
+{
+	if (enabled_)
+		addEvent(name, category, start, end, model, frame);
+}
+
+//
+// Name the calling thread in the trace
+//
+void
+Trace::nameThread(const char *name)
+{
+	if (enabled_)
+		addEvent(name, NULL, 0, 0, 0, 0);
+}
+
+//
+// Write the trace as a JSON object
+// Returns 0 on success and -1 on a write error
+//
+int
+Trace::write(FILE *output)
+{
+	(void) fprintf(output, "{\"displayTimeUnit\": \"ms\", "
+						"\"traceEvents\": [");
+	for (int i = 0; i < eventCount; i++) {
+		const TraceEvent &e = events[i];
+		(void) fprintf(output, "%s\n", i > 0 ? "," : "");
+		if (e.category == NULL) {
+			(void) fprintf(output, "{\"name\": \"thread_name\", "
+				"\"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+				"\"args\": {\"name\": \"%s\"}}",
+				e.thread, e.name);
+			continue;
+		}
+		(void) fprintf(output, "{\"name\": \"%s\", \"cat\": \"%s\", "
+			"\"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+			"\"pid\": 1, \"tid\": %d, \"args\": {",
+			e.name, e.category, (e.start - traceStart) * 1e6,
+			(e.end - e.start) * 1e6, e.thread);
+		if (e.model > 0)
+			(void) fprintf(output, "\"model\": %d%s", e.model,
+						e.frame > 0 ? ", " : "");
+		if (e.frame > 0)
+			(void) fprintf(output, "\"frame\": %d", e.frame);
+		(void) fprintf(output, "}}");
+	}
+	(void) fprintf(output, "\n]}\n");
+	return ferror(output) ? -1 : 0;
+}
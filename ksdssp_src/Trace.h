@@ -29,56 +29,32 @@
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef squarearray_h
-#define squarearray_h
-
-#include <string.h>
-
-template <class T>
-class SquareArray
-{
-	int		dim_;
-	T		*array_;
+#ifndef trace_h
+#define trace_h
+
+#include "ksdssp.h"
+#include <stdio.h>
+
+//
+// Spans of work recorded for -r, written in the Chrome Trace Event
+// format (complete events, with times in microseconds from the start
+// of the trace), which trace viewers such as Perfetto and
+// chrome://tracing open directly.  Spans are tagged with a small
+// number for the thread that recorded them, and optionally with the
+// model (numbered from 1 in the order read) and trajectory frame.
+// Recording is thread safe.
+//
+class Trace {
+	static int	enabled_;
 public:
-			SquareArray(int size);
-			~SquareArray(void);
-	void		zero(void);
-	int		dimension(void) const;
-	T		&operator()(int row, int col);
+	static void	enable(void);
+	static int	enabled(void) { return enabled_; }
+	static double	now(void);
+	static void	span(const char *name, const char *category,
+				double start, double end, int model = 0,
+				int frame = 0);
+	static void	nameThread(const char *name);
+	static int	write(FILE *output);
 };
 
-template <class T>
-SquareArray<T>::SquareArray(int size)
-{
-	dim_ = size;
-	array_ = new T[dim_ * dim_];
-}
-
-template <class T>
-SquareArray<T>::~SquareArray(void)
-{
-	delete[] array_;
-}
-
-template <class T>
-int
-SquareArray<T>::dimension(void) const
-{
-	return dim_;
-}
-
-template <class T>
-void
-SquareArray<T>::zero(void)
-{
-	memset(array_, 0, dim_ * dim_ * sizeof (T));
-}
-
-template <class T>
-T &
-SquareArray<T>::operator()(int row, int col)
-{
-	return array_[row * dim_ + col];
-}
-
 #endif
@@ -0,0 +1,824 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "Trajectory.h"
+
+//
+// Reverse the byte order of a 4-byte quantity
+//
+static void
+swap4(void *v)
+{
+	char *b = (char *) v;
+	char t = b[0];
+	b[0] = b[3];
+	b[3] = t;
+	t = b[1];
+	b[1] = b[2];
+	b[2] = t;
+}
+
+//
+// Constructor for Trajectory (no atoms until the header is read)
+//
+Trajectory::Trajectory(void)
+	: error_()
+{
+	atomCount_ = 0;
+	needed_ = -1;
+	xyz_ = NULL;
+	frame_ = 0;
+	first_ = 1;
+	last_ = 0;
+	stride_ = 1;
+}
+
+//
+// Destructor for Trajectory
+//
+Trajectory::~Trajectory(void)
+{
+	delete [] xyz_;
+}
+
+//
+// Set the number of atoms in each frame
+//
+void
+Trajectory::setAtomCount(int n)
+{
+	delete [] xyz_;
+	atomCount_ = n;
+	xyz_ = new float[n][3];
+	memset(xyz_, 0, n * sizeof xyz_[0]);
+}
+
+//
+// Number of leading atoms to decode in each frame
+//
+int
+Trajectory::neededCount(void) const
+{
+	if (needed_ < 0 || needed_ > atomCount_)
+		return atomCount_;
+	return needed_;
+}
+
+//
+// Select the frames returned by nextFrame
+//
+void
+Trajectory::setFrames(int first, int last, int stride)
+{
+	first_ = first < 1 ? 1 : first;
+	last_ = last;
+	stride_ = stride < 1 ? 1 : stride;
+}
+
+//
+// Advance to the next selected frame
+// Return 1 if a frame was read, 0 at end of file (or past the last
+// selected frame) and -1 on error
+//
+int
+Trajectory::nextFrame(void)
+{
+	if (!okay())
+		return -1;
+	for (;;) {
+		int n = frame_ + 1;
+		if (last_ > 0 && n > last_)
+			return 0;
+		int wanted = n >= first_ && (n - first_) % stride_ == 0;
+		int status = wanted ? readFrame() : skipFrame();
+		if (status <= 0)
+			return status;
+		frame_ = n;
+		if (wanted)
+			return 1;
+	}
+}
+
+//
+// Open a trajectory, recognizing its format from the first bytes
+// (XTC files start with a big-endian magic number, DCD files with
+// the length of their first record)
+//
+Trajectory *
+Trajectory::open(FILE *input)
+{
+	unsigned char magic[4];
+	if (fread(magic, 1, sizeof magic, input) == sizeof magic
+	&&  magic[0] == 0 && magic[1] == 0 && magic[2] == 0x07
+	&&  magic[3] == 0xcb) {
+		(void) fseek(input, 0, SEEK_SET);
+		return new XtcTrajectory(input);
+	}
+	(void) fseek(input, 0, SEEK_SET);
+	return new DcdTrajectory(input);
+}
+
+//
+// Constructor for DcdTrajectory (read header records)
+//
+// DCD files are Fortran unformatted files: each record is bracketed
+// by its length in bytes.  The first record is 84 bytes long, which
+// also tells us the byte order of the file.  Frames follow the header
+// records and consist of an optional unit cell record, then records
+// for X, Y and Z (and an optional fourth dimension).  If some atoms
+// are fixed, only the first frame has all atoms and later frames
+// only have the free atoms.
+//
+DcdTrajectory::DcdTrajectory(FILE *input)
+	: Trajectory()
+{
+	input_ = input;
+	swap_ = 0;
+	charmm_ = 0;
+	unitCell_ = 0;
+	fourDims_ = 0;
+	freeCount_ = 0;
+	freeIndex_ = NULL;
+	record_ = NULL;
+	recordSize_ = 0;
+
+	int length;
+	if (fread(&length, sizeof length, 1, input_) != 1) {
+		error_ = "not a DCD file";
+		return;
+	}
+	if (length != 84) {
+		swap4(&length);
+		swap_ = 1;
+	}
+	if (length != 84 || fseek(input_, 0, SEEK_SET) != 0) {
+		error_ = "not a DCD file";
+		return;
+	}
+	if (readRecord() != 84 || strncmp(record_, "CORD", 4) != 0) {
+		error_ = "not a DCD file";
+		return;
+	}
+	int icntrl[20];
+	memcpy(icntrl, record_ + 4, sizeof icntrl);
+	if (swap_)
+		for (int i = 0; i < 20; i++)
+			swap4(&icntrl[i]);
+	int fixedCount = icntrl[8];
+	charmm_ = icntrl[19] != 0;
+	if (charmm_) {
+		unitCell_ = icntrl[10] != 0;
+		fourDims_ = icntrl[11] != 0;
+	}
+
+	if (readRecord() < 0) {		// Title
+		error_ = "truncated DCD header";
+		return;
+	}
+	int n;
+	if (readInt(&n) < 0 || n <= 0) {
+		error_ = "bad atom count in DCD header";
+		return;
+	}
+	setAtomCount(n);
+	freeCount_ = n;
+	if (fixedCount > 0) {
+		freeCount_ = n - fixedCount;
+		if (freeCount_ < 0
+		||  readRecord() != freeCount_ * (int) sizeof (int)) {
+			error_ = "bad free atom list in DCD header";
+			return;
+		}
+		freeIndex_ = new int[freeCount_];
+		memcpy(freeIndex_, record_, freeCount_ * sizeof (int));
+		for (int i = 0; i < freeCount_; i++) {
+			if (swap_)
+				swap4(&freeIndex_[i]);
+			freeIndex_[i]--;	// One-based in file
+			if (freeIndex_[i] < 0 || freeIndex_[i] >= n) {
+				error_ = "bad free atom list in DCD header";
+				return;
+			}
+		}
+	}
+}
+
+//
+// Destructor for DcdTrajectory
+//
+DcdTrajectory::~DcdTrajectory(void)
+{
+	delete [] freeIndex_;
+	delete [] record_;
+}
+
+//
+// Read the next record into the record buffer
+// Return its length, or -1 at end of file or on a malformed record
+//
+int
+DcdTrajectory::readRecord(void)
+{
+	int length, trailer;
+	if (fread(&length, sizeof length, 1, input_) != 1)
+		return -1;
+	if (swap_)
+		swap4(&length);
+	if (length < 0)
+		return -1;
+	if (length > recordSize_) {
+		delete [] record_;
+		recordSize_ = length;
+		record_ = new char[recordSize_];
+	}
+	if (fread(record_, 1, length, input_) != (size_t) length
+	||  fread(&trailer, sizeof trailer, 1, input_) != 1)
+		return -1;
+	if (swap_)
+		swap4(&trailer);
+	if (trailer != length)
+		return -1;
+	return length;
+}
+
+//
+// Skip the next record
+// Return its length, or -1 at end of file or on a malformed record
+//
+int
+DcdTrajectory::skipRecord(void)
+{
+	int length, trailer;
+	if (fread(&length, sizeof length, 1, input_) != 1)
+		return -1;
+	if (swap_)
+		swap4(&length);
+	if (length < 0 || fseek(input_, length, SEEK_CUR) != 0
+	||  fread(&trailer, sizeof trailer, 1, input_) != 1)
+		return -1;
+	if (swap_)
+		swap4(&trailer);
+	if (trailer != length)
+		return -1;
+	return length;
+}
+
+//
+// Read a record holding a single integer
+//
+int
+DcdTrajectory::readInt(int *value)
+{
+	if (readRecord() != sizeof (int))
+		return -1;
+	memcpy(value, record_, sizeof (int));
+	if (swap_)
+		swap4(value);
+	return 0;
+}
+
+//
+// Read one coordinate record (count atoms, dimension d)
+//
+int
+DcdTrajectory::readCoords(int count, int d)
+{
+	if (readRecord() != count * (int) sizeof (float))
+		return -1;
+	int needed = neededCount();
+	const char *p = record_;
+	for (int i = 0; i < count; i++, p += sizeof (float)) {
+		int n = count == atomCount_ ? i : freeIndex_[i];
+		if (n >= needed)
+			continue;
+		float v;
+		memcpy(&v, p, sizeof v);
+		if (swap_)
+			swap4(&v);
+		xyz_[n][d] = v;
+	}
+	return 0;
+}
+
+//
+// Read the next frame
+// Return 1 if a frame was read, 0 at end of file and -1 on error
+//
+int
+DcdTrajectory::readFrame(void)
+{
+	int c = getc(input_);
+	if (c == EOF)
+		return 0;
+	(void) ungetc(c, input_);
+	if (unitCell_ && skipRecord() != 48) {
+		error_ = "truncated DCD frame";
+		return -1;
+	}
+	int count = frame_ == 0 ? atomCount_ : freeCount_;
+	for (int d = 0; d < 3; d++)
+		if (readCoords(count, d) < 0) {
+			error_ = "truncated DCD frame";
+			return -1;
+		}
+	if (fourDims_ && skipRecord() < 0) {
+		error_ = "truncated DCD frame";
+		return -1;
+	}
+	return 1;
+}
+
+//
+// Skip the next frame
+// (The first frame is always read when some atoms are fixed, since
+// only it has their coordinates)
+//
+int
+DcdTrajectory::skipFrame(void)
+{
+	if (frame_ == 0 && freeCount_ != atomCount_)
+		return readFrame();
+	int c = getc(input_);
+	if (c == EOF)
+		return 0;
+	(void) ungetc(c, input_);
+	int records = 3 + unitCell_ + fourDims_;
+	for (int i = 0; i < records; i++)
+		if (skipRecord() < 0) {
+			error_ = "truncated DCD frame";
+			return -1;
+		}
+	return 1;
+}
+
+//
+// Read a big-endian (XDR) integer
+//
+static int
+xdrInt(FILE *input, int *value)
+{
+	unsigned char b[4];
+	if (fread(b, 1, sizeof b, input) != sizeof b)
+		return -1;
+	*value = (int) (((unsigned int) b[0] << 24) | (b[1] << 16)
+						| (b[2] << 8) | b[3]);
+	return 0;
+}
+
+//
+// Read a big-endian (XDR) float
+//
+static int
+xdrFloat(FILE *input, float *value)
+{
+	int i;
+	if (xdrInt(input, &i) < 0)
+		return -1;
+	memcpy(value, &i, sizeof i);
+	return 0;
+}
+
+//
+// Integer sizes used for the small differences between
+// successive atoms in xdr3dfcoord (roughly 2^(i/3))
+//
+static const int magicInts[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 10, 12, 16, 20, 25, 32, 40, 50, 64,
+	80, 101, 128, 161, 203, 256, 322, 406, 512, 645, 812, 1024, 1290,
+	1625, 2048, 2580, 3250, 4096, 5060, 6501, 8192, 10321, 13003,
+	16384, 20642, 26007, 32768, 41285, 52015, 65536, 82570, 104031,
+	131072, 165140, 208063, 262144, 330280, 416127, 524287, 660561,
+	832255, 1048576, 1321122, 1664510, 2097152, 2642245, 3329021,
+	4194304, 5284491, 6658042, 8388607, 10568983, 13316085, 16777216
+};
+static const int firstIdx = 9;
+static const int lastIdx = sizeof magicInts / sizeof magicInts[0];
+
+//
+// Number of bits needed to hold values up to size
+//
+static int
+sizeOfInt(int size)
+{
+	unsigned int num = 1;
+	int bits = 0;
+	while ((unsigned int) size >= num && bits < 32) {
+		bits++;
+		num <<= 1;
+	}
+	return bits;
+}
+
+//
+// Number of bits needed to hold the product of three sizes
+//
+static int
+sizeOfInts(const unsigned int sizes[3])
+{
+	unsigned int bytes[32];
+	int byteCount = 1;
+	bytes[0] = 1;
+	for (int i = 0; i < 3; i++) {
+		unsigned int tmp = 0;
+		int n;
+		for (n = 0; n < byteCount; n++) {
+			tmp = bytes[n] * sizes[i] + tmp;
+			bytes[n] = tmp & 0xff;
+			tmp >>= 8;
+		}
+		while (tmp != 0) {
+			bytes[n++] = tmp & 0xff;
+			tmp >>= 8;
+		}
+		byteCount = n;
+	}
+	int bits = 0;
+	unsigned int num = 1;
+	byteCount--;
+	while (bytes[byteCount] >= num) {
+		bits++;
+		num *= 2;
+	}
+	return bits + byteCount * 8;
+}
+
+//
+// Reader for the bit stream of compressed coordinates
+//
+struct BitReader {
+	const unsigned char	*data;
+	int			size;
+	int			count;
+	unsigned int		lastBits, lastByte;
+	int			overrun;
+	int			next(void);
+	int			bits(int n);
+	void			ints(int bits, const unsigned int sizes[3],
+					int nums[3]);
+};
+
+//
+// Next byte of the stream (zero, and flag the error, past its end)
+//
+inline int
+BitReader::next(void)
+{
+	if (count >= size) {
+		overrun = 1;
+		return 0;
+	}
+	return data[count++];
+}
+
+//
+// Read an n-bit unsigned integer
+//
+int
+BitReader::bits(int n)
+{
+	int mask = n < 32 ? (1 << n) - 1 : ~0;
+	int num = 0;
+	while (n >= 8) {
+		lastByte = (lastByte << 8) | next();
+		num |= (lastByte >> lastBits) << (n - 8);
+		n -= 8;
+	}
+	if (n > 0) {
+		if ((int) lastBits < n) {
+			lastBits += 8;
+			lastByte = (lastByte << 8) | next();
+		}
+		lastBits -= n;
+		num |= (lastByte >> lastBits) & ((1 << n) - 1);
+	}
+	return num & mask;
+}
+
+//
+// Read three integers packed together as a single
+// number of the given number of bits
+//
+void
+BitReader::ints(int nbits, const unsigned int sizes[3], int nums[3])
+{
+	int bytes[32];
+	int byteCount = 0;
+	bytes[1] = bytes[2] = bytes[3] = 0;
+	while (nbits > 8) {
+		bytes[byteCount++] = bits(8);
+		nbits -= 8;
+	}
+	if (nbits > 0)
+		bytes[byteCount++] = bits(nbits);
+	for (int i = 2; i > 0; i--) {
+		unsigned int num = 0;
+		for (int j = byteCount - 1; j >= 0; j--) {
+			num = (num << 8) | bytes[j];
+			unsigned int p = num / sizes[i];
+			bytes[j] = p;
+			num = num - p * sizes[i];
+		}
+		nums[i] = num;
+	}
+	nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16)
+							| (bytes[3] << 24);
+}
+
+//
+// Constructor for XtcTrajectory (the atom count is taken from the
+// first frame header)
+//
+XtcTrajectory::XtcTrajectory(FILE *input)
+	: Trajectory()
+{
+	input_ = input;
+	data_ = NULL;
+	dataSize_ = 0;
+	int magic, n;
+	if (xdrInt(input_, &magic) < 0 || magic != 1995
+	||  xdrInt(input_, &n) < 0 || fseek(input_, 0, SEEK_SET) != 0) {
+		error_ = "not an XTC file";
+		return;
+	}
+	if (n <= 0) {
+		error_ = "bad atom count in XTC header";
+		return;
+	}
+	setAtomCount(n);
+}
+
+//
+// Destructor for XtcTrajectory
+//
+XtcTrajectory::~XtcTrajectory(void)
+{
+	delete [] data_;
+}
+
+//
+// Read the frame header (magic number, atom count, step, time and
+// box), up to and including the coordinate count
+// Return 1 if read, 0 at end of file and -1 on error
+//
+int
+XtcTrajectory::readHeader(void)
+{
+	int magic, n, step;
+	float time, box[9];
+	if (xdrInt(input_, &magic) < 0)
+		return 0;
+	if (magic != 1995 || xdrInt(input_, &n) < 0 || n != atomCount_
+	||  xdrInt(input_, &step) < 0 || xdrFloat(input_, &time) < 0) {
+		error_ = "bad XTC frame header";
+		return -1;
+	}
+	for (int i = 0; i < 9; i++)
+		if (xdrFloat(input_, &box[i]) < 0) {
+			error_ = "truncated XTC frame";
+			return -1;
+		}
+	if (xdrInt(input_, &n) < 0 || n != atomCount_) {
+		error_ = "bad XTC coordinate count";
+		return -1;
+	}
+	return 1;
+}
+
+//
+// Read length bytes of compressed data (padded to a multiple of 4)
+//
+int
+XtcTrajectory::readData(int length)
+{
+	int padded = (length + 3) & ~3;
+	if (padded > dataSize_) {
+		delete [] data_;
+		dataSize_ = padded;
+		data_ = new unsigned char[dataSize_];
+	}
+	if (fread(data_, 1, padded, input_) != (size_t) padded) {
+		error_ = "truncated XTC frame";
+		return -1;
+	}
+	return 0;
+}
+
+//
+// Read and decompress the next frame (converting from nm to angstroms)
+//
+// This follows xdr3dfcoord from the GROMACS xdrfile library.  Atoms
+// are stored as integers (coordinates times precision), the first of
+// each run relative to the minimum over the frame, and the following
+// ones as small differences from their predecessor.  The size used for
+// the differences adapts from run to run.  Decoding stops once the
+// needed atoms have been found.
+//
+int
+XtcTrajectory::readFrame(void)
+{
+	int status = readHeader();
+	if (status <= 0)
+		return status;
+	int i, k;
+	if (atomCount_ <= 9) {
+		// Few atoms are not compressed
+		for (i = 0; i < atomCount_; i++)
+			for (k = 0; k < 3; k++) {
+				if (xdrFloat(input_, &xyz_[i][k]) < 0) {
+					error_ = "truncated XTC frame";
+					return -1;
+				}
+				xyz_[i][k] *= 10;
+			}
+		return 1;
+	}
+
+	float precision;
+	int minInt[3], maxInt[3], smallIdx, length;
+	if (xdrFloat(input_, &precision) < 0) {
+		error_ = "truncated XTC frame";
+		return -1;
+	}
+	for (k = 0; k < 3; k++)
+		if (xdrInt(input_, &minInt[k]) < 0) {
+			error_ = "truncated XTC frame";
+			return -1;
+		}
+	for (k = 0; k < 3; k++)
+		if (xdrInt(input_, &maxInt[k]) < 0) {
+			error_ = "truncated XTC frame";
+			return -1;
+		}
+	if (xdrInt(input_, &smallIdx) < 0 || xdrInt(input_, &length) < 0) {
+		error_ = "truncated XTC frame";
+		return -1;
+	}
+	if (precision <= 0 || smallIdx < firstIdx || smallIdx >= lastIdx
+	||  length < 0) {
+		error_ = "bad XTC compression parameters";
+		return -1;
+	}
+	if (readData(length) < 0)
+		return -1;
+
+	unsigned int sizeInt[3];
+	int bitSizeInt[3];
+	int bitSize;
+	for (k = 0; k < 3; k++)
+		sizeInt[k] = maxInt[k] - minInt[k] + 1;
+	if ((sizeInt[0] | sizeInt[1] | sizeInt[2]) > 0xffffff) {
+		for (k = 0; k < 3; k++)
+			bitSizeInt[k] = sizeOfInt(sizeInt[k]);
+		bitSize = 0;		// Flag the use of large sizes
+	}
+	else
+		bitSize = sizeOfInts(sizeInt);
+	int smaller = magicInts[smallIdx - 1 > firstIdx ?
+					smallIdx - 1 : firstIdx] / 2;
+	int smallNum = magicInts[smallIdx] / 2;
+	unsigned int sizeSmall[3];
+	sizeSmall[0] = sizeSmall[1] = sizeSmall[2] = magicInts[smallIdx];
+
+	BitReader in;
+	in.data = data_;
+	in.size = length;
+	in.count = 0;
+	in.lastBits = in.lastByte = 0;
+	in.overrun = 0;
+	float scale = 10 / precision;
+	int needed = neededCount();
+	int run = 0;
+	i = 0;
+	while (i < needed) {
+		int coord[3], prev[3];
+		if (bitSize == 0)
+			for (k = 0; k < 3; k++)
+				coord[k] = in.bits(bitSizeInt[k]);
+		else
+			in.ints(bitSize, sizeInt, coord);
+		for (k = 0; k < 3; k++)
+			prev[k] = coord[k] + minInt[k];
+
+		int isSmaller = 0;
+		if (in.bits(1)) {
+			run = in.bits(5);
+			isSmaller = run % 3;
+			run -= isSmaller;
+			isSmaller--;
+		}
+		if (i + 1 + run / 3 > atomCount_) {
+			error_ = "bad XTC compressed data";
+			return -1;
+		}
+		if (run == 0) {
+			for (k = 0; k < 3; k++)
+				xyz_[i][k] = prev[k] * scale;
+			i++;
+		}
+		for (int r = 0; r < run; r += 3) {
+			in.ints(smallIdx, sizeSmall, coord);
+			for (k = 0; k < 3; k++)
+				coord[k] += prev[k] - smallNum;
+			if (r == 0) {
+				// The first two atoms of a run were swapped
+				// (for better compression of water)
+				for (k = 0; k < 3; k++) {
+					int tmp = coord[k];
+					coord[k] = prev[k];
+					prev[k] = tmp;
+					xyz_[i][k] = prev[k] * scale;
+				}
+				i++;
+			}
+			else
+				for (k = 0; k < 3; k++)
+					prev[k] = coord[k];
+			for (k = 0; k < 3; k++)
+				xyz_[i][k] = coord[k] * scale;
+			i++;
+		}
+
+		smallIdx += isSmaller;
+		if (smallIdx < firstIdx || smallIdx >= lastIdx) {
+			error_ = "bad XTC compressed data";
+			return -1;
+		}
+		if (isSmaller < 0) {
+			smallNum = smaller;
+			smaller = smallIdx > firstIdx ?
+					magicInts[smallIdx - 1] / 2 : 0;
+		}
+		else if (isSmaller > 0) {
+			smaller = smallNum;
+			smallNum = magicInts[smallIdx] / 2;
+		}
+		sizeSmall[0] = sizeSmall[1] = sizeSmall[2] =
+							magicInts[smallIdx];
+	}
+	if (in.overrun) {
+		error_ = "bad XTC compressed data";
+		return -1;
+	}
+	return 1;
+}
+
+//
+// Skip the next frame without decompressing it
+//
+int
+XtcTrajectory::skipFrame(void)
+{
+	int status = readHeader();
+	if (status <= 0)
+		return status;
+	long skip;
+	if (atomCount_ <= 9)
+		skip = 3 * atomCount_ * 4;
+	else {
+		// Precision, minimum and maximum, small index
+		if (fseek(input_, 8 * 4, SEEK_CUR) != 0) {
+			error_ = "truncated XTC frame";
+			return -1;
+		}
+		int length;
+		if (xdrInt(input_, &length) < 0 || length < 0) {
+			error_ = "truncated XTC frame";
+			return -1;
+		}
+		skip = (length + 3) & ~3;
+	}
+	if (fseek(input_, skip, SEEK_CUR) != 0) {
+		error_ = "truncated XTC frame";
+		return -1;
+	}
+	return 1;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef trajectory_h
+#define trajectory_h
+
+#include <stdio.h>
+#include <string>
+
+//
+// Source of coordinate frames for a fixed set of atoms (in the same
+// order as the atoms of the PDB file giving the topology)
+//
+// Frames are numbered from 1.  Only frames first, first + stride, ...
+// up to last (if positive) are returned by nextFrame; the others are
+// skipped without decoding.  Only the first needed atoms of each frame
+// are decoded, if the format allows it.
+//
+class Trajectory {
+protected:
+	std::string	error_;
+	int		atomCount_;
+	int		needed_;
+	float		(*xyz_)[3];
+	int		frame_;
+	int		first_, last_, stride_;
+	void		setAtomCount(int n);
+	int		neededCount(void) const;
+	virtual int	readFrame(void) = 0;
+	virtual int	skipFrame(void) = 0;
+public:
+			Trajectory(void);
+	virtual		~Trajectory(void);
+	int		okay(void) const { return error_ == ""; }
+	const char	*error(void) const { return error_.c_str(); }
+	int		atomCount(void) const { return atomCount_; }
+	int		frame(void) const { return frame_; }
+	const float	*coord(int n) const { return xyz_[n]; }
+	const float	*coords(void) const { return xyz_[0]; }
+	void		setAtomsNeeded(int n) { needed_ = n; }
+	void		setFrames(int first, int last, int stride);
+	int		nextFrame(void);
+public:
+	static Trajectory *
+			open(FILE *input);
+};
+
+//
+// CHARMM/NAMD/X-PLOR DCD trajectory (either byte order)
+//
+class DcdTrajectory : public Trajectory {
+	FILE		*input_;
+	int		swap_;
+	int		charmm_;
+	int		unitCell_;
+	int		fourDims_;
+	int		freeCount_;
+	int		*freeIndex_;
+	char		*record_;
+	int		recordSize_;
+	int		readRecord(void);
+	int		skipRecord(void);
+	int		readInt(int *value);
+	int		readCoords(int count, int d);
+protected:
+	virtual int	readFrame(void);
+	virtual int	skipFrame(void);
+public:
+			DcdTrajectory(FILE *input);
+	virtual		~DcdTrajectory(void);
+};
+
+//
+// GROMACS XTC trajectory (coordinates compressed by xdr3dfcoord)
+//
+class XtcTrajectory : public Trajectory {
+	FILE		*input_;
+	unsigned char	*data_;
+	int		dataSize_;
+	int		readHeader(void);
+	int		readData(int length);
+protected:
+	virtual int	readFrame(void);
+	virtual int	skipFrame(void);
+public:
+			XtcTrajectory(FILE *input);
+	virtual		~XtcTrajectory(void);
+};
+
+#endif
@@ -42,7 +42,19 @@
 #include <string.h>
 #include <pdb++.h>
 #include "ksdssp.h"
+#include "Assignment.h"
+#include "Cache.h"
 #include "Model.h"
+#include "Probes.h"
+#include "Trajectory.h"
+#include "FrameScheduler.h"
+#include "Metrics.h"
+#include "Series.h"
+#include "Server.h"
+#include "SharedSegment.h"
+#include "Stats.h"
+#include "Timings.h"
+#include "Trace.h"
 #include "XGetopt.h"
 
 #ifndef DONT_INSTANIATE
@@ -53,7 +65,131 @@ template class List<Model>;
 extern "C" char *strerror(int);
 #endif
 
-int verbose = 0;
+static SeriesWriter *series = NULL;
+
+//
+// Return the number of residues in all models
+//
+static int
+residueTotal(List<Model> &modelList)
+{
+	int n = 0;
+	for (Pix p = modelList.first(); p != 0; modelList.next(p))
+		n += modelList(p)->residueCount();
+	return n;
+}
+
+//
+// Print the records for one trajectory frame, enclosed in MODEL and
+// ENDMDL records (if a series is being written, the frame is added
+// to it instead)
+//
+static void
+printFrame(List<Model> &modelList, int frame, FILE *output, FILE *summary)
+{
+	if (series != NULL) {
+		series->addFrame(modelList, frame);
+		output = NULL;
+	}
+	PDB model(PDB::MODEL);
+	model.model.num = frame;
+	if (output != NULL)
+		(void) fprintf(output, "%s\n", model.chars());
+	if (summary != NULL)
+		(void) fprintf(summary, "%s\n", model.chars());
+	Model::printStructure(modelList, output, summary);
+	Metrics::countInput(I_FRAME, modelList.count(),
+					residueTotal(modelList));
+	PDB endmdl(PDB::ENDMDL);
+	if (output != NULL)
+		(void) fprintf(output, "%s\n", endmdl.chars());
+	if (summary != NULL)
+		(void) fprintf(summary, "%s\n", endmdl.chars());
+}
+
+//
+// Print the codes of the frames first, first + stride, ... up to last
+// (all frames if last is 0) of a time series written with -T, one
+// line per frame giving its number and codes
+// Returns 0 on success and -1 (with a message printed) otherwise
+//
+static int
+printSeries(const char *seriesFile, int first, int last, int stride,
+					FILE *output, const char *program)
+{
+	FILE *input = fopen(seriesFile, "rb");
+	if (input == NULL) {
+		(void) fprintf(stderr, "%s: %s: %s\n",
+				program, seriesFile, strerror(errno));
+		return -1;
+	}
+	SeriesReader reader(input);
+	if (stride < 1)
+		stride = 1;
+	for (int k = 0; reader.okay() && k < reader.frameCount(); k++) {
+		int frame = reader.frameNumber(k);
+		if (frame < first || (last > 0 && frame > last)
+		|| (frame - first) % stride != 0)
+			continue;
+		const char *codes = reader.codes(k);
+		if (codes != NULL)
+			(void) fprintf(output, "%d %s\n", frame, codes);
+	}
+	(void) fclose(input);
+	if (!reader.okay()) {
+		(void) fprintf(stderr, "%s: %s: %s\n",
+				program, seriesFile, reader.error());
+		return -1;
+	}
+	return 0;
+}
+
+//
+// Report the stage times of the models as a table on standard error
+// (if table is set) and as JSON in jsonFile (if not NULL), their
+// memory use and work counts on standard error (if memory and stats
+// are set), and the trace in traceFile (if not NULL); and write the
+// final metrics (if kept)
+// Returns 0 on success and -1 (with a message printed) otherwise
+//
+static int
+reportProfile(List<Model> &modelList, int table, const char *jsonFile,
+		int memory, int stats, const char *traceFile,
+		const char *program)
+{
+	Metrics::finish();
+	if (traceFile != NULL) {
+		FILE *f = fopen(traceFile, "w");
+		if (f == NULL || Trace::write(f) < 0 || fclose(f) != 0) {
+			(void) fprintf(stderr, "%s: %s: %s\n", program,
+						traceFile, strerror(errno));
+			return -1;
+		}
+	}
+	if (table)
+		StageTimes::printTable(stderr, modelList);
+	if (memory)
+		StageTimes::printMemoryTable(stderr, modelList);
+	if (StageTimes::countEvents)
+		StageTimes::printEventTable(stderr, modelList);
+#ifdef WITH_STATS
+	if (stats)
+		WorkStats::printTable(stderr, modelList);
+#else
+	(void) stats;
+#endif
+	if (jsonFile == NULL)
+		return 0;
+	FILE *f = fopen(jsonFile, "w");
+	if (f != NULL) {
+		StageTimes::printJson(f, modelList);
+		if (fclose(f) == 0)
+			return 0;
+	}
+	(void) fprintf(stderr, "%s: %s: %s\n", program, jsonFile,
+							strerror(errno));
+	return -1;
+}
 
 //
 // This is an implementation of
@@ -70,27 +206,191 @@ main(int argc, char **argv)
 	// Parse command line options
 	int o;
 	char *summaryFile = NULL;
-	while ((o = Xgetopt(argc, argv, "c:h:s:vBS:")) != EOF)
+	char *trajectoryFile = NULL;
+	char *seriesFile = NULL;
+	char *readSeries = NULL;
+	char *serveSocket = NULL;
+	char *clientSocket = NULL;
+	char *sharedName = NULL;
+#ifndef NO_CACHE
+	char *cacheDir = NULL;
+	long cacheSize = 256;
+	int mtrix = 0;
+#endif
+	char *timesFile = NULL;
+	int timesTable = 0;
+	int statsTable = 0;
+	int memoryTable = 0;
+	int eventTable = 0;
+	char *traceFile = NULL;
+	char *metricsFile = NULL;
+	double metricsInterval = 10;
+	SSOptions options;
+	int firstFrame = 1;
+	int lastFrame = 0;
+	int frameStride = 1;
+	float skin = 2.0;
+	int jobs = 1;
+	while ((o = Xgetopt(argc, argv, "b:c:e:h:i:j:k:m:pr:s:t:uvwBC:D:HK:MP:R:S:T:X:Y:Z:")) != EOF)
 		switch (o) {
+		  case 'b':
+			firstFrame = atoi(optarg);
+			break;
 		  case 'c':
-			Residue::setHBondCutoff(atof(optarg));
+			options.hBondCutoff = atof(optarg);
+			Model::setHBondCutoff(options.hBondCutoff);
+			break;
+		  case 'e':
+			lastFrame = atoi(optarg);
 			break;
 		  case 'h':
-			Model::setMinHelixLength(atoi(optarg));
+			options.minHelixLength = atoi(optarg);
+			Model::setMinHelixLength(options.minHelixLength);
+			break;
+		  case 'i':
+			frameStride = atoi(optarg);
+			break;
+		  case 'j':
+			jobs = atoi(optarg);
+			break;
+		  case 'k':
+			skin = atof(optarg);
+			break;
+		  case 'm':
+			sharedName = optarg;
+			break;
+		  case 'p':
+			timesTable = 1;
+			break;
+		  case 'r':
+			traceFile = optarg;
 			break;
 		  case 's':
-			Model::setMinStrandLength(atoi(optarg));
+			options.minStrandLength = atoi(optarg);
+			Model::setMinStrandLength(options.minStrandLength);
+			break;
+		  case 't':
+			trajectoryFile = optarg;
+			break;
+		  case 'u':
+			memoryTable = 1;
 			break;
 		  case 'v':
 			verbose++;
 			break;
+		  case 'w':
+			statsTable = 1;
+			break;
 		  case 'B':
+			options.checkBulges = 0;
 			Model::ignoreBulges();
 			break;
+		  case 'C':
+			clientSocket = optarg;
+			break;
+		  case 'D':
+			serveSocket = optarg;
+			break;
+		  case 'H':
+			eventTable = 1;
+			break;
+		  case 'K':
+#ifndef NO_CACHE
+			cacheDir = optarg;
+#endif
+			break;
+		  case 'M':
+#ifndef NO_CACHE
+			mtrix = 1;
+#endif
+			Model::useMtrix();
+			break;
+		  case 'P':
+			timesFile = optarg;
+			break;
+		  case 'R':
+			readSeries = optarg;
+			break;
 		  case 'S':
 			summaryFile = optarg;
 			break;
+		  case 'T':
+			seriesFile = optarg;
+			break;
+		  case 'X':
+			metricsFile = optarg;
+			break;
+		  case 'Y':
+			metricsInterval = atof(optarg);
+			break;
+		  case 'Z':
+#ifndef NO_CACHE
+			cacheSize = atol(optarg);
+#endif
+			break;
+		}
+
+	// Decode a time series instead of assigning secondary structure
+	if (readSeries != NULL) {
+		if (argc - optind > 0) {
+			(void) fprintf(stderr, "Usage: %s -R series_file "
+				"[-b frame] [-e frame] [-i stride]\n",
+				argv[0]);
+			return 1;
+		}
+		return printSeries(readSeries, firstFrame, lastFrame,
+					frameStride, stdout, argv[0]) < 0;
+	}
+
+	// Keep metrics (of the server, too)
+	if (metricsFile != NULL) {
+		std::string error;
+		if (Metrics::start(metricsFile, metricsInterval, error) < 0) {
+			(void) fprintf(stderr, "%s: %s: %s\n",
+					argv[0], metricsFile, error.c_str());
+			return 1;
 		}
+		Model::recordTimes(1);
+	}
+
+	// Serve requests until killed
+	if (serveSocket != NULL) {
+#ifndef NO_SERVER
+		if (argc - optind > 0) {
+			(void) fprintf(stderr,
+				"Usage: %s -D socket [-j workers]\n", argv[0]);
+			return 1;
+		}
+		Server server(serveSocket, Model::printStructure, jobs);
+		if (!server.okay()) {
+			(void) fprintf(stderr, "%s: %s: %s\n",
+				argv[0], serveSocket, server.error());
+			return 1;
+		}
+		server.run();
+		return 1;
+#else
+		(void) fprintf(stderr, "%s: server not supported\n", argv[0]);
+		return 1;
+#endif
+	}
+
+	// Fill in a shared memory segment
+	if (sharedName != NULL) {
+#ifndef NO_SHM
+		SharedSegment segment(sharedName);
+		if (segment.assign() < 0) {
+			(void) fprintf(stderr, "%s: %s: %s\n",
+				argv[0], sharedName, segment.error());
+			return 1;
+		}
+		return 0;
+#else
+		(void) fprintf(stderr, "%s: shared memory not supported\n",
+			argv[0]);
+		return 1;
+#endif
+	}
 
 	// Check input PDB file
 	FILE *input = NULL;
@@ -156,22 +456,55 @@ main(int argc, char **argv)
 		return 1;
 	}
 
-	// Construct molecule from PDB file
-	List<Model> modelList;
-	for (;;) {
-		Model *m = new Model(input);
-		if (!m->okay()) {
+	// Let a server do the work
+	if (clientSocket != NULL) {
+#ifndef NO_SERVER
+		std::string error;
+		if (Server::request(clientSocket, input, output, error) < 0) {
 			(void) fprintf(stderr, "%s: %s: %s\n",
-				argv[0], inputFile, m->error());
+				argv[0], clientSocket, error.c_str());
 			return 1;
 		}
-		int anyMore = m->anyMore();
-		if (m->anyAtoms())
-			modelList.append(m);
+		return 0;
+#else
+		(void) fprintf(stderr, "%s: server not supported\n", argv[0]);
+		return 1;
+#endif
+	}
+
+	// Construct molecule from PDB file
+	if (traceFile != NULL) {
+		Trace::enable();
+		Trace::nameThread("main");
+	}
+	if (memoryTable)
+		StageTimes::countMemory = 1;
+	if (eventTable) {
+		if (HardwareCounters::open() > 0)
+			StageTimes::countEvents = 1;
 		else
-			delete m;
-		if (!anyMore)
-			break;
+			(void) fprintf(stderr, "%s: hardware counters %s\n",
+					argv[0], HardwareCounters::error());
+	}
+	if (timesTable || timesFile != NULL || traceFile != NULL
+	|| memoryTable || eventTable)
+		Model::recordTimes(1);
+	if (statsTable) {
+#ifdef WITH_STATS
+		Model::recordStats(1);
+#else
+		(void) fprintf(stderr, "%s: work counts not compiled in "
+			"(build with -DWITH_STATS)\n", argv[0]);
+		return 1;
+#endif
+	}
+	PROBE1(file__start, inputFile);
+	List<Model> modelList;
+	std::string readError;
+	if (Model::readModels(input, modelList, readError) < 0) {
+		(void) fprintf(stderr, "%s: %s: %s\n",
+			argv[0], inputFile, readError.c_str());
+		return 1;
 	}
 	if (modelList.count() <= 0) {
 		(void) fprintf(stderr, "%s: %s: no atoms read\n",
@@ -179,32 +512,37 @@ main(int argc, char **argv)
 		return 1;
 	}
 
-	// Compute secondary structure and print helix and sheet records
-	Pix p;
-	for (p = modelList.first(); p != 0; modelList.next(p))
-		modelList(p)->defineSecondaryStructure();
-	Pix hp = modelList.first();
-	Pix sp = hp;
-	int fileCount = 0;
-	while (hp != 0) {
-		if (fileCount++ > 0)
-			(void) fprintf(output, "%s\n", PDB(PDB::END).chars());
-		int helixId = 0;
-		int sheetId = 0;
-		Model *m = modelList(hp);
-		if (m->modelNumber() != -1)
-			fprintf(output, "%s\n", m->fileRecord().chars());
-		int modelNumber = m->modelNumber();
-		for (; hp != 0 && modelList(hp)->modelNumber() == modelNumber;
-		modelList.next(hp))
-			helixId = modelList(hp)->printHelix(output, helixId);
-		for (; sp != hp; modelList.next(sp))
-			sheetId = modelList(sp)->printSheet(output, sheetId);
-	}
-	if (fileCount > 1)
-		(void) fprintf(output, "%s\n", PDB(PDB::END).chars());
-
-	// Print chain summaries
+	// Open the trajectory (the PDB file then only provides topology)
+	Trajectory *trajectory = NULL;
+	if (trajectoryFile != NULL) {
+		FILE *tf = fopen(trajectoryFile, "rb");
+		if (tf == NULL) {
+			(void) fprintf(stderr, "%s: %s: %s\n",
+				argv[0], trajectoryFile, strerror(errno));
+			return 1;
+		}
+		trajectory = Trajectory::open(tf);
+		if (!trajectory->okay()) {
+			(void) fprintf(stderr, "%s: %s: %s\n",
+				argv[0], trajectoryFile, trajectory->error());
+			return 1;
+		}
+		int needed = 0;
+		for (Pix p = modelList.first(); p != 0; modelList.next(p))
+			if (modelList(p)->atomCount() > needed)
+				needed = modelList(p)->atomCount();
+		if (needed > trajectory->atomCount()) {
+			(void) fprintf(stderr, "%s: %s: %d atoms, "
+				"but %s needs at least %d\n",
+				argv[0], trajectoryFile,
+				trajectory->atomCount(), inputFile, needed);
+			return 1;
+		}
+		trajectory->setAtomsNeeded(needed);
+		trajectory->setFrames(firstFrame, lastFrame, frameStride);
+		Model::setNeighborSkin(skin);
+	}
+
 	FILE *summary = NULL;
 	if (summaryFile != NULL
 	&& (summary = fopen(summaryFile, "w")) == NULL) {
@@ -212,11 +550,126 @@ main(int argc, char **argv)
 			argv[0], summaryFile, strerror(errno));
 		return 1;
 	}
-	if (summary != NULL) {
+	FILE *seriesOutput = NULL;
+	if (seriesFile != NULL && trajectory != NULL) {
+		seriesOutput = fopen(seriesFile, "wb");
+		if (seriesOutput == NULL) {
+			(void) fprintf(stderr, "%s: %s: %s\n",
+				argv[0], seriesFile, strerror(errno));
+			return 1;
+		}
+		series = new SeriesWriter(seriesOutput, frameStride);
+	}
+
+	// Compute secondary structure and print helix and sheet records
+	// (reusing cached results, which do not cover residue summaries
+	// or MTRIX copies)
+	Pix p;
+	if (trajectory == NULL) {
+#ifndef NO_CACHE
+		if (cacheDir != NULL && summary == NULL && !mtrix) {
+			Cache cache(cacheDir, cacheSize * 1024 * 1024, options);
+			if (!cache.okay()) {
+				(void) fprintf(stderr, "%s: %s: %s\n",
+					argv[0], cacheDir, cache.error());
+				return 1;
+			}
+			for (p = modelList.first(); p != 0; modelList.next(p)) {
+				Model *m = modelList(p);
+				char key[CACHE_KEY_SIZE];
+				const Assignment *a = cache.lookup(*m, key);
+				if (a != NULL)
+					m->setResult(a);
+				else {
+					m->defineSecondaryStructure();
+					(void) cache.store(key, *m);
+				}
+			}
+			Model::printStructure(modelList, output, summary);
+			PROBE3(file__done, inputFile, modelList.count(),
+						residueTotal(modelList));
+			Metrics::countInput(I_FILE, modelList.count(),
+						residueTotal(modelList));
+			Metrics::countCache(cache.hits(), cache.misses());
+			cache.evict();
+			if (verbose)
+				(void) fprintf(stderr,
+					"%s: cache: %d hits, %d misses\n",
+					argv[0], cache.hits(), cache.misses());
+			if (reportProfile(modelList, timesTable, timesFile,
+			memoryTable, statsTable, traceFile, argv[0]) < 0)
+				return 1;
+			return 0;
+		}
+#endif
 		for (p = modelList.first(); p != 0; modelList.next(p))
-			modelList(p)->printSummary(summary);
-		(void) fclose(summary);
+			modelList(p)->defineSecondaryStructure();
+		Model::printStructure(modelList, output, summary);
+		PROBE3(file__done, inputFile, modelList.count(),
+					residueTotal(modelList));
+		Metrics::countInput(I_FILE, modelList.count(),
+					residueTotal(modelList));
+		if (summary != NULL)
+			(void) fclose(summary);
+		if (reportProfile(modelList, timesTable, timesFile,
+		memoryTable, statsTable, traceFile, argv[0]) < 0)
+			return 1;
+		return 0;
 	}
 
+	// Same for each frame of the trajectory
+	int status = 0;
+#ifndef NO_THREADS
+	if (jobs > 1) {
+		FrameScheduler fs(trajectory, modelList, printFrame, jobs);
+		status = fs.run(output, summary);
+	}
+	else
+#endif
+	for (;;) {
+		double start = Trace::now();
+		if ((status = trajectory->nextFrame()) <= 0)
+			break;
+		int frame = trajectory->frame();
+		for (p = modelList.first(); p != 0; modelList.next(p))
+			modelList(p)->setCoords(trajectory->coords());
+		double read = Trace::now();
+		Trace::span("read frame", "frame", start, read, 0, frame);
+		for (p = modelList.first(); p != 0; modelList.next(p))
+			modelList(p)->defineSecondaryStructure();
+		double assigned = Trace::now();
+		Trace::span("assign frame", "frame", read, assigned, 0, frame);
+		printFrame(modelList, frame, output, summary);
+		Trace::span("print frame", "frame", assigned, Trace::now(), 0,
+									frame);
+	}
+
+	PROBE3(file__done, inputFile, modelList.count(),
+				residueTotal(modelList));
+	if (status < 0)
+		Metrics::countError();
+
+	// Index the frames written, even after a read error
+	if (series != NULL) {
+		if (series->finish() < 0 || fclose(seriesOutput) != 0) {
+			(void) fprintf(stderr, "%s: %s: %s\n",
+				argv[0], seriesFile, strerror(errno));
+			return 1;
+		}
+		delete series;
+	}
+	if (reportProfile(modelList, timesTable, timesFile, memoryTable,
+	statsTable, traceFile, argv[0]) < 0)
+		return 1;
+	if (status < 0) {
+		(void) fprintf(stderr, "%s: %s: frame %d: %s\n",
+			argv[0], trajectoryFile, trajectory->frame() + 1,
+			trajectory->error());
+		return 1;
+	}
+	if (summary != NULL)
+		(void) fclose(summary);
+	delete trajectory;
+
 	return 0;
 }
@@ -40,6 +40,33 @@ extern "C" float sqrtf(float);
 #endif
 #endif
 
+#if defined(_WIN32) && !defined(NO_THREADS)
+#define	NO_THREADS
+#endif
+
+#if defined(_WIN32) && !defined(NO_SERVER)
+#define	NO_SERVER
+#endif
+
+#if defined(_WIN32) && !defined(NO_SHM)
+#define	NO_SHM
+#endif
+
+#if defined(_WIN32) && !defined(NO_CACHE)
+#define	NO_CACHE
+#endif
+
+#if !defined(__linux__) && !defined(NO_PERF)
+#define	NO_PERF
+#endif
+
+// Storage class of per-thread variables
+#ifdef _MSC_VER
+#define	THREAD_LOCAL	__declspec(thread)
+#else
+#define	THREAD_LOCAL	__thread
+#endif
+
 extern int	verbose;
 
 #endif
@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+//
+// Python extension module ksdssp_ext: secondary structure assignment
+// (see Assignment.h) of coordinates held in a Python buffer, without
+// writing or parsing PDB text, and of PDB files, giving the HELIX and
+// SHEET records the ksdssp program writes
+//
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <errno.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "Assignment.h"
+#include "Model.h"
+
+//
+// Whether a buffer format string describes a native item of type c
+//
+static int
+isFormat(const Py_buffer &view, char c)
+{
+	const char *f = view.format;
+	if (f == NULL)
+		return 0;
+	if (*f == '@' || *f == '=' || *f == '<')
+		f++;
+	return f[0] == c && f[1] == '\0';
+}
+
+//
+// Get count integers from obj (a buffer of 32-bit integers, used in
+// place, or any sequence, converted into storage).  Returns NULL
+// (with an exception set) on error.
+//
+static const int *
+intArray(PyObject *obj, int count, const char *what, Py_buffer *view,
+						std::vector<int> &storage)
+{
+	if (PyObject_CheckBuffer(obj)
+	&& PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT)
+									== 0) {
+		if ((isFormat(*view, 'i') || isFormat(*view, 'I')
+		|| (isFormat(*view, 'l') && view->itemsize == 4))
+		&& view->len == (Py_ssize_t) count * 4)
+			return (const int *) view->buf;
+		PyBuffer_Release(view);
+	}
+	PyErr_Clear();
+	view->obj = NULL;
+	PyObject *seq = PySequence_Fast(obj, what);
+	if (seq == NULL)
+		return NULL;
+	if (PySequence_Fast_GET_SIZE(seq) != count) {
+		Py_DECREF(seq);
+		PyErr_Format(PyExc_ValueError, "%s: %d values expected",
+								what, count);
+		return NULL;
+	}
+	storage.resize(count > 0 ? count : 1);
+	for (int i = 0; i < count; i++) {
+		long v = PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i));
+		if (v == -1 && PyErr_Occurred()) {
+			Py_DECREF(seq);
+			return NULL;
+		}
+		storage[i] = (int) v;
+	}
+	Py_DECREF(seq);
+	return &storage[0];
+}
+
+//
+// Build the result dictionary for an assignment
+//
+static PyObject *
+results(const Assignment &a)
+{
+	int i;
+	PyObject *helices = PyList_New(a.helixCount());
+	for (i = 0; i < a.helixCount(); i++) {
+		const SSHelix &h = a.helix(i);
+		PyList_SET_ITEM(helices, i, Py_BuildValue("(iii)",
+						h.from, h.to, h.type));
+	}
+	PyObject *ladders = PyList_New(a.ladderCount());
+	for (i = 0; i < a.ladderCount(); i++) {
+		const SSLadder &l = a.ladder(i);
+		PyList_SET_ITEM(ladders, i, Py_BuildValue("(N(ii)(ii)i)",
+				PyBool_FromLong(l.parallel),
+				l.start[0], l.end[0], l.start[1], l.end[1],
+				l.sheet));
+	}
+	PyObject *sheets = PyList_New(a.sheetCount());
+	for (i = 0; i < a.sheetCount(); i++) {
+		const SSSheet &s = a.sheet(i);
+		PyObject *strands = PyList_New(s.strandCount);
+		for (int k = 0; k < s.strandCount; k++) {
+			const Strand &st = a.strand(s.firstStrand + k);
+			PyList_SET_ITEM(strands, k, Py_BuildValue("(iiiii)",
+					st.start, st.end, st.sense,
+					st.nResidue, st.oResidue));
+		}
+		PyList_SET_ITEM(sheets, i, Py_BuildValue("{s:N,s:N}",
+				"strands", strands,
+				"cyclic", PyBool_FromLong(s.cyclic)));
+	}
+	return Py_BuildValue("{s:s#,s:N,s:N,s:N}",
+			"codes", a.codes(), (Py_ssize_t) a.residueCount(),
+			"helices", helices, "ladders", ladders,
+			"sheets", sheets);
+}
+
+static const char assignDoc[] =
+"assign(xyz, atoms=None, names=None, chain_ends=None, hbond_cutoff=-0.5,\n"
+"       min_helix_length=3, min_strand_length=3, ignore_bulges=False)\n"
+"\n"
+"Assign secondary structure to the residues whose coordinates are in\n"
+"xyz, a C-contiguous buffer (such as a numpy array of shape (n, 5, 3))\n"
+"holding x, y and z of the N, CA, C, O and imide H atoms of each of n\n"
+"residues.  float32 buffers are read directly and float64 ones are\n"
+"converted to float32 first; either way the coordinates are copied\n"
+"into the model ksdssp builds, which adds imide hydrogens to them.\n"
+"atoms gives the atoms present in each residue as a bit mask (bit 0\n"
+"for N through bit 4 for H; N, CA, C and O if omitted), names the\n"
+"residue names and chain_ends the indices of residues that end a chain\n"
+"(as at TER records).\n"
+"\n"
+"Returns a dictionary: codes is a string of one secondary structure\n"
+"code per residue, helices a list of (first, last, pdb_class), ladders\n"
+"a list of (parallel, (first, last), (first, last), sheet) and sheets a\n"
+"list of dictionaries with the strands, in SHEET record order, as\n"
+"(first, last, sense, n_residue, o_residue), and whether the sheet is\n"
+"cyclic (the first strand's sense is then the one to the last strand,\n"
+"where the SHEET records repeat it; otherwise 0).  Residues are given\n"
+"by index.";
+
+//
+// ksdssp_ext.assign (see assignDoc)
+//
+static PyObject *
+assign(PyObject *, PyObject *args, PyObject *kw)
+{
+	static const char *keywords[] = { "xyz", "atoms", "names",
+		"chain_ends", "hbond_cutoff", "min_helix_length",
+		"min_strand_length", "ignore_bulges", NULL };
+	PyObject *xyzObj;
+	PyObject *atomsObj = Py_None;
+	PyObject *namesObj = Py_None;
+	PyObject *endsObj = Py_None;
+	SSOptions options;
+	int ignoreBulges = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "O|OOOfiii:assign",
+			(char **) keywords, &xyzObj, &atomsObj, &namesObj,
+			&endsObj, &options.hBondCutoff,
+			&options.minHelixLength, &options.minStrandLength,
+			&ignoreBulges))
+		return NULL;
+	options.checkBulges = !ignoreBulges;
+
+	// Coordinates
+	Py_buffer xyz;
+	if (PyObject_GetBuffer(xyzObj, &xyz, PyBUF_C_CONTIGUOUS
+							| PyBUF_FORMAT) < 0)
+		return NULL;
+	int floats = 0;
+	std::vector<float> converted;
+	const float *coords = NULL;
+	if (isFormat(xyz, 'f') && xyz.itemsize == 4) {
+		floats = (int) (xyz.len / 4);
+		coords = (const float *) xyz.buf;
+	}
+	else if (isFormat(xyz, 'd') && xyz.itemsize == 8) {
+		floats = (int) (xyz.len / 8);
+		converted.resize(floats > 0 ? floats : 1);
+		const double *d = (const double *) xyz.buf;
+		for (int i = 0; i < floats; i++)
+			converted[i] = (float) d[i];
+		coords = &converted[0];
+	}
+	else {
+		PyBuffer_Release(&xyz);
+		PyErr_SetString(PyExc_TypeError,
+				"xyz: float32 or float64 buffer expected");
+		return NULL;
+	}
+	if (floats == 0 || floats % (A_COUNT * 3) != 0) {
+		PyBuffer_Release(&xyz);
+		PyErr_Format(PyExc_ValueError,
+			"xyz: %d coordinates per residue expected",
+			A_COUNT * 3);
+		return NULL;
+	}
+	int count = floats / (A_COUNT * 3);
+
+	// Atoms present
+	Py_buffer atomsView;
+	atomsView.obj = NULL;
+	std::vector<int> atomsStorage;
+	const int *atoms = NULL;
+	if (atomsObj != Py_None) {
+		atoms = intArray(atomsObj, count, "atoms", &atomsView,
+								atomsStorage);
+		if (atoms == NULL) {
+			PyBuffer_Release(&xyz);
+			return NULL;
+		}
+	}
+
+	// Residue names and chain ends
+	std::vector<SSResidue> residues(count);
+	(void) memset(&residues[0], 0, count * sizeof (SSResidue));
+	int failed = 0;
+	if (namesObj != Py_None) {
+		PyObject *seq = PySequence_Fast(namesObj, "names");
+		if (seq == NULL)
+			failed = 1;
+		else if (PySequence_Fast_GET_SIZE(seq) != count) {
+			PyErr_Format(PyExc_ValueError,
+				"names: %d values expected", count);
+			failed = 1;
+		}
+		else
+			for (int i = 0; i < count; i++) {
+				PyObject *o = PySequence_Fast_GET_ITEM(seq, i);
+				PyObject *b = PyUnicode_Check(o)
+					? PyUnicode_AsASCIIString(o) : o;
+				if (b == NULL || !PyBytes_Check(b)) {
+					if (b != NULL)
+						PyErr_SetString(
+							PyExc_TypeError,
+							"names: strings "
+							"expected");
+					failed = 1;
+					break;
+				}
+				(void) strncpy(residues[i].name,
+					PyBytes_AS_STRING(b),
+					sizeof residues[i].name - 1);
+				if (b != o)
+					Py_DECREF(b);
+			}
+		Py_XDECREF(seq);
+	}
+	if (!failed && endsObj != Py_None) {
+		PyObject *seq = PySequence_Fast(endsObj, "chain_ends");
+		if (seq == NULL)
+			failed = 1;
+		else
+			for (Py_ssize_t k = 0;
+			k < PySequence_Fast_GET_SIZE(seq); k++) {
+				long i = PyLong_AsLong(
+					PySequence_Fast_GET_ITEM(seq, k));
+				if (i == -1 && PyErr_Occurred()) {
+					failed = 1;
+					break;
+				}
+				if (i < 0 || i >= count) {
+					PyErr_Format(PyExc_IndexError,
+						"chain_ends: residue %ld "
+						"out of range", i);
+					failed = 1;
+					break;
+				}
+				residues[i].flags |= SS_CHAIN_END;
+			}
+		Py_XDECREF(seq);
+	}
+
+	// The model has its own options and nothing else shared is
+	// changed while assigning (the server's workers assign at the
+	// same time), so other threads may run meanwhile; the buffers
+	// stay held until the end
+	PyObject *result = NULL;
+	if (!failed) {
+		Assignment a;
+		int status;
+		Py_BEGIN_ALLOW_THREADS
+		status = a.assign(&residues[0], coords, atoms, count, options);
+		Py_END_ALLOW_THREADS
+		if (status < 0)
+			PyErr_SetString(PyExc_ValueError, a.error());
+		else
+			result = results(a);
+	}
+	if (atomsView.obj != NULL)
+		PyBuffer_Release(&atomsView);
+	PyBuffer_Release(&xyz);
+	return result;
+}
+
+static const char recordsDoc[] =
+"records(text=None, file_name=None, hbond_cutoff=-0.5, min_helix_length=3,\n"
+"        min_strand_length=3, ignore_bulges=False)\n"
+"\n"
+"Assign secondary structure to the PDB file given either as text or by\n"
+"file_name, as the ksdssp program does, and return the HELIX and SHEET\n"
+"records it writes (one per line).  Raises IOError if the file cannot\n"
+"be read and ValueError if it holds no atoms or cannot be parsed.";
+
+//
+// Read models from input (closed afterwards), assign their secondary
+// structure and leave their records in text
+// Return 0 on success and -1 (with error set) on error
+//
+static int
+readAndPrint(FILE *input, const SSOptions &options, std::string &text,
+							std::string &error)
+{
+	List<Model> modelList;
+	Pix p;
+	int status = Model::readModels(input, modelList, error);
+	(void) fclose(input);
+	Model::endInput();
+	if (status == 0 && modelList.count() == 0) {
+		error = "no atoms read";
+		status = -1;
+	}
+	if (status == 0) {
+		for (p = modelList.first(); p != 0; modelList.next(p)) {
+			modelList(p)->setOptions(options, 0);
+			modelList(p)->defineSecondaryStructure();
+		}
+		FILE *output = tmpfile();
+		if (output == NULL) {
+			error = strerror(errno);
+			status = -1;
+		}
+		else {
+			Model::printStructure(modelList, output, NULL);
+			rewind(output);
+			char buf[BUFSIZ];
+			size_t n;
+			while ((n = fread(buf, 1, sizeof buf, output)) > 0)
+				text.append(buf, n);
+			(void) fclose(output);
+		}
+	}
+	for (p = modelList.first(); p != 0; modelList.next(p))
+		delete modelList(p);
+	return status;
+}
+
+//
+// ksdssp_ext.records (see recordsDoc)
+//
+static PyObject *
+records(PyObject *, PyObject *args, PyObject *kw)
+{
+	static const char *keywords[] = { "text", "file_name",
+		"hbond_cutoff", "min_helix_length", "min_strand_length",
+		"ignore_bulges", NULL };
+	const char *pdbText = NULL;
+	Py_ssize_t pdbLength = 0;
+	const char *fileName = NULL;
+	SSOptions options;
+	int ignoreBulges = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "|z#zfiii:records",
+			(char **) keywords, &pdbText, &pdbLength, &fileName,
+			&options.hBondCutoff, &options.minHelixLength,
+			&options.minStrandLength, &ignoreBulges))
+		return NULL;
+	options.checkBulges = !ignoreBulges;
+	if ((pdbText == NULL) == (fileName == NULL)) {
+		PyErr_SetString(PyExc_TypeError,
+				"records: either text or file_name is needed");
+		return NULL;
+	}
+
+	// The input is parsed from a file in either case, and the model
+	// reader keeps state between models, so the interpreter lock is
+	// kept throughout
+	FILE *input;
+	if (fileName != NULL) {
+		input = fopen(fileName, "r");
+		if (input == NULL)
+			return PyErr_SetFromErrnoWithFilename(PyExc_IOError,
+							(char *) fileName);
+	}
+	else {
+		input = tmpfile();
+		if (input == NULL
+		|| fwrite(pdbText, 1, pdbLength, input) != (size_t) pdbLength) {
+			if (input != NULL)
+				(void) fclose(input);
+			return PyErr_SetFromErrno(PyExc_IOError);
+		}
+		rewind(input);
+	}
+	std::string text, error;
+	if (readAndPrint(input, options, text, error) < 0) {
+		if (fileName != NULL)
+			PyErr_Format(PyExc_ValueError, "%s: %s", fileName,
+								error.c_str());
+		else
+			PyErr_SetString(PyExc_ValueError, error.c_str());
+		return NULL;
+	}
+	return Py_BuildValue("s#", text.data(), (Py_ssize_t) text.size());
+}
+
+static PyMethodDef methods[] = {
+	{ "assign", (PyCFunction) assign, METH_VARARGS | METH_KEYWORDS,
+								assignDoc },
+	{ "records", (PyCFunction) records, METH_VARARGS | METH_KEYWORDS,
+								recordsDoc },
+	{ NULL, NULL, 0, NULL }
+};
+
+static const char moduleDoc[] =
+"Kabsch and Sander secondary structure assignment (ksdssp)";
+
+#if PY_MAJOR_VERSION >= 3
+static struct PyModuleDef moduleDef = {
+	PyModuleDef_HEAD_INIT, "ksdssp_ext", moduleDoc, -1, methods
+};
+
+PyMODINIT_FUNC
+PyInit_ksdssp_ext(void)
+{
+	PyObject *m = PyModule_Create(&moduleDef);
+	if (m != NULL)
+		(void) PyModule_AddIntConstant(m, "atom_slots", A_COUNT);
+	return m;
+}
+#else
+PyMODINIT_FUNC
+initksdssp_ext(void)
+{
+	PyObject *m = Py_InitModule3("ksdssp_ext", methods, moduleDoc);
+	if (m != NULL)
+		(void) PyModule_AddIntConstant(m, "atom_slots", A_COUNT);
+}
+#endif
@@ -33,6 +33,8 @@
 #include "ksdssp.h"
 #include "misc.h"
 
+int	verbose = 0;
+
 //
 // Compute distance squared between two points
 //
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2002 The Regents of the University of California.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions, and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions, and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *   3. Redistributions must acknowledge that this software was
+ *      originally developed by the UCSF Computer Graphics Laboratory
+ *      under support by the NIH National Center for Research Resources,
+ *      grant P41-RR01081.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+//
+// Check of the incremental interface of Model, run by ../run_tests.py.
+// The residues of the first PDB file are appended one at a time to an
+// empty model (with a chain break at each TER record); the model then
+// takes the coordinates of each further file, which must have the same
+// residues, through updateCoords() with the residues that moved.  The
+// HELIX and SHEET records are printed after each file, as ksdssp prints
+// them for that file on its own, with an END record between files.
+//
+// Usage: ksdssp_incremental pdb_file [pdb_file ...]
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <pdb++.h>
+#include "Model.h"
+#include "Topology.h"
+
+//
+// Read the backbone atoms of a PDB file (up to its first END or ENDMDL
+// record) into topology, numbered in the order read, and their
+// coordinates into xyz
+// Return 0 on success and -1 if the file cannot be opened
+//
+static int
+readFile(const char *fileName, Topology &topology, float *&xyz)
+{
+	FILE *input = fopen(fileName, "r");
+	if (input == NULL)
+		return -1;
+	int size = 0;
+	xyz = NULL;
+	char buf[256];
+	while (fgets(buf, sizeof buf, input) != NULL) {
+		PDB pdb(buf);
+		if (pdb.type() == PDB::END || pdb.type() == PDB::ENDMDL)
+			break;
+		if (pdb.type() == PDB::TER && topology.count() > 0)
+			topology.setFlag(R_TER);
+		if (pdb.type() != PDB::ATOM)
+			continue;
+		PDB::Atom &a = pdb.atom;
+		if (a.residue.chainId == '\0')
+			a.residue.chainId = ' ';
+		if (a.residue.insertCode == '\0')
+			a.residue.insertCode = ' ';
+		if (!topology.sameAsLast(a.residue))
+			topology.addResidue(a.residue);
+		int slot = Residue::atomSlot(a.name);
+		if (slot < 0
+		||  (topology.atoms(topology.count() - 1) & (1 << slot)))
+			continue;	// Only the first one is used
+		int n = topology.atomCount();
+		if (n == size) {
+			size = size == 0 ? 1024 : size * 2;
+			float *bigger = new float[3 * size];
+			if (n > 0)
+				(void) memcpy(bigger, xyz, 3 * n * sizeof (float));
+			delete [] xyz;
+			xyz = bigger;
+		}
+		for (int d = 0; d < 3; d++)
+			xyz[3 * n + d] = a.xyz[d];
+		topology.addAtom(slot, n);
+	}
+	(void) fclose(input);
+	return 0;
+}
+
+//
+// Check if the backbone atoms of residue n are at the same place in
+// two sets of coordinates
+//
+static int
+sameCoords(const Topology &topology, int n, const float *xyz1,
+							const float *xyz2)
+{
+	for (int slot = 0; slot < A_COUNT; slot++) {
+		int index = topology.atomIndex(n, slot);
+		if (index >= 0
+		&&  memcmp(xyz1 + 3 * index, xyz2 + 3 * index,
+						3 * sizeof (float)) != 0)
+			return 0;
+	}
+	return 1;
+}
+
+//
+// Print the HELIX and SHEET records of the model
+//
+static void
+printRecords(const Model &m)
+{
+	(void) m.printHelix(stdout, 0);
+	(void) m.printSheet(stdout, 0);
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc < 2) {
+		(void) fprintf(stderr,
+			"Usage: %s pdb_file [pdb_file ...]\n", argv[0]);
+		return 1;
+	}
+
+	// Grow the model from the residues of the first file
+	Topology topology;
+	float *xyz;
+	if (readFile(argv[1], topology, xyz) < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	Model m;
+	int i;
+	for (i = 0; i < topology.count(); i++) {
+		float r[A_COUNT][3];
+		for (int slot = 0; slot < A_COUNT; slot++) {
+			int index = topology.atomIndex(i, slot);
+			if (index >= 0)
+				(void) memcpy(r[slot], xyz + 3 * index,
+							3 * sizeof (float));
+		}
+		m.appendResidue(topology.residue(i), r, topology.atoms(i));
+		if (topology.flags(i) & R_TER)
+			m.endChain();
+	}
+	printRecords(m);
+
+	// Move the residues that differ in each further file
+	int *moved = new int[topology.count()];
+	for (int f = 2; f < argc; f++) {
+		Topology next;
+		float *nextXyz;
+		if (readFile(argv[f], next, nextXyz) < 0) {
+			perror(argv[f]);
+			return 1;
+		}
+		if (!next.sameAs(&topology)) {
+			(void) fprintf(stderr, "%s: residues differ from %s\n",
+							argv[f], argv[1]);
+			return 1;
+		}
+		int count = 0;
+		for (i = 0; i < topology.count(); i++)
+			if (!sameCoords(topology, i, xyz, nextXyz))
+				moved[count++] = i;
+		m.updateCoords(nextXyz, moved, count);
+		delete [] xyz;
+		xyz = nextXyz;
+		(void) fprintf(stdout, "%s\n", PDB(PDB::END).chars());
+		printRecords(m);
+	}
+	delete [] moved;
+	delete [] xyz;
+	return 0;
+}
@@ -2,9 +2,67 @@ from __future__ import print_function
 
 from libtbx import easy_run
 from libtbx.test_utils import show_diff
-import os
+import os, re, shutil, struct, subprocess, tempfile, time
 import libtbx.load_env
 
+# Fixtures kept with the sources
+regression_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+  "regression")
+
+def ksdssp_lines (args) :
+  result = easy_run.fully_buffered(command="phenix.ksdssp %s" % " ".join(
+    ['"%s"' % a for a in args]))
+  return result.stdout_lines
+
+def read_dcd (path) :
+  """
+  The frames of a DCD file (without unit cells or fixed atoms, as the
+  fixtures are written) as lists of (x, y, z).
+  """
+  with open(path, "rb") as f :
+    data = f.read()
+  records = []
+  pos = 0
+  while pos < len(data) :
+    n = struct.unpack("<i", data[pos:pos+4])[0]
+    records.append(data[pos+4:pos+4+n])
+    pos += n + 8
+  atoms = struct.unpack("<i", records[2])[0]
+  frames = []
+  for k in range(3, len(records), 3) :
+    x, y, z = [ struct.unpack("<%df" % atoms, r) for r in records[k:k+3] ]
+    frames.append(list(zip(x, y, z)))
+  return frames
+
+def write_frame (topology, xyz, path) :
+  """
+  Write the topology PDB file with the coordinates of a frame.
+  """
+  with open(topology) as f :
+    lines = f.readlines()
+  k = 0
+  with open(path, "w") as f :
+    for line in lines :
+      if line.startswith("ATOM") or line.startswith("HETATM") :
+        line = "%s%8.3f%8.3f%8.3f%s" % ((line[:30],) + xyz[k] + (line[54:],))
+        k += 1
+      f.write(line)
+
+def summary_codes (path) :
+  """
+  The code of each residue (G, H or E, - for none) in a summary file.
+  """
+  codes = []
+  residues = False
+  with open(path) as f :
+    for line in f :
+      if line.startswith("Residue Summary") :
+        residues = True
+      elif residues and "->" in line :
+        code = line[line.index("->") + 3]
+        codes.append(code if code in "GHE" else "-")
+  return "".join(codes)
+
 def exercise () :
   pdb_file = libtbx.env.find_in_repositories(
     relative_path="phenix_regression/pdb/1ywf.pdb",
@@ -33,5 +91,657 @@ SHEET    3   A 4 ASP A  51  ASP A  54  1  N  ASP A  51   O  LEU A 157
 SHEET    4   A 4 ASP A  74  LEU A  77  1  N  ASP A  74   O  VAL A  52""")
   print("OK")
 
+# A twelve stranded antiparallel barrel (bench/synth.py -m barrel).
+# Marking ladders depth first never links the ladder that closes the
+# barrel, which is linked afterwards: it is a cyclic sheet of twelve
+# strands, whose first strand is repeated (as SHEET 1) with its
+# registration to the last
+barrel_closed = """\
+SHEET    1   A12 ALA A  11  ALA A  17  0
+SHEET    2   A12 ALA A   2  ALA A   8 -1  N  ALA A   7   O  ALA A  12
+SHEET    3   A12 ALA A 101  ALA A 108 -1  N  ALA A 107   O  ALA A   2
+SHEET    4   A12 ALA A  91  ALA A  98 -1  N  ALA A  97   O  ALA A 102
+SHEET    5   A12 ALA A  83  ALA A  90 -1  N  ALA A  89   O  ALA A  92
+SHEET    6   A12 ALA A  73  ALA A  80 -1  N  ALA A  79   O  ALA A  84
+SHEET    7   A12 ALA A  65  ALA A  72 -1  N  ALA A  71   O  ALA A  74
+SHEET    8   A12 ALA A  55  ALA A  62 -1  N  ALA A  61   O  ALA A  66
+SHEET    9   A12 ALA A  47  ALA A  54 -1  N  ALA A  53   O  ALA A  56
+SHEET   10   A12 ALA A  37  ALA A  44 -1  N  ALA A  43   O  ALA A  48
+SHEET   11   A12 ALA A  29  ALA A  36 -1  N  ALA A  35   O  ALA A  38
+SHEET   12   A12 ALA A  19  ALA A  26 -1  N  ALA A  25   O  ALA A  30
+SHEET    1   A12 ALA A  11  ALA A  17 -1  N  ALA A  26   O  ALA A  11"""
+
+# The same barrel cut to half its height but for two strands, and
+# entered through a strand that also pairs with the other half of the
+# strand before them (bench/synth.py -m tail -n 136).  The ladder of
+# that pair is linked to the barrel when the sheet is marked, and the
+# barrel is closed by splitting it off as a sheet of its own, rather
+# than leaving an open sheet of fourteen strands
+barrel_tail = """\
+SHEET    1   A12 ALA A  31  ALA A  46  0
+SHEET    2   A12 ALA A  12  ALA A  27 -1  N  ALA A  27   O  ALA A  31
+SHEET    3   A12 ALA A 129  ALA A 136 -1  N  ALA A 136   O  ALA A  12
+SHEET    4   A12 ALA A 120  ALA A 127 -1  N  ALA A 127   O  ALA A 129
+SHEET    5   A12 ALA A 111  ALA A 118 -1  N  ALA A 118   O  ALA A 120
+SHEET    6   A12 ALA A 102  ALA A 109 -1  N  ALA A 109   O  ALA A 111
+SHEET    7   A12 ALA A  93  ALA A 100 -1  N  ALA A 100   O  ALA A 102
+SHEET    8   A12 ALA A  84  ALA A  91 -1  N  ALA A  91   O  ALA A  93
+SHEET    9   A12 ALA A  75  ALA A  82 -1  N  ALA A  82   O  ALA A  84
+SHEET   10   A12 ALA A  66  ALA A  73 -1  N  ALA A  73   O  ALA A  75
+SHEET   11   A12 ALA A  57  ALA A  64 -1  N  ALA A  64   O  ALA A  66
+SHEET   12   A12 ALA A  48  ALA A  56 -1  N  ALA A  55   O  ALA A  57
+SHEET    1   A12 ALA A  31  ALA A  46 -1  N  ALA A  56   O  ALA A  38
+SHEET    1   B 2 ALA A   2  ALA A  10  0
+SHEET    2   B 2 ALA A  20  ALA A  28 -1  N  ALA A  28   O  ALA A   2"""
+
+def exercise_barrel () :
+  output = "\n".join(ksdssp_lines([
+    os.path.join(regression_dir, "barrel.pdb")]))
+  assert not show_diff(output, barrel_closed)
+  output = "\n".join(ksdssp_lines([
+    os.path.join(regression_dir, "barrel_tail.pdb")]))
+  assert not show_diff(output, barrel_tail)
+  print("OK")
+
+# A trajectory of 6 frames of a helix, an antiparallel and a parallel
+# sheet (bench/synth.py -m alpha,anti,para), displaced at random; the
+# coordinates are on a 0.01 angstrom grid, which XTC keeps exactly
+topology = os.path.join(regression_dir, "traj.pdb")
+dcd = os.path.join(regression_dir, "traj.dcd")
+xtc = os.path.join(regression_dir, "traj.xtc")
+
+def frame_records (tmp) :
+  """
+  The records of each frame assigned on its own, enclosed in MODEL and
+  ENDMDL records as for a trajectory.
+  """
+  records = []
+  for k, xyz in enumerate(read_dcd(dcd)) :
+    pdb = os.path.join(tmp, "frame.pdb")
+    write_frame(topology, xyz, pdb)
+    records.append(["MODEL     %4d" % (k + 1)] + ksdssp_lines([pdb])
+      + ["ENDMDL"])
+  return records
+
+def exercise_trajectory () :
+  # Every way of reading the trajectory gives the records of each
+  # frame assigned on its own
+  tmp = tempfile.mkdtemp()
+  try :
+    frames = frame_records(tmp)
+  finally :
+    shutil.rmtree(tmp)
+  everything = "\n".join(sum(frames, []))
+  for args in (["-t", dcd], ["-t", xtc], ["-t", dcd, "-k", "0"],
+      ["-t", xtc, "-j", "3"]) :
+    assert not show_diff("\n".join(ksdssp_lines(args + [topology])),
+      everything)
+  selected = "\n".join(sum(frames[1::3], []))
+  for t in (dcd, xtc) :
+    assert not show_diff("\n".join(ksdssp_lines(["-t", t, "-b", "2",
+      "-i", "3", topology])), selected)
+  print("OK")
+
+def residue_atoms (path) :
+  """
+  The indices of the atoms of each residue of a PDB file.
+  """
+  residues = []
+  last = None
+  with open(path) as f :
+    k = 0
+    for line in f :
+      if line.startswith("ATOM") or line.startswith("HETATM") :
+        if line[17:27] != last :
+          residues.append([])
+          last = line[17:27]
+        residues[-1].append(k)
+        k += 1
+  return residues
+
+def exercise_incremental () :
+  # A model grown one residue at a time, then moved a stretch of
+  # residues at a time, has the records of each structure assigned on
+  # its own
+  exe = libtbx.env.under_build("ksdssp/exe/ksdssp_incremental")
+  if not os.path.isfile(exe) :
+    print("skipping")
+    return False
+  frames = read_dcd(dcd)
+  residues = residue_atoms(topology)
+  tmp = tempfile.mkdtemp()
+  try :
+    files = [topology]
+    xyz = list(frames[0])
+    for k in range(1, len(frames)) :
+      for atoms in residues[15*(k-1):15*k] :
+        for a in atoms :
+          xyz[a] = frames[k][a]
+      files.append(os.path.join(tmp, "step%d.pdb" % k))
+      write_frame(topology, xyz, files[-1])
+    # No residue moved, then all of them
+    files.append(files[-1])
+    files.append(os.path.join(tmp, "last.pdb"))
+    write_frame(topology, frames[2], files[-1])
+    # Two strands of the antiparallel sheet (residues 19-32) moved far
+    # off, then the other two after them, so that the sheet forms again
+    # with residues whose atoms have left their first places
+    xyz = list(frames[2])
+    for k, stretch in enumerate((range(18, 32), range(32, 46))) :
+      for r in stretch :
+        for a in residues[r] :
+          xyz[a] = tuple(x + t for x, t in zip(xyz[a], (40.5, -35.25, 28.0)))
+      files.append(os.path.join(tmp, "apart%d.pdb" % k))
+      write_frame(topology, xyz, files[-1])
+    for args in ([os.path.join(regression_dir, "barrel.pdb")], files) :
+      result = easy_run.fully_buffered(command=" ".join(
+        ['"%s"' % a for a in [exe] + args])).raise_if_errors()
+      assert not show_diff("\n".join(result.stdout_lines),
+        "\nEND\n".join(["\n".join(ksdssp_lines([f])) for f in args]))
+  finally :
+    shutil.rmtree(tmp)
+  print("OK")
+
+def exercise_series () :
+  # The codes decoded from a time series match those of each frame
+  # assigned on its own
+  tmp = tempfile.mkdtemp()
+  try :
+    series = os.path.join(tmp, "traj.series")
+    ksdssp_lines(["-t", dcd, "-T", series, topology])
+    expected = []
+    for k, xyz in enumerate(read_dcd(dcd)) :
+      pdb = os.path.join(tmp, "frame.pdb")
+      summary = os.path.join(tmp, "frame.summary")
+      write_frame(topology, xyz, pdb)
+      ksdssp_lines(["-S", summary, pdb])
+      expected.append("%d %s" % (k + 1, summary_codes(summary)))
+    assert not show_diff("\n".join(ksdssp_lines(["-R", series])),
+      "\n".join(expected))
+    assert not show_diff("\n".join(ksdssp_lines(["-b", "2", "-i", "2",
+      "-R", series])), "\n".join(expected[1::2]))
+  finally :
+    shutil.rmtree(tmp)
+  print("OK")
+
+# Two strands of the barrel and a helix beside it, with the MTRIX
+# operators (rotations by 60 degrees about the barrel axis) of the five
+# other copies, which close the barrel again
+mtrix = os.path.join(regression_dir, "mtrix.pdb")
+
+def write_expanded (path, expanded) :
+  """
+  Write the atoms of a PDB file followed by their copies under each
+  MTRIX operator not marked as given.  The copies keep the residue
+  identifiers, and the chain identifier changes between them, so they
+  are separate chains of one model.
+  """
+  with open(path) as f :
+    lines = f.readlines()
+  operators = {}
+  for line in lines :
+    if line.startswith("MTRIX") and line[59:60].strip() == "" :
+      operators.setdefault(int(line[7:10]), []).append(
+        [ float(line[k:k+10]) for k in (10, 20, 30) ] + [float(line[45:55])])
+  atoms = [ line for line in lines if line.startswith("ATOM") ]
+  with open(expanded, "w") as f :
+    f.writelines(atoms)
+    for serial in sorted(operators) :
+      rt = operators[serial]
+      for line in atoms :
+        x = [ float(line[k:k+8]) for k in (30, 38, 46) ]
+        y = [ sum([ r[j] * x[j] for j in range(3) ]) + r[3] for r in rt ]
+        f.write("%s%8.3f%8.3f%8.3f%s" % ((line[:30],) + tuple(y)
+          + (line[54:],)))
+    f.write("END\n")
+
+def exercise_mtrix () :
+  # The copies made with -M have the records of the expanded structure,
+  # except for the operator serial number in the comment of their
+  # HELIX records
+  tmp = tempfile.mkdtemp()
+  try :
+    expanded = os.path.join(tmp, "expanded.pdb")
+    write_expanded(mtrix, expanded)
+    result = []
+    for line in ksdssp_lines(["-M", mtrix]) :
+      if line.startswith("HELIX") :
+        line = line[:40] + " " * 30 + line[70:]
+      result.append(line)
+    assert not show_diff("\n".join(result),
+      "\n".join(ksdssp_lines([expanded])))
+  finally :
+    shutil.rmtree(tmp)
+  print("OK")
+
+def exercise_server () :
+  # Requests answered by a server (with several workers, some at the
+  # same time) have the records of ksdssp run on each file
+  if os.name == "nt" :
+    print("skipping")
+    return False
+  exe = libtbx.env.under_build("ksdssp/exe/ksdssp")
+  files = [os.path.join(regression_dir, "barrel.pdb"), topology, mtrix]
+  tmp = tempfile.mkdtemp()
+  try :
+    for options in ([], ["-M"]) :
+      socket = os.path.join(tmp, "socket")
+      server = subprocess.Popen([exe, "-D", socket, "-j", "2"] + options)
+      try :
+        for k in range(100) :
+          if os.path.exists(socket) or server.poll() is not None :
+            break
+          time.sleep(0.1)
+        assert os.path.exists(socket)
+        clients = [ subprocess.Popen([exe, "-C", socket, f],
+          stdout=subprocess.PIPE, universal_newlines=True)
+          for f in files + files ]
+        for f, client in zip(files + files, clients) :
+          output = client.communicate()[0]
+          assert client.returncode == 0
+          assert not show_diff(output.rstrip("\n"),
+            "\n".join(ksdssp_lines(options + [f])))
+      finally :
+        server.kill()
+        server.wait()
+      if os.path.exists(socket) :
+        os.remove(socket)
+  finally :
+    shutil.rmtree(tmp)
+  print("OK")
+
+def exercise_metrics () :
+  # Each stage is counted once for each model assigned, and not for the
+  # empty models read after the TER and END records
+  tmp = tempfile.mkdtemp()
+  try :
+    metrics = os.path.join(tmp, "metrics.prom")
+    ksdssp_lines(["-X", metrics, os.path.join(regression_dir, "barrel.pdb")])
+    counts = {}
+    with open(metrics) as f :
+      for line in f :
+        if line.startswith("ksdssp_models_total") :
+          models = line.split()[-1]
+        elif line.startswith("ksdssp_stage_seconds_count") :
+          counts[line[line.index('"') + 1:line.rindex('"')]] = line.split()[-1]
+    assert models == "1"
+    assert counts == dict([ (stage, models) for stage in counts ])
+    assert len(counts) == 9
+  finally :
+    shutil.rmtree(tmp)
+  print("OK")
+
+def executable_lines (args) :
+  """
+  The output of the ksdssp executable itself (phenix.ksdssp runs most
+  files in-process).
+  """
+  exe = libtbx.env.under_build("ksdssp/exe/ksdssp")
+  result = easy_run.fully_buffered(command=" ".join(
+    ['"%s"' % a for a in [exe] + args]))
+  return result.stdout_lines
+
+def read_backbone (path) :
+  """
+  The residues of a PDB file as ksdssp_ext.assign takes them: names,
+  atoms present (bit masks), coordinates of the N, CA, C, O and H atoms
+  (zero where missing) and the indices of residues before TER records,
+  with the chain identifier, sequence number and insertion code of each
+  residue.
+  """
+  slots = ["N", "CA", "C", "O", "H"]
+  names, atoms, xyz, ends, ids = [], [], [], [], []
+  last = None
+  with open(path) as f :
+    for line in f :
+      if line.startswith("TER") and len(names) > 0 :
+        ends.append(len(names) - 1)
+      if not line.startswith("ATOM") :
+        continue
+      if line[17:27] != last :
+        last = line[17:27]
+        names.append(line[17:20].strip())
+        atoms.append(0)
+        xyz.extend([0.0] * 15)
+        ids.append((line[21], int(line[22:26]), line[26]))
+      name = line[12:16].strip()
+      if name not in slots or atoms[-1] & (1 << slots.index(name)) :
+        continue
+      k = slots.index(name)
+      atoms[-1] |= 1 << k
+      n = 15 * (len(names) - 1) + 3 * k
+      xyz[n:n+3] = [ float(line[c:c+8]) for c in (30, 38, 46) ]
+  return names, atoms, xyz, ends, ids
+
+def float_buffer (values, typecode) :
+  """
+  A buffer of float32 ("f") or float64 ("d") values.
+  """
+  try :
+    import numpy
+  except ImportError :
+    import array
+    return array.array(typecode, values)
+  return numpy.array(values, dtype={"f": numpy.float32,
+    "d": numpy.float64}[typecode])
+
+def sheet_strands (sheets) :
+  """
+  The strands of assigned sheets in SHEET record order: the first
+  strand of each sheet has sense 0, and is repeated (with the sense it
+  was given) at the end of a cyclic sheet.
+  """
+  strands = []
+  for sheet in sheets :
+    first = sheet["strands"][0]
+    strands.append((first[0], first[1], 0))
+    strands.extend(sheet["strands"][1:])
+    if sheet["cyclic"] :
+      strands.append(first)
+  return strands
+
+def exercise_ext () :
+  # The extension gives the records, summary codes, helices and sheets
+  # of the executable, from files, PDB text and coordinate buffers of
+  # either precision
+  try :
+    import ksdssp_ext
+  except ImportError :
+    print("skipping")
+    return False
+  runs = [([], {}),
+    (["-c", "-0.3", "-h", "4", "-s", "4", "-B"], {"hbond_cutoff": -0.3,
+      "min_helix_length": 4, "min_strand_length": 4, "ignore_bulges": True})]
+  tmp = tempfile.mkdtemp()
+  try :
+    summary = os.path.join(tmp, "summary")
+    for path in (os.path.join(regression_dir, "barrel.pdb"), topology) :
+      names, atoms, xyz, ends, ids = read_backbone(path)
+      with open(path) as f :
+        text = f.read()
+      for args, options in runs :
+        expected = executable_lines(args + ["-S", summary, path])
+        records = ksdssp_ext.records(file_name=path, **options)
+        assert not show_diff(records.rstrip("\n"), "\n".join(expected))
+        assert ksdssp_ext.records(text=text, **options) == records
+        helices = [ (int(line[21:25]), int(line[33:37]), int(line[38:40]))
+          for line in expected if line.startswith("HELIX") ]
+        strands = [ (int(line[22:26]), int(line[33:37]), int(line[38:40]))
+          for line in expected if line.startswith("SHEET") ]
+        for typecode in "fd" :
+          result = ksdssp_ext.assign(float_buffer(xyz, typecode),
+            atoms=atoms, names=names, chain_ends=ends, **options)
+          assert "".join([ c if c in "GHE" else "-"
+            for c in result["codes"] ]) == summary_codes(summary)
+          assert [ (ids[h[0]][1], ids[h[1]][1], h[2])
+            for h in result["helices"] ] == helices
+          assert [ (ids[t[0]][1], ids[t[1]][1], t[2])
+            for t in sheet_strands(result["sheets"]) ] == strands
+  finally :
+    shutil.rmtree(tmp)
+  print("OK")
+
+def summary_ranges (path) :
+  """
+  The helices (first and last residue) and ladders (whether parallel,
+  and the first and last residue of each strand) of a summary file,
+  with residues as (chain, number, insertion code), and the number of
+  sheets.
+  """
+  residue = r"(-?\d+)(.)\[(.)\]\s*->\s*(-?\d+)(.)\[(.)\]"
+  def pair (m, k) :
+    return ((m.group(k + 1), int(m.group(k)), m.group(k + 2)),
+      (m.group(k + 4), int(m.group(k + 3)), m.group(k + 5)))
+  helices, ladders, sheets = [], [], 0
+  section = None
+  with open(path) as f :
+    for line in f :
+      if line.endswith("Summary\n") :
+        section = line.split()[0]
+      elif section == "Helix" and "->" in line :
+        helices.append(pair(re.search(residue, line), 1))
+      elif section == "Ladder" and "->" in line :
+        m = re.search(residue + r"\s*(\w+)\s*" + residue, line)
+        ladders.append((int(m.group(7) == "parallel"), pair(m, 1),
+          pair(m, 8)))
+      elif section == "Sheet" and line.startswith("Sheet") :
+        sheets += 1
+  return helices, ladders, sheets
+
+def exercise_shared_memory () :
+  # A segment laid out as in SharedSegment.h gets the secondary
+  # structure of the summary and records written for the same residues
+  if not os.path.isdir("/dev/shm") :
+    print("skipping")
+    return False
+  exe = libtbx.env.under_build("ksdssp/exe/ksdssp")
+  name = "ksdssp_test_%d" % os.getpid()
+  segment = os.path.join("/dev/shm", name)
+  header = "=4s7i96s"
+  tmp = tempfile.mkdtemp()
+  try :
+    summary = os.path.join(tmp, "summary")
+    for path in (os.path.join(regression_dir, "barrel.pdb"), topology,
+                 mtrix) :
+      names, atoms, xyz, ends, ids = read_backbone(path)
+      n = len(names)
+      records = b"".join([ struct.pack("=4sccBBi",
+          names[i].encode("ascii"), ids[i][0].encode("ascii"),
+          ids[i][2].encode("ascii"), int(i in ends), atoms[i], ids[i][1])
+        for i in range(n) ])
+      coords = struct.calcsize(header) + len(records)
+      results = coords + 4 * len(xyz)
+      size = 4 * (16 + n + 20 * n)
+      with open(segment, "wb") as f :
+        f.write(struct.pack(header, b"KSSM", 1, n, struct.calcsize(header),
+          coords, results, size, 0, b""))
+        f.write(records)
+        f.write(struct.pack("=%df" % len(xyz), *xyz))
+        f.write(b"\0" * size)
+      result = easy_run.fully_buffered(command='"%s" -m %s' % (exe, name))
+      if "not supported" in "".join(result.stderr_lines) :
+        print("skipping")
+        return False
+      result.raise_if_errors()
+      expected = executable_lines(["-S", summary, path])
+      with open(segment, "rb") as f :
+        data = f.read()
+      status, error = struct.unpack_from("=i96s", data, 28)
+      assert status == 1, error
+      counts = struct.unpack_from("=4i", data, results)
+      code_bytes = (n + 3) // 4 * 4
+      codes = data[results + 16:results + 16 + n].decode("ascii")
+      assert "".join([ c if c in "GHE" else "-" for c in codes ]) \
+        == summary_codes(summary)
+      values = list(struct.unpack_from("=%di" % (3 * counts[0]
+        + 6 * counts[1] + 3 * counts[2] + 5 * counts[3]), data,
+        results + 16 + code_bytes))
+      def take (k) :
+        taken = tuple(values[:k])
+        del values[:k]
+        return taken
+      helices = [ take(3) for i in range(counts[0]) ]
+      ladders = [ take(6) for i in range(counts[1]) ]
+      sheets = [ take(3) for i in range(counts[2]) ]
+      strands = [ take(5) for i in range(counts[3]) ]
+      summary_helices, summary_ladders, summary_sheets = \
+        summary_ranges(summary)
+      assert [ (ids[h[0]], ids[h[1]]) for h in helices ] == summary_helices
+      assert [ (l[0], (ids[l[1]], ids[l[2]]), (ids[l[3]], ids[l[4]]))
+        for l in ladders ] == summary_ladders
+      assert counts[2] == summary_sheets
+      assert [ (ids[t[0]][1], ids[t[1]][1], t[2])
+        for t in sheet_strands([ { "strands": strands[s[0]:s[0] + s[1]],
+          "cyclic": s[2] } for s in sheets ]) ] \
+        == [ (int(line[22:26]), int(line[33:37]), int(line[38:40]))
+          for line in expected if line.startswith("SHEET") ]
+
+    # A segment without residues is marked as failed
+    with open(segment, "wb") as f :
+      f.write(struct.pack(header, b"KSSM", 1, 0, 128, 128, 128, 0, 0, b""))
+    result = easy_run.fully_buffered(command='"%s" -m %s' % (exe, name))
+    assert len(result.stderr_lines) > 0
+    with open(segment, "rb") as f :
+      status, error = struct.unpack_from("=i96s", f.read(), 28)
+    assert status == 2
+    assert error.rstrip(b"\0") == b"no residues given"
+  finally :
+    if os.path.exists(segment) :
+      os.remove(segment)
+    shutil.rmtree(tmp)
+  print("OK")
+
+def cached_lines (args) :
+  """
+  The output of the executable run with -v, and the cache hits and
+  misses it reports.
+  """
+  exe = libtbx.env.under_build("ksdssp/exe/ksdssp")
+  result = easy_run.fully_buffered(command=" ".join(
+    ['"%s"' % a for a in [exe, "-v"] + args]))
+  m = re.search(r"cache: (\d+) hits, (\d+) misses",
+    "\n".join(result.stderr_lines))
+  return result.stdout_lines, int(m.group(1)), int(m.group(2))
+
+def cache_files (cache) :
+  return sorted([ f for f in os.listdir(cache) if len(f) == 64 ])
+
+def exercise_cache () :
+  # Results from the cache, whether just stored, found in it later or
+  # reused for a model repeated in the input, are those of an uncached
+  # run; other options miss, and -Z removes the oldest files first
+  tmp = tempfile.mkdtemp()
+  try :
+    cache = os.path.join(tmp, "cache")
+    models = os.path.join(tmp, "models.pdb")
+    with open(models, "w") as out :
+      for path in ("barrel.pdb", "traj.pdb", "barrel.pdb") :
+        with open(os.path.join(regression_dir, path)) as f :
+          out.writelines([ line for line in f if line.startswith("ATOM") ])
+        out.write("TER\n")
+      out.write("END\n")
+    for args in ([], ["-c", "-0.3"], ["-B"]) :
+      expected = executable_lines(args + [models])
+      assert len(expected) > 0
+      lines, hits, misses = cached_lines(args + ["-K", cache, models])
+      assert lines == expected
+      assert (hits, misses) == (1, 2)
+      lines, hits, misses = cached_lines(args + ["-K", cache, models])
+      assert lines == expected
+      assert (hits, misses) == (3, 0)
+    assert len(cache_files(cache)) == 6
+
+    # The run's own files are newer than the two placed before it, so
+    # only the oldest is removed to bring the cache under a megabyte,
+    # and none is left under a limit of 0
+    cache = os.path.join(tmp, "evict")
+    os.mkdir(cache)
+    now = time.time()
+    for key, size, age in (("a", 1 << 20, 1000), ("b", 1 << 19, 500)) :
+      path = os.path.join(cache, key * 64)
+      with open(path, "wb") as f :
+        f.write(b"\0" * size)
+      os.utime(path, (now - age, now - age))
+    cached_lines(["-K", cache, "-Z", "1", models])
+    files = cache_files(cache)
+    assert "a" * 64 not in files and "b" * 64 in files
+    assert len(files) == 3
+    cached_lines(["-K", cache, "-Z", "0", models])
+    assert cache_files(cache) == []
+  finally :
+    shutil.rmtree(tmp)
+  print("OK")
+
+def neighbor_pairs (path) :
+  """
+  The number of residue pairs of each model that ksdssp should evaluate
+  for hydrogen bonds, found by comparing all pairs: those not adjacent
+  in sequence whose C and N atoms are within 7 angstroms, with the
+  acceptor's C and O atoms and the donor's N and imide H atoms (given,
+  or placed from the N and CA atoms and the C and O atoms of the
+  residue before it).
+  """
+  names, atoms, xyz, ends, ids = read_backbone(path)
+  def has (i, slots) :
+    return all([ atoms[i] & (1 << k) for k in slots ])
+  def coord (i, k) :
+    return xyz[15 * i + 3 * k:15 * i + 3 * k + 3]
+  counts = []
+  first = 0
+  for last in [ e for e in ends if e < len(names) - 1 ] + [len(names) - 1] :
+    model = range(first, last + 1)
+    donors = [ j for j in model if has(j, (0,)) and (has(j, (4,))
+      or j > first and has(j, (1,)) and has(j - 1, (2, 3))) ]
+    count = 0
+    for i in model :
+      if not has(i, (2, 3)) :
+        continue
+      c = coord(i, 2)
+      for j in donors :
+        n = coord(j, 0)
+        if abs(i - j) >= 2 and sum([ (c[k] - n[k]) ** 2
+            for k in range(3) ]) <= 49.001 :
+          count += 1
+    counts.append(count)
+    first = last + 1
+  return counts
+
+def exercise_neighbors () :
+  # The grid finds the same residue pairs as comparing all of them,
+  # wherever the atoms fall in its cubes, for one chain, chains in
+  # separate models and chains in one model
+  exe = libtbx.env.under_build("ksdssp/exe/ksdssp")
+  tmp = tempfile.mkdtemp()
+  try :
+    expanded = os.path.join(tmp, "expanded.pdb")
+    write_expanded(mtrix, expanded)
+    models = os.path.join(tmp, "models.pdb")
+    with open(models, "w") as out :
+      for path in (topology, mtrix) :
+        with open(path) as f :
+          out.writelines([ line for line in f if line.startswith("ATOM") ])
+        out.write("TER\n")
+      out.write("END\n")
+    moved = os.path.join(tmp, "moved.pdb")
+    for path in (os.path.join(regression_dir, "barrel.pdb"), models,
+                 expanded) :
+      expected = executable_lines([path])
+      assert len(expected) > 0
+      for shift in ((0, 0, 0), (3.5, 4.5, 5.5), (-37.25, 61.75, 98.5)) :
+        with open(path) as f, open(moved, "w") as out :
+          for line in f :
+            if line.startswith("ATOM") :
+              x = [ float(line[k:k+8]) + d
+                for k, d in zip((30, 38, 46), shift) ]
+              line = "%s%8.3f%8.3f%8.3f%s" % ((line[:30],) + tuple(x)
+                + (line[54:],))
+            out.write(line)
+        assert executable_lines([moved]) == expected
+        result = easy_run.fully_buffered(command='"%s" -w "%s"'
+          % (exe, moved))
+        if "not compiled in" in "\n".join(result.stderr_lines) :
+          continue
+        # Besides the neighbors, one pair is evaluated to register each
+        # strand with the one before it
+        pairs = [ int(line.split()[2]) for line in result.stderr_lines
+          if line.split()[0] == "all" ]
+        registered = len([ line for line in expected
+          if line.startswith("SHEET") and int(line[38:40]) != 0 ])
+        assert pairs == [sum(neighbor_pairs(moved)) + registered]
+  finally :
+    shutil.rmtree(tmp)
+  print("OK")
+
 if __name__ == "__main__" :
   exercise()
+  exercise_barrel()
+  exercise_series()
+  exercise_trajectory()
+  exercise_incremental()
+  exercise_mtrix()
+  exercise_server()
+  exercise_metrics()
+  exercise_ext()
+  exercise_shared_memory()
+  exercise_cache()
+  exercise_neighbors()